@@ -0,0 +1,34 @@
+#include "Board.h"
+#include "ChunkedBoard.h"
+#include "FixedBoard.h"
+
+std::unique_ptr<Board> Board::create(int width, int height) {
+    if (width == 10 && height == 20) return std::make_unique<FixedBoard<10, 20>>();
+    if (width == 10 && height == 40) return std::make_unique<FixedBoard<10, 40>>();
+
+    return std::make_unique<ChunkedBoard>(width, height);
+}
+
+Board::Board(int width, int height) : width(width), height(height), cacheFits(CollisionCache::fits(width, height)) {
+}
+
+Board::Board(const Board& other)
+        : width(other.width), height(other.height), generation(other.generation), cacheFits(other.cacheFits) {
+}
+
+Board::~Board() = default;
+
+CollisionCache* Board::getCollisionCache() const {
+    if (!collisionCache) collisionCache = std::make_unique<CollisionCache>(width, height);
+    return collisionCache.get();
+}
+
+int Board::dropPosition(TetrominoType type, int rotation, const BlockShape& shape, int x, int y) const {
+    CollisionCache* cache = cacheFits ? getCollisionCache() : nullptr;
+    if (cache == nullptr || !cache->covers(rotation, x, y)){
+        while (checkCollisions(shape, x, y + 1) == NO_COLLISION) y++;
+        return y;
+    }
+
+    return cache->dropPosition(*this, generation, type, rotation, shape, x, y);
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <memory>
+#include "CollisionCache.h"
+#include "Tetromino.h"
+
+// Static blocks of the playfield. Use create() to get the fastest implementation for a size:
+// a FixedBoard specialization for the standard sizes, a ChunkedBoard for everything else.
+class Board{
+public:
+    virtual ~Board();
+
+    static std::unique_ptr<Board> create(int width, int height);
+    virtual std::unique_ptr<Board> clone() const = 0;
+
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+
+    virtual TetrominoType get(int x, int y) const = 0;
+    bool isOccupied(int x, int y) const { return get(x, y) != TetrominoType::EMPTY; }
+    virtual void set(int x, int y, TetrominoType type) = 0;
+
+    virtual bool isRowFull(int y) const = 0;
+
+    // Clears full rows in [fromY, toY] and shifts the rows above down. Returns the amount cleared.
+    virtual int clearFullRows(int fromY, int toY) = 0;
+
+    virtual CollisionType checkCollisions(const BlockShape& shape, int x, int y) const = 0;
+    virtual void lock(const BlockShape& shape, int x, int y, TetrominoType type) = 0;
+
+    // Same answer as checkCollisions, memoized until the board changes. Not thread safe, even
+    // though it is const: every thread needs its own board.
+    CollisionType queryCollision(TetrominoType type, int rotation, const BlockShape& shape, int x, int y) const{
+        if (!cacheFits) return checkCollisions(shape, x, y);
+
+        CollisionCache* cache = collisionCache ? collisionCache.get() : getCollisionCache();
+        if (!cache->covers(rotation, x, y)) return checkCollisions(shape, x, y);
+
+        return cache->query(*this, generation, type, rotation, shape, x, y);
+    }
+
+    // Lowest y a block at (x, y) falls to before it collides, also memoized
+    int dropPosition(TetrominoType type, int rotation, const BlockShape& shape, int x, int y) const;
+
+    // Goes up whenever a cell changes
+    uint64_t getGeneration() const { return generation; }
+
+protected:
+    Board(int width, int height);
+    Board(const Board& other); // Copies the cells' generation, the copy builds its own cache
+
+    const int width, height;
+    uint64_t generation = 0;
+
+private:
+    const bool cacheFits; // Decided once for the board's size
+    mutable std::unique_ptr<CollisionCache> collisionCache; // Built on the first query, only when it fits
+
+    CollisionCache* getCollisionCache() const; // Only for boards it fits
+};
@@ -0,0 +1,167 @@
+#include "BoardRasterizer.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define TETRIS_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+namespace {
+    void fillRowScalar(uint32_t* row, int count, uint32_t color){
+        std::fill(row, row + count, color);
+    }
+
+    void copyRowScalar(uint32_t* destination, const uint32_t* source, int count){
+        memcpy(destination, source, count * sizeof(uint32_t));
+    }
+
+#ifdef TETRIS_X86_SIMD
+    __attribute__((target("sse2"))) void fillRowSse2(uint32_t* row, int count, uint32_t color){
+        __m128i value = _mm_set1_epi32(color);
+
+        int i = 0;
+        for (; i + 4 <= count; i += 4){
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(row + i), value);
+        }
+        for (; i < count; i++) row[i] = color;
+    }
+
+    __attribute__((target("sse2"))) void copyRowSse2(uint32_t* destination, const uint32_t* source, int count){
+        int i = 0;
+        for (; i + 4 <= count; i += 4){
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i),
+                             _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i)));
+        }
+        for (; i < count; i++) destination[i] = source[i];
+    }
+
+    __attribute__((target("avx2"))) void fillRowAvx2(uint32_t* row, int count, uint32_t color){
+        __m256i value = _mm256_set1_epi32(color);
+
+        int i = 0;
+        for (; i + 8 <= count; i += 8){
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(row + i), value);
+        }
+        if (i + 4 <= count){
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(row + i), _mm256_castsi256_si128(value));
+            i += 4;
+        }
+        for (; i < count; i++) row[i] = color;
+    }
+
+    __attribute__((target("avx2"))) void copyRowAvx2(uint32_t* destination, const uint32_t* source, int count){
+        int i = 0;
+        for (; i + 8 <= count; i += 8){
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + i),
+                                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + i)));
+        }
+        if (i + 4 <= count){
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i),
+                             _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i)));
+            i += 4;
+        }
+        for (; i < count; i++) destination[i] = source[i];
+    }
+#endif
+}
+
+BoardRasterizer::BoardRasterizer(Kernel kernel) : kernel(kernel) {
+    fillRow = fillRowScalar;
+    copyRow = copyRowScalar;
+
+#ifdef TETRIS_X86_SIMD
+    if (kernel == Kernel::AVX2 && bestKernel() == Kernel::AVX2){
+        fillRow = fillRowAvx2;
+        copyRow = copyRowAvx2;
+    }
+    else if (kernel != Kernel::SCALAR){
+        this->kernel = Kernel::SSE2;
+        fillRow = fillRowSse2;
+        copyRow = copyRowSse2;
+    }
+#else
+    this->kernel = Kernel::SCALAR;
+#endif
+}
+
+BoardRasterizer::Kernel BoardRasterizer::bestKernel() {
+#ifdef TETRIS_X86_SIMD
+    if (__builtin_cpu_supports("avx2")) return Kernel::AVX2;
+    return Kernel::SSE2;
+#else
+    return Kernel::SCALAR;
+#endif
+}
+
+const char* BoardRasterizer::kernelName(Kernel kernel) {
+    switch (kernel){
+        case Kernel::AVX2:
+            return "AVX2";
+        case Kernel::SSE2:
+            return "SSE2";
+        default:
+            return "scalar";
+    }
+}
+
+void BoardRasterizer::setTarget(uint32_t* pixels, int width, int height, int pitchBytes) {
+    this->pixels = pixels;
+    this->width = width;
+    this->height = height;
+    this->pitch = pitchBytes / sizeof(uint32_t);
+}
+
+void BoardRasterizer::clear(uint32_t color) {
+    if (pitch == width){
+        fillRow(pixels, width * height, color);
+        return;
+    }
+
+    for (int y = 0; y < height; y++){
+        fillRow(row(y), width, color);
+    }
+}
+
+void BoardRasterizer::fillRect(int x, int y, int w, int h, uint32_t color) {
+    int fromX = std::max(x, 0), toX = std::min(x + w, width);
+    int fromY = std::max(y, 0), toY = std::min(y + h, height);
+    if (fromX >= toX) return;
+
+    for (int rowY = fromY; rowY < toY; rowY++){
+        fillRow(row(rowY) + fromX, toX - fromX, color);
+    }
+}
+
+void BoardRasterizer::blit(int x, int y, const Sprite& sprite) {
+    int fromX = std::max(x, 0), toX = std::min(x + sprite.width, width);
+    int fromY = std::max(y, 0), toY = std::min(y + sprite.height, height);
+    if (fromX >= toX) return;
+
+    for (int rowY = fromY; rowY < toY; rowY++){
+        const uint32_t* source = sprite.pixels.data() + static_cast<size_t>(rowY - y) * sprite.width + (fromX - x);
+        copyRow(row(rowY) + fromX, source, toX - fromX);
+    }
+}
+
+void BoardRasterizer::drawGridLines(int cellSize, uint32_t color) {
+    for (int y = 0; y < height; y++){
+        if (y % (cellSize + 1) == cellSize){
+            fillRow(row(y), width, color);
+            continue;
+        }
+
+        uint32_t* pixel = row(y);
+        for (int x = cellSize; x < width; x += cellSize + 1){
+            pixel[x] = color;
+        }
+    }
+}
+
+void BoardRasterizer::fillCell(int cellX, int cellY, int cellSize, uint32_t color) {
+    fillRect(cellX * (cellSize + 1), cellY * (cellSize + 1), cellSize, cellSize, color);
+}
+
+void BoardRasterizer::blitCell(int cellX, int cellY, const Sprite& sprite) {
+    blit(cellX * (sprite.width + 1), cellY * (sprite.height + 1), sprite);
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// 32 bit pixels in whatever channel order the target uses, sprites are fully opaque
+struct Sprite{
+    int width = 0, height = 0;
+    std::vector<uint32_t> pixels;
+};
+
+// Draws the board into a CPU side pixel buffer, e.g. a locked streaming texture. Rows are filled
+// and copied with plain loops by default; the SSE2 and AVX2 row kernels are no faster on a board
+// frame (see raster_bench), which is bound by memory bandwidth, and are kept for measuring that.
+class BoardRasterizer{
+public:
+    enum class Kernel{
+        SCALAR,
+        SSE2,
+        AVX2,
+    };
+
+    explicit BoardRasterizer(Kernel kernel = Kernel::SCALAR);
+
+    // Widest kernel the CPU supports
+    static Kernel bestKernel();
+    static const char* kernelName(Kernel kernel);
+    Kernel getKernel() const { return kernel; }
+
+    void setTarget(uint32_t* pixels, int width, int height, int pitchBytes);
+
+    void clear(uint32_t color);
+    void fillRect(int x, int y, int w, int h, uint32_t color);
+    void blit(int x, int y, const Sprite& sprite);
+
+    // Cells of cellSize pixels with 1 pixel gaps in between, the same layout the renderer
+    // draws grid lines into. Drawing the lines and then every cell writes each pixel once.
+    void drawGridLines(int cellSize, uint32_t color);
+    void fillCell(int cellX, int cellY, int cellSize, uint32_t color);
+    void blitCell(int cellX, int cellY, const Sprite& sprite);
+
+private:
+    using FillRow = void (*)(uint32_t* row, int count, uint32_t color);
+    using CopyRow = void (*)(uint32_t* destination, const uint32_t* source, int count);
+
+    Kernel kernel;
+    FillRow fillRow;
+    CopyRow copyRow;
+
+    uint32_t* pixels = nullptr;
+    int width = 0, height = 0;
+    int pitch = 0; // In pixels
+
+    uint32_t* row(int y) const { return pixels + static_cast<size_t>(y) * pitch; }
+};
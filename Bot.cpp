@@ -0,0 +1,94 @@
+#include "Bot.h"
+#include <cstdlib>
+#include <limits>
+
+Bot::Bot(const BotWeights& weights) : weights(weights) {
+}
+
+const std::vector<GameInput>& Bot::plan(const TetrisGame& game) {
+    const Board& board = game.getBoard();
+    const Tetromino& currentBlock = game.getCurrentBlock();
+
+    double bestScore = -std::numeric_limits<double>::infinity();
+    bestInputs.assign(1, GameInput::HARD_DROP);
+
+    for (int rotation = 0; rotation < currentBlock.getRotationCount(); rotation++){
+        Tetromino rotated = currentBlock;
+        candidateInputs.clear();
+
+        // Three turns clockwise is one counter clockwise
+        bool rotationBlocked = false;
+        if (rotation == 3){
+            candidateInputs.push_back(GameInput::ROTATE_CCW);
+            rotationBlocked = rotated.tryRotation(board, -1) != NO_COLLISION;
+        }
+        else{
+            for (int i = 0; i < rotation && !rotationBlocked; i++){
+                candidateInputs.push_back(GameInput::ROTATE_CW);
+                rotationBlocked = rotated.tryRotation(board, 1) != NO_COLLISION;
+            }
+        }
+        if (rotationBlocked) continue;
+
+        size_t rotationInputs = candidateInputs.size();
+
+        // Walk left from the spawn column, then right, scoring every column reached
+        for (int direction : {-1, 1}){
+            Tetromino moved = rotated;
+            candidateInputs.resize(rotationInputs);
+
+            while (true){
+                if (direction == -1 || candidateInputs.size() > rotationInputs){
+                    Tetromino dropped = moved;
+                    dropped.drop(board);
+
+                    std::unique_ptr<Board> result = board.clone();
+                    dropped.lockToBoard(*result);
+                    int linesCleared = result->clearFullRows(dropped.getY(), dropped.getY() + dropped.getMatrixSizeY() - 1);
+
+                    double score = evaluate(*result, linesCleared);
+                    if (score > bestScore){
+                        bestScore = score;
+                        bestInputs = candidateInputs;
+                        bestInputs.push_back(GameInput::HARD_DROP);
+                    }
+                }
+
+                if (moved.tryMove(board, direction, 0) != NO_COLLISION) break;
+                candidateInputs.push_back(direction == -1 ? GameInput::MOVE_LEFT : GameInput::MOVE_RIGHT);
+            }
+        }
+    }
+
+    return bestInputs;
+}
+
+double Bot::evaluate(const Board& board, int linesCleared) {
+    const int width = board.getWidth(), height = board.getHeight();
+    columnHeights.assign(width, 0);
+
+    int aggregateHeight = 0;
+    int holes = 0;
+
+    for (int x = 0; x < width; x++){
+        int y = 0;
+        while (y < height && !board.isOccupied(x, y)) y++;
+
+        columnHeights[x] = height - y;
+        aggregateHeight += columnHeights[x];
+
+        for (; y < height; y++){
+            holes += !board.isOccupied(x, y);
+        }
+    }
+
+    int bumpiness = 0;
+    for (int x = 0; x < width - 1; x++){
+        bumpiness += std::abs(columnHeights[x] - columnHeights[x + 1]);
+    }
+
+    return weights.values[0] * aggregateHeight
+         + weights.values[1] * linesCleared
+         + weights.values[2] * holes
+         + weights.values[3] * bumpiness;
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <array>
+#include <vector>
+#include "TetrisGame.h"
+
+// Weights of the board features the bot scores placements with
+struct BotWeights{
+    static constexpr int COUNT = 4;
+
+    std::array<double, COUNT> values = {
+            -0.510066, // Aggregate height
+             0.760666, // Lines cleared
+            -0.35663,  // Holes
+            -0.184483, // Bumpiness
+    };
+};
+
+// Greedy placement bot: tries every rotation and column for the current block and
+// returns the inputs leading to the best scored placement, ending with a hard drop.
+class Bot{
+public:
+    explicit Bot(const BotWeights& weights);
+
+    const std::vector<GameInput>& plan(const TetrisGame& game);
+
+private:
+    BotWeights weights;
+
+    std::vector<GameInput> bestInputs, candidateInputs;
+    std::vector<int> columnHeights;
+
+    double evaluate(const Board& board, int linesCleared);
+};
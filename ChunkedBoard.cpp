@@ -0,0 +1,126 @@
+#include "ChunkedBoard.h"
+#include <algorithm>
+
+ChunkedBoard::ChunkedBoard(int width, int height)
+        : Board(width, height), chunksX((width + CHUNK_SIZE - 1) / CHUNK_SIZE) {
+
+    int chunksY = (height + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    chunks.resize(chunksX * chunksY);
+
+    rows.resize(height);
+    for (int y = 0; y < height; y++){
+        rows[y] = y;
+    }
+
+    rowFill = std::vector<int>(height, 0);
+}
+
+ChunkedBoard::ChunkedBoard(const ChunkedBoard& other)
+        : Board(other), chunksX(other.chunksX), rows(other.rows), rowFill(other.rowFill) {
+
+    chunks.resize(other.chunks.size());
+    for (size_t i = 0; i < chunks.size(); i++){
+        if (other.chunks[i]) chunks[i] = std::make_unique<Chunk>(*other.chunks[i]);
+    }
+}
+
+std::unique_ptr<Board> ChunkedBoard::clone() const {
+    return std::make_unique<ChunkedBoard>(*this);
+}
+
+ChunkedBoard::Chunk* ChunkedBoard::chunkAt(int x, int physicalY) const {
+    return chunks[(physicalY / CHUNK_SIZE) * chunksX + x / CHUNK_SIZE].get();
+}
+
+TetrominoType ChunkedBoard::get(int x, int y) const {
+    int physicalY = rows[y];
+
+    Chunk* chunk = chunkAt(x, physicalY);
+    if (chunk == nullptr) return TetrominoType::EMPTY;
+
+    return chunk->cells[(physicalY % CHUNK_SIZE) * CHUNK_SIZE + x % CHUNK_SIZE];
+}
+
+void ChunkedBoard::set(int x, int y, TetrominoType type) {
+    int physicalY = rows[y];
+
+    std::unique_ptr<Chunk>& chunk = chunks[(physicalY / CHUNK_SIZE) * chunksX + x / CHUNK_SIZE];
+    if (!chunk){
+        if (type == TetrominoType::EMPTY) return;
+
+        chunk = std::make_unique<Chunk>();
+        chunk->cells.fill(TetrominoType::EMPTY);
+    }
+
+    TetrominoType& cell = chunk->cells[(physicalY % CHUNK_SIZE) * CHUNK_SIZE + x % CHUNK_SIZE];
+
+    int change = (type != TetrominoType::EMPTY) - (cell != TetrominoType::EMPTY);
+    rowFill[physicalY] += change;
+    chunk->count += change;
+
+    cell = type;
+    generation++;
+}
+
+void ChunkedBoard::clearPhysicalRow(int physicalY) {
+    int band = physicalY / CHUNK_SIZE;
+    int rowOffset = (physicalY % CHUNK_SIZE) * CHUNK_SIZE;
+
+    for (int chunkX = 0; chunkX < chunksX; chunkX++){
+        std::unique_ptr<Chunk>& chunk = chunks[band * chunksX + chunkX];
+        if (!chunk) continue;
+
+        for (int x = 0; x < CHUNK_SIZE; x++){
+            TetrominoType& cell = chunk->cells[rowOffset + x];
+            if (cell != TetrominoType::EMPTY){
+                cell = TetrominoType::EMPTY;
+                chunk->count--;
+            }
+        }
+
+        if (chunk->count == 0) chunk.reset();
+    }
+
+    rowFill[physicalY] = 0;
+}
+
+int ChunkedBoard::clearFullRows(int fromY, int toY) {
+    fromY = std::max(fromY, 0);
+    toY = std::min(toY, height - 1);
+
+    int cleared = 0;
+
+    // Top down, so rows shifted by an earlier clear keep their index
+    for (int y = fromY; y <= toY; y++){
+        if (!isRowFull(y)) continue;
+
+        clearPhysicalRow(rows[y]);
+
+        // Emptied row becomes the new top row
+        std::rotate(rows.begin(), rows.begin() + y, rows.begin() + y + 1);
+        cleared++;
+    }
+
+    if (cleared > 0) generation++;
+    return cleared;
+}
+
+CollisionType ChunkedBoard::checkCollisions(const BlockShape& shape, int x, int y) const {
+    for (int i = 0; i < shape.count; i++){
+        int coordX = x + shape.x[i];
+        int coordY = y + shape.y[i];
+
+        if (coordY < 0 || coordY >= height) return COLLISION_BLOCKS;
+        if (coordX < 0 || coordX >= width) return COLLISION_SIDES;
+
+        if (isOccupied(coordX, coordY)) return COLLISION_BLOCKS;
+    }
+
+    return NO_COLLISION;
+}
+
+void ChunkedBoard::lock(const BlockShape& shape, int x, int y, TetrominoType type) {
+    for (int i = 0; i < shape.count; i++){
+        set(x + shape.x[i], y + shape.y[i], type);
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <array>
+#include <memory>
+#include <vector>
+#include "Board.h"
+
+// Board of any size, used when there is no FixedBoard specialization. Cells are stored in lazily allocated square chunks,
+// so memory follows the occupied area rather than the board size. Rows are addressed
+// through an indirection table, clearing a row only clears its cells and rotates the
+// table instead of moving every row above it.
+class ChunkedBoard final : public Board{
+public:
+    ChunkedBoard(int width, int height);
+    ChunkedBoard(const ChunkedBoard& other);
+
+    std::unique_ptr<Board> clone() const override;
+
+    TetrominoType get(int x, int y) const override;
+    void set(int x, int y, TetrominoType type) override;
+
+    bool isRowFull(int y) const override { return rowFill[rows[y]] == width; }
+    int clearFullRows(int fromY, int toY) override;
+
+    CollisionType checkCollisions(const BlockShape& shape, int x, int y) const override;
+    void lock(const BlockShape& shape, int x, int y, TetrominoType type) override;
+
+private:
+    static constexpr int CHUNK_SIZE = 32;
+
+    struct Chunk{
+        std::array<TetrominoType, CHUNK_SIZE * CHUNK_SIZE> cells;
+        int count = 0;
+    };
+
+    const int chunksX;
+
+    std::vector<std::unique_ptr<Chunk>> chunks; // By physical row band, then column band
+    std::vector<int> rows;    // Logical row to physical row
+    std::vector<int> rowFill; // Occupied cells per physical row
+
+    Chunk* chunkAt(int x, int physicalY) const;
+    void clearPhysicalRow(int physicalY);
+};
@@ -0,0 +1,78 @@
+#include "CollisionCache.h"
+#include <algorithm>
+#include "Board.h"
+
+bool CollisionCache::fits(int width, int height) {
+    return width <= MAX_WIDTH && height + 2*MARGIN <= 64;
+}
+
+CollisionCache::CollisionCache(int width, int height)
+        : width(width), height(height), spanX(width + 2*MARGIN), spanY(height + 2*MARGIN),
+          rowsInside(((uint64_t(1) << height) - 1) << MARGIN),
+          columns(static_cast<size_t>(TYPES) * MAX_ROTATIONS * spanX),
+          occupied(width), occupiedStamps(width, 0) {
+}
+
+int CollisionCache::dropPosition(const Board& board, uint64_t generation, TetrominoType type, int rotation,
+                                 const BlockShape& shape, int x, int y) {
+    const Column& poses = column(board, generation, type, rotation, shape, x);
+
+    int bit = y + MARGIN + 1;
+    if (bit >= 64) return y;
+
+    // Rows below the board count as blocks, so something always stops the fall
+    uint64_t below = (poses.sides | poses.blocks) >> bit;
+    return below == 0 ? y : y + __builtin_ctzll(below);
+}
+
+void CollisionCache::fillColumn(Column& poses, const Board& board, uint64_t boardGeneration, const BlockShape& shape, int x) {
+    if (generation != boardGeneration){
+        generation = boardGeneration;
+
+        // Stamps wrap after four billion board changes, start over with clean tables then
+        if (++stamp == 0){
+            std::fill(columns.begin(), columns.end(), Column());
+            std::fill(occupiedStamps.begin(), occupiedStamps.end(), 0);
+            stamp = 1;
+        }
+    }
+
+    const uint64_t allRows = spanY == 64 ? ~uint64_t(0) : (uint64_t(1) << spanY) - 1;
+    uint64_t decided = 0;
+    poses.sides = 0;
+    poses.blocks = 0;
+
+    for (int i = 0; i < shape.count; i++){
+        int cellX = x + shape.x[i];
+
+        // Poses that put this cell above or below the board, or over a block
+        uint64_t blocks = ~(rowsInside >> shape.y[i]) & allRows;
+        uint64_t sides = 0;
+
+        if (cellX < 0 || cellX >= width){
+            sides = ~blocks & allRows;
+        }
+        else{
+            blocks |= occupiedRows(board, cellX) >> shape.y[i];
+        }
+
+        poses.blocks |= blocks & ~decided;
+        poses.sides |= sides & ~decided;
+        decided |= blocks | sides;
+    }
+
+    poses.stamp = stamp;
+}
+
+uint64_t CollisionCache::occupiedRows(const Board& board, int x) {
+    if (occupiedStamps[x] == stamp) return occupied[x];
+
+    uint64_t rows = 0;
+    for (int y = 0; y < height; y++){
+        if (board.isOccupied(x, y)) rows |= uint64_t(1) << (y + MARGIN);
+    }
+
+    occupied[x] = rows;
+    occupiedStamps[x] = stamp;
+    return rows;
+}
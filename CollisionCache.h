@@ -0,0 +1,79 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "Tetromino.h"
+
+class Board;
+
+// Answers of Board::checkCollisions for every (type, rotation, x, y), valid for one generation of
+// the board, i.e. until a block locks or rows clear. The first question about a column of poses
+// answers every y in it at once from per-column occupancy bitmasks, after that each question is
+// a bit test and a fall to the bottom is a count of trailing zeros.
+class CollisionCache{
+public:
+    // Blocks are at most 4 cells wide, poses further out than that are not cached
+    static constexpr int MARGIN = 4;
+    static constexpr int MAX_ROTATIONS = 4;
+    static constexpr int MAX_WIDTH = 256;
+
+    // A column of poses has to fit into one 64 bit mask
+    static bool fits(int width, int height);
+
+    CollisionCache(int width, int height);
+
+    bool covers(int rotation, int x, int y) const {
+        return static_cast<unsigned>(rotation) < MAX_ROTATIONS
+               && static_cast<unsigned>(x + MARGIN) < static_cast<unsigned>(spanX)
+               && static_cast<unsigned>(y + MARGIN) < static_cast<unsigned>(spanY);
+    }
+
+    // Only for poses it covers. Inlined, a hit is a few instructions without a branch on the answer.
+    CollisionType query(const Board& board, uint64_t generation, TetrominoType type, int rotation,
+                        const BlockShape& shape, int x, int y){
+        const Column& poses = column(board, generation, type, rotation, shape, x);
+        int bit = y + MARGIN;
+
+        // Never both, NO_COLLISION = 0, COLLISION_SIDES = 1, COLLISION_BLOCKS = 2
+        return static_cast<CollisionType>((poses.blocks >> bit & 1) << 1 | (poses.sides >> bit & 1));
+    }
+
+    // Lowest y the block falls to from y before anything stops it, only for poses it covers
+    int dropPosition(const Board& board, uint64_t generation, TetrominoType type, int rotation,
+                     const BlockShape& shape, int x, int y);
+
+private:
+    static constexpr int TYPES = static_cast<int>(TetrominoType::P) + 1;
+
+    const int width, height;
+    const int spanX, spanY;
+    const uint64_t rowsInside; // Bits of the rows that are on the board
+
+    // Bit MARGIN + y is the pose at y. A pose collides with the sides or with blocks, never both,
+    // whichever cell of the shape is checked first decides like in checkCollisions.
+    struct Column{
+        uint64_t sides = 0, blocks = 0;
+        uint32_t stamp = 0;
+    };
+    std::vector<Column> columns;
+
+    // Occupied cells of each board column, same bit layout
+    std::vector<uint64_t> occupied;
+    std::vector<uint32_t> occupiedStamps;
+
+    // Bumped when the board generation changes, entries with an older stamp are stale.
+    // Starts above the zero every entry starts with.
+    uint32_t stamp = 1;
+    uint64_t generation = 0;
+
+    const Column& column(const Board& board, uint64_t boardGeneration, TetrominoType type, int rotation,
+                         const BlockShape& shape, int x){
+        Column& poses = columns[(static_cast<size_t>(type) * MAX_ROTATIONS + rotation) * spanX + x + MARGIN];
+        if (poses.stamp != stamp || generation != boardGeneration){
+            fillColumn(poses, board, boardGeneration, shape, x);
+        }
+        return poses;
+    }
+
+    void fillColumn(Column& poses, const Board& board, uint64_t boardGeneration, const BlockShape& shape, int x);
+    uint64_t occupiedRows(const Board& board, int x);
+};
@@ -0,0 +1,79 @@
+#include "FixedBoard.h"
+#include <algorithm>
+
+template<int W, int H>
+FixedBoard<W, H>::FixedBoard() : Board(W, H) {
+    for (auto& row : cells){
+        row.fill(TetrominoType::EMPTY);
+    }
+    rowFill.fill(0);
+}
+
+template<int W, int H>
+std::unique_ptr<Board> FixedBoard<W, H>::clone() const {
+    return std::make_unique<FixedBoard<W, H>>(*this);
+}
+
+template<int W, int H>
+void FixedBoard<W, H>::set(int x, int y, TetrominoType type) {
+    rowFill[y] += (type != TetrominoType::EMPTY) - (cells[y][x] != TetrominoType::EMPTY);
+    cells[y][x] = type;
+    generation++;
+}
+
+template<int W, int H>
+int FixedBoard<W, H>::clearFullRows(int fromY, int toY) {
+    fromY = std::max(fromY, 0);
+    toY = std::min(toY, H - 1);
+
+    // Common case is no full row at all, checked without branches so it vectorizes
+    int fullRows = 0;
+    for (int y = fromY; y <= toY; y++){
+        fullRows += rowFill[y] == W;
+    }
+    if (fullRows == 0) return 0;
+
+    int cleared = 0;
+
+    // Top down, so rows shifted by an earlier clear keep their index
+    for (int y = fromY; y <= toY; y++){
+        if (!isRowFull(y)) continue;
+
+        std::move_backward(cells.begin(), cells.begin() + y, cells.begin() + y + 1);
+        std::move_backward(rowFill.begin(), rowFill.begin() + y, rowFill.begin() + y + 1);
+        cells[0].fill(TetrominoType::EMPTY);
+        rowFill[0] = 0;
+        cleared++;
+    }
+
+    generation++;
+    return cleared;
+}
+
+template<int W, int H>
+CollisionType FixedBoard<W, H>::checkCollisions(const BlockShape& shape, int x, int y) const {
+    for (int i = 0; i < shape.count; i++){
+        int coordX = x + shape.x[i];
+        int coordY = y + shape.y[i];
+
+        if (static_cast<unsigned>(coordY) >= static_cast<unsigned>(H)) return COLLISION_BLOCKS;
+        if (static_cast<unsigned>(coordX) >= static_cast<unsigned>(W)) return COLLISION_SIDES;
+
+        if (cells[coordY][coordX] != TetrominoType::EMPTY) return COLLISION_BLOCKS;
+    }
+
+    return NO_COLLISION;
+}
+
+template<int W, int H>
+void FixedBoard<W, H>::lock(const BlockShape& shape, int x, int y, TetrominoType type) {
+    // Only called for positions that passed checkCollisions, every cell was empty
+    for (int i = 0; i < shape.count; i++){
+        cells[y + shape.y[i]][x + shape.x[i]] = type;
+        rowFill[y + shape.y[i]]++;
+    }
+    generation++;
+}
+
+template class FixedBoard<10, 20>;
+template class FixedBoard<10, 40>;
@@ -0,0 +1,30 @@
+#pragma once
+#include <array>
+#include "Board.h"
+
+// Board with its size known at compile time. Rows are plain arrays, so the row and
+// collision loops have constant bounds the compiler can unroll and vectorize.
+template<int W, int H>
+class FixedBoard final : public Board{
+public:
+    FixedBoard();
+
+    std::unique_ptr<Board> clone() const override;
+
+    TetrominoType get(int x, int y) const override { return cells[y][x]; }
+    void set(int x, int y, TetrominoType type) override;
+
+    bool isRowFull(int y) const override { return rowFill[y] == W; }
+    int clearFullRows(int fromY, int toY) override;
+
+    CollisionType checkCollisions(const BlockShape& shape, int x, int y) const override;
+    void lock(const BlockShape& shape, int x, int y, TetrominoType type) override;
+
+private:
+    std::array<std::array<TetrominoType, W>, H> cells;
+    std::array<int, H> rowFill; // Occupied cells per row
+};
+
+// Standard sizes are instantiated in FixedBoard.cpp
+extern template class FixedBoard<10, 20>;
+extern template class FixedBoard<10, 40>;
@@ -0,0 +1,225 @@
+#include "FrameCapture.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <SDL_image.h>
+#include "Trace.h"
+
+namespace {
+    uint64_t nowUs(){
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    bool endsWith(const std::string& text, const std::string& suffix){
+        return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+
+    // Full range BT.601, what C420jpeg means
+    inline uint8_t luma(uint32_t pixel){
+        int r = pixel >> 16 & 0xFF, g = pixel >> 8 & 0xFF, b = pixel & 0xFF;
+        return (77*r + 150*g + 29*b + 128) >> 8;
+    }
+}
+
+FrameCapture::FrameCapture(const std::string& path, int width, int height, int fps, bool offline)
+        : path(path), width(width), height(height), fps(fps), offline(offline), y4m(endsWith(path, ".y4m")) {
+    if (y4m){
+        file = fopen(path.c_str(), "wb");
+        if (file == nullptr){
+            std::cout << "Could not open capture file: " << path << std::endl;
+            return;
+        }
+        fprintf(file, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", width, height, fps);
+        yuv.resize(static_cast<size_t>(width) * height + 2 * ((width + 1)/2) * ((height + 1)/2));
+    }
+    else if (mkdir(path.c_str(), 0755) != 0 && errno != EEXIST){
+        std::cout << "Could not create capture directory: " << path << std::endl;
+        return;
+    }
+
+    for (size_t i = 0; i < POOL_SIZE; i++){
+        pool.push_back(std::make_unique<Frame>());
+        pool.back()->pixels.resize(static_cast<size_t>(width) * height);
+        freeFrames.push_back(pool.back().get());
+    }
+
+    writer = std::thread(&FrameCapture::writeLoop, this);
+    open = true;
+}
+
+FrameCapture::~FrameCapture() {
+    if (writer.joinable()){
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        changed.notify_all();
+        writer.join();
+    }
+
+    if (file != nullptr) fclose(file);
+
+    if (open){
+        std::cout << "Captured " << framesCaptured << " frames to " << path;
+        if (framesRepeated > 0) std::cout << ", repeated " << framesRepeated << " to keep the game's pace";
+        if (framesDropped > 0) std::cout << ", dropped " << framesDropped << " while the writer was busy";
+        std::cout << std::endl;
+    }
+}
+
+void FrameCapture::capture(SDL_Renderer* renderer) {
+    if (!open) return;
+    TRACE_ZONE("FrameCapture::capture");
+
+    // Live frames go where their time falls, offline ones one after the other
+    uint64_t index = framesCaptured;
+    if (!offline){
+        uint64_t now = nowUs();
+        if (startUs == 0) startUs = now;
+
+        index = (now - startUs) * fps / 1000000;
+        if (index < nextIndex) return;
+        nextIndex = index + 1;
+    }
+
+    Frame* frame;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (offline){
+            changed.wait(lock, [this]{ return !freeFrames.empty(); });
+        }
+        else if (freeFrames.empty()){
+            framesDropped++;
+            return;
+        }
+
+        frame = freeFrames.back();
+        freeFrames.pop_back();
+    }
+
+    if (SDL_RenderReadPixels(renderer, NULL, SDL_PIXELFORMAT_RGB888, frame->pixels.data(), width * sizeof(uint32_t)) != 0){
+        std::cout << "Could not read back the frame: " << SDL_GetError() << std::endl;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        freeFrames.push_back(frame);
+        return;
+    }
+    frame->index = index;
+    framesCaptured++;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queued.push_back(frame);
+    }
+    changed.notify_all();
+}
+
+void FrameCapture::writeLoop() {
+    TRACE_THREAD_NAME("capture");
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true){
+        changed.wait(lock, [this]{ return stopping || !queued.empty(); });
+        if (queued.empty()) return; // Stopping with everything written
+
+        Frame* frame = queued.front();
+        queued.pop_front();
+        lock.unlock();
+
+        {
+            TRACE_ZONE("FrameCapture::encode");
+            uint64_t index = frame->index - framesCut;
+            uint64_t maxGap = static_cast<uint64_t>(MAX_GAP_SECONDS) * fps;
+            if (index > framesWritten + maxGap){
+                framesCut += index - framesWritten - maxGap;
+                index = framesWritten + maxGap;
+            }
+
+            // Nothing was taken in between, the screen still showed the last frame
+            while (framesWritten > 0 && framesWritten < index){
+                repeatLastFrame();
+                framesWritten++;
+                framesRepeated++;
+            }
+
+            if (y4m) writeY4m(*frame);
+            else writePng(*frame);
+            framesWritten++;
+        }
+
+        lock.lock();
+        freeFrames.push_back(frame);
+        changed.notify_all();
+    }
+}
+
+void FrameCapture::writeY4m(const Frame& frame) {
+    const int chromaWidth = (width + 1)/2, chromaHeight = (height + 1)/2;
+    uint8_t* yPlane = yuv.data();
+    uint8_t* uPlane = yPlane + static_cast<size_t>(width) * height;
+    uint8_t* vPlane = uPlane + static_cast<size_t>(chromaWidth) * chromaHeight;
+
+    for (size_t i = 0; i < frame.pixels.size(); i++){
+        yPlane[i] = luma(frame.pixels[i]);
+    }
+
+    // Chroma of each 2x2 block from its average color
+    for (int cy = 0; cy < chromaHeight; cy++){
+        const uint32_t* top = frame.pixels.data() + static_cast<size_t>(2*cy) * width;
+        const uint32_t* bottom = 2*cy + 1 < height ? top + width : top;
+
+        for (int cx = 0; cx < chromaWidth; cx++){
+            int x0 = 2*cx, x1 = std::min(2*cx + 1, width - 1);
+            int r = 0, g = 0, b = 0;
+            for (uint32_t pixel : {top[x0], top[x1], bottom[x0], bottom[x1]}){
+                r += pixel >> 16 & 0xFF;
+                g += pixel >> 8 & 0xFF;
+                b += pixel & 0xFF;
+            }
+
+            // Sums of four pixels, hence the two extra bits of shift
+            uPlane[cy*chromaWidth + cx] = std::clamp(((-43*r - 85*g + 128*b + 512) >> 10) + 128, 0, 255);
+            vPlane[cy*chromaWidth + cx] = std::clamp(((128*r - 107*g - 21*b + 512) >> 10) + 128, 0, 255);
+        }
+    }
+
+    fputs("FRAME\n", file);
+    fwrite(yuv.data(), 1, yuv.size(), file);
+}
+
+void FrameCapture::writePng(const Frame& frame) {
+    std::string framePath = pngPath(framesWritten);
+
+    // Wraps the buffer without copying, the surface is only read
+    SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormatFrom(const_cast<uint32_t*>(frame.pixels.data()), width, height,
+                                                              32, width * sizeof(uint32_t), SDL_PIXELFORMAT_RGB888);
+    if (surface == nullptr || IMG_SavePNG(surface, framePath.c_str()) != 0){
+        std::cout << "Could not write capture frame " << framePath << ": " << IMG_GetError() << std::endl;
+    }
+    SDL_FreeSurface(surface);
+}
+
+void FrameCapture::repeatLastFrame() {
+    if (y4m){
+        // yuv still holds the last frame written
+        fputs("FRAME\n", file);
+        fwrite(yuv.data(), 1, yuv.size(), file);
+        return;
+    }
+
+    // A hard link costs no encoding and no space
+    std::string framePath = pngPath(framesWritten);
+    if (link(pngPath(framesWritten - 1).c_str(), framePath.c_str()) != 0){
+        std::cout << "Could not write capture frame " << framePath << ": " << strerror(errno) << std::endl;
+    }
+}
+
+std::string FrameCapture::pngPath(uint64_t index) const {
+    char name[32];
+    snprintf(name, sizeof(name), "/frame_%06llu.png", static_cast<unsigned long long>(index));
+    return path + name;
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <SDL.h>
+
+// Reads back finished frames into a small pool of reused buffers and encodes them on a writer
+// thread. A path ending in .y4m gets one Y4M video, any other path is a directory that gets
+// numbered PNG frames.
+//
+// Live capture places every frame by the time it was taken, at most one per 1/fps of a second,
+// and drops frames while all buffers wait for the writer, so the game never waits for encoding.
+// The writer repeats the previous frame for the times nothing was taken (the main loop only draws
+// when something changes), so the video plays at the game's speed. Stretches of more than
+// MAX_GAP_SECONDS without a frame, e.g. a pause, are cut to that. Offline capture takes every
+// frame it is given, one per 1/fps of a second, and waits for a free buffer instead.
+class FrameCapture{
+public:
+    static constexpr int DEFAULT_FPS = 60;
+    static constexpr int MAX_GAP_SECONDS = 1;
+
+    FrameCapture(const std::string& path, int width, int height, int fps, bool offline);
+    ~FrameCapture(); // Writes the queued frames
+
+    bool isOpen() const { return open; }
+
+    // Call once the frame is composed, before SDL_RenderPresent
+    void capture(SDL_Renderer* renderer);
+
+    uint64_t getFramesCaptured() const { return framesCaptured; }
+    uint64_t getFramesDropped() const { return framesDropped; }
+
+private:
+    static constexpr size_t POOL_SIZE = 4;
+
+    struct Frame{
+        uint64_t index; // Position in the video, before gaps are cut
+        std::vector<uint32_t> pixels; // RGB888, no padding between rows
+    };
+
+    const std::string path;
+    const int width, height, fps;
+    const bool offline;
+    const bool y4m;
+    bool open = false;
+
+    FILE* file = nullptr;
+    std::vector<uint8_t> yuv; // Writer thread only
+
+    std::vector<std::unique_ptr<Frame>> pool;
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::vector<Frame*> freeFrames;
+    std::deque<Frame*> queued;
+    bool stopping = false;
+    std::thread writer;
+
+    uint64_t framesCaptured = 0, framesDropped = 0;
+    uint64_t startUs = 0;
+    uint64_t nextIndex = 0; // Live frames taken before this position are skipped
+
+    // Writer thread only
+    uint64_t framesWritten = 0, framesRepeated = 0;
+    uint64_t framesCut = 0; // Taken out of long gaps, later frames move up by this much
+
+    void writeLoop();
+    void writeY4m(const Frame& frame);
+    void writePng(const Frame& frame);
+    void repeatLastFrame();
+    std::string pngPath(uint64_t index) const;
+};
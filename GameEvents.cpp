@@ -0,0 +1,55 @@
+#include "GameEvents.h"
+#include <algorithm>
+
+bool GameEventBus::subscribe(GameEventListener* listener) {
+    if (listenerCount == MAX_LISTENERS) return false;
+    listeners[listenerCount++] = listener;
+    return true;
+}
+
+void GameEventBus::unsubscribe(GameEventListener* listener) {
+    auto end = std::remove(listeners.begin(), listeners.begin() + listenerCount, listener);
+    listenerCount = static_cast<int>(end - listeners.begin());
+}
+
+void GameEventBus::post(const GameEvent& event) {
+    bool score = event.type == GameEventType::SCORE_CHANGED;
+    if (score && queued > 0 && queue[queued - 1].type == GameEventType::SCORE_CHANGED){
+        queue[queued - 1].value = event.value;
+        return;
+    }
+
+    // Only SCORE_CHANGED takes the last slot, once it is taken everything after it is dropped and
+    // the next score replaces it
+    if (queued >= (score ? CAPACITY : CAPACITY - 1)){
+        dropped++;
+        return;
+    }
+    queue[queued++] = event;
+}
+
+void GameEventBus::dispatch() {
+    if (queued == 0) return;
+
+    for (int i = 0; i < listenerCount; i++){
+        listeners[i]->onGameEvents(queue.data(), queued);
+    }
+    queued = 0;
+}
+
+void ScoreKeeper::onGameEvents(const GameEvent* events, int count) {
+    for (int i = 0; i < count; i++){
+        const GameEvent& event = events[i];
+        switch (event.type){
+            case GameEventType::GAME_STARTED:
+                points = event.value;
+                piecesPlaced = 0;
+                linesCleared = 0;
+                break;
+            case GameEventType::PIECE_LOCKED: piecesPlaced = event.value; break;
+            case GameEventType::LINES_CLEARED: linesCleared += event.value; break;
+            case GameEventType::SCORE_CHANGED: points = event.value; break;
+            default: break;
+        }
+    }
+}
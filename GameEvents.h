@@ -0,0 +1,73 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include "TetrisGame.h"
+
+enum class GameEventType : uint8_t{
+    GAME_STARTED,
+    PIECE_LOCKED,
+    HARD_DROP,
+    LINES_CLEARED,
+    SCORE_CHANGED,
+    GAME_OVER,
+};
+
+struct GameEvent{
+    GameEventType type;
+    int value = 0;     // Rows for LINES_CLEARED, blocks placed so far for PIECE_LOCKED, the score for
+                       // SCORE_CHANGED and GAME_STARTED
+    LockedPose pose{}; // Where the block came to rest, for PIECE_LOCKED
+};
+
+class GameEventListener{
+public:
+    virtual ~GameEventListener() = default;
+
+    // The events of one tick in the order they happened
+    virtual void onGameEvents(const GameEvent* events, int count) = 0;
+};
+
+// Queue between the game and whatever reacts to it (sound, score display, telemetry). The game
+// posts during a tick and the main loop dispatches the batch once at its end, so the game never
+// waits on a listener. Fixed capacity and no allocation: when the queue is full, further events
+// of the tick are dropped and counted. The last slot is kept for SCORE_CHANGED, and a
+// SCORE_CHANGED right after another one replaces it, so the latest score always gets through and
+// events keep their order.
+class GameEventBus{
+public:
+    static constexpr int CAPACITY = 64;
+    static constexpr int MAX_LISTENERS = 8;
+
+    // Listeners must outlive their subscription. False when there are MAX_LISTENERS already.
+    bool subscribe(GameEventListener* listener);
+    void unsubscribe(GameEventListener* listener);
+
+    void post(const GameEvent& event);
+
+    // Hands the queued events to every listener and empties the queue. Listeners must not post.
+    void dispatch();
+
+    uint64_t getDropped() const { return dropped; }
+
+private:
+    std::array<GameEvent, CAPACITY> queue;
+    int queued = 0;
+
+    std::array<GameEventListener*, MAX_LISTENERS> listeners{};
+    int listenerCount = 0;
+
+    uint64_t dropped = 0;
+};
+
+// Score and counters of the game it listens to, for score displays and telemetry
+class ScoreKeeper : public GameEventListener{
+public:
+    void onGameEvents(const GameEvent* events, int count) override;
+
+    int getPoints() const { return points; }
+    int getPiecesPlaced() const { return piecesPlaced; }
+    int getLinesCleared() const { return linesCleared; }
+
+private:
+    int points = 0, piecesPlaced = 0, linesCleared = 0;
+};
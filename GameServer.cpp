@@ -0,0 +1,429 @@
+#include "GameServer.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace ServerProtocol;
+
+namespace {
+    const std::string UNIX_PREFIX = "unix:";
+
+    constexpr int MAX_EVENTS = 256;
+    constexpr int IDLE_WAIT_MS = 100; // Longest sleep, so stop() is noticed
+    constexpr size_t MAX_PENDING_OUTPUT = 64 * 1024; // Clients that don't read get dropped
+    constexpr uint64_t MIN_RESTART_US = 1000000; // Between restarts of a game still in progress
+
+    uint8_t resultFlags(const GameStepResult& result){
+        uint8_t flags = std::min(result.linesCleared, 7) << LINES_SHIFT;
+        if (result.locked) flags |= FLAG_LOCKED;
+        if (result.gameOver) flags |= FLAG_GAME_OVER;
+        return flags;
+    }
+
+    uint64_t percentile(const std::vector<uint64_t>& buckets, uint64_t total, double p, uint64_t bucketUs){
+        if (total == 0) return 0;
+
+        uint64_t target = std::max<uint64_t>(1, static_cast<uint64_t>(p * total));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < buckets.size(); i++){
+            seen += buckets[i];
+            if (seen >= target) return (i + 1) * bucketUs;
+        }
+        return buckets.size() * bucketUs;
+    }
+}
+
+GameServer::GameServer(const std::string& address, int workers, bool allInterfaces)
+        : address(address), workerCount(std::max(1, workers)), allInterfaces(allInterfaces) {
+}
+
+GameServer::~GameServer() {
+    stop();
+}
+
+bool GameServer::start() {
+    if (!listenOn()) return false;
+
+    startUs = nowUs();
+    running = true;
+
+    for (int i = 0; i < workerCount; i++){
+        auto worker = std::make_unique<Worker>();
+        worker->index = i;
+        worker->timers = std::make_unique<TimerWheel>(startUs / 1000);
+
+        worker->epollFd = epoll_create1(0);
+        if (worker->epollFd == -1){
+            std::cout << "Could not create epoll set: " << strerror(errno) << std::endl;
+            stop();
+            return false;
+        }
+
+        // Only one of the workers waiting on the listening socket is woken per connection
+        epoll_event event{};
+        event.events = EPOLLIN | EPOLLEXCLUSIVE;
+        event.data.u64 = 0;
+        epoll_ctl(worker->epollFd, EPOLL_CTL_ADD, listenFd, &event);
+
+        workers.push_back(std::move(worker));
+    }
+
+    for (auto& worker : workers){
+        worker->thread = std::thread(&GameServer::run, this, std::ref(*worker));
+    }
+    return true;
+}
+
+void GameServer::stop() {
+    running = false;
+
+    for (auto& worker : workers){
+        if (worker->thread.joinable()) worker->thread.join();
+
+        for (auto& session : worker->sessions){
+            close(session.second->fd);
+        }
+        worker->sessions.clear();
+
+        if (worker->epollFd != -1) close(worker->epollFd);
+        worker->epollFd = -1;
+    }
+    workers.clear();
+
+    if (listenFd != -1){
+        close(listenFd);
+        listenFd = -1;
+        if (address.compare(0, UNIX_PREFIX.size(), UNIX_PREFIX) == 0){
+            unlink(address.substr(UNIX_PREFIX.size()).c_str());
+        }
+    }
+}
+
+ServerStats GameServer::getStats() const {
+    ServerStats stats;
+    stats.workers = workers.size();
+    stats.uptimeMs = (nowUs() - startUs) / 1000;
+
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    stats.cpuMs = (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000
+                  + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000;
+
+    std::vector<uint64_t> buckets(LATENESS_BUCKETS + 1, 0);
+    uint64_t total = 0;
+    for (const auto& worker : workers){
+        stats.sessions += worker->sessionCount.load(std::memory_order_relaxed);
+        stats.gravityTicks += worker->gravityTicks.load(std::memory_order_relaxed);
+        stats.lateMaxUs = std::max<uint64_t>(stats.lateMaxUs, worker->latenessMaxUs.load(std::memory_order_relaxed));
+
+        for (size_t i = 0; i < buckets.size(); i++){
+            uint32_t count = worker->lateness[i].load(std::memory_order_relaxed);
+            buckets[i] += count;
+            total += count;
+        }
+    }
+
+    stats.lateP50Us = percentile(buckets, total, 0.5, LATENESS_BUCKET_US);
+    stats.lateP99Us = percentile(buckets, total, 0.99, LATENESS_BUCKET_US);
+    stats.lateP999Us = percentile(buckets, total, 0.999, LATENESS_BUCKET_US);
+    return stats;
+}
+
+bool GameServer::listenOn() {
+    bool isUnix = address.compare(0, UNIX_PREFIX.size(), UNIX_PREFIX) == 0;
+
+    listenFd = socket(isUnix ? AF_UNIX : AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (listenFd == -1){
+        std::cout << "Could not create socket: " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    int result;
+    if (isUnix){
+        std::string path = address.substr(UNIX_PREFIX.size());
+        sockaddr_un socketAddress{};
+        socketAddress.sun_family = AF_UNIX;
+        strncpy(socketAddress.sun_path, path.c_str(), sizeof(socketAddress.sun_path) - 1);
+
+        unlink(path.c_str()); // Left over from a server that did not shut down cleanly
+        result = bind(listenFd, reinterpret_cast<sockaddr*>(&socketAddress), sizeof(socketAddress));
+    }else{
+        int reuse = 1;
+        setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+        sockaddr_in socketAddress{};
+        socketAddress.sin_family = AF_INET;
+        socketAddress.sin_addr.s_addr = htonl(allInterfaces ? INADDR_ANY : INADDR_LOOPBACK);
+        socketAddress.sin_port = htons(atoi(address.c_str()));
+        result = bind(listenFd, reinterpret_cast<sockaddr*>(&socketAddress), sizeof(socketAddress));
+    }
+
+    if (result != 0 || listen(listenFd, SOMAXCONN) != 0){
+        std::cout << "Could not listen on " << address << ": " << strerror(errno) << std::endl;
+        close(listenFd);
+        listenFd = -1;
+        return false;
+    }
+    return true;
+}
+
+void GameServer::run(Worker& worker) {
+    epoll_event events[MAX_EVENTS];
+
+    while (running.load(std::memory_order_relaxed)){
+        uint64_t now = nowUs();
+        int64_t timeout = worker.timers->msUntilNext(now / 1000);
+        if (timeout < 0 || timeout > IDLE_WAIT_MS) timeout = IDLE_WAIT_MS;
+
+        int count = epoll_wait(worker.epollFd, events, MAX_EVENTS, timeout);
+        for (int i = 0; i < count; i++){
+            uint64_t id = events[i].data.u64;
+            if (id == 0){
+                accept(worker);
+                continue;
+            }
+
+            auto found = worker.sessions.find(id);
+            if (found == worker.sessions.end()) continue;
+            Session& session = *found->second;
+
+            if (events[i].events & (EPOLLHUP | EPOLLERR)){
+                closeSession(worker, id);
+                continue;
+            }
+            if (events[i].events & EPOLLOUT){
+                onWritable(worker, session);
+                if (worker.sessions.count(id) == 0) continue;
+            }
+            if (events[i].events & EPOLLIN) onReadable(worker, session);
+        }
+
+        now = nowUs();
+        worker.timers->advance(now / 1000, [&](uint64_t id, uint32_t generation){
+            onGravity(worker, id, generation, now);
+        });
+    }
+}
+
+void GameServer::accept(Worker& worker) {
+    while (true){
+        int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK);
+        if (fd == -1) return; // EAGAIN, or another worker got it
+
+        // Replies are a few bytes each, they must not wait for more to fill a segment
+        int noDelay = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+
+        auto session = std::make_unique<Session>();
+        session->id = worker.nextSessionId++;
+        session->fd = fd;
+
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.u64 = session->id;
+        if (epoll_ctl(worker.epollFd, EPOLL_CTL_ADD, fd, &event) != 0){
+            close(fd);
+            continue;
+        }
+
+        worker.sessions.insert({session->id, std::move(session)});
+        worker.sessionCount.store(worker.sessions.size(), std::memory_order_relaxed);
+    }
+}
+
+void GameServer::onReadable(Worker& worker, Session& session) {
+    uint8_t buffer[4096];
+    while (true){
+        ssize_t received = recv(session.fd, buffer, sizeof(buffer), 0);
+        if (received > 0){
+            session.input.insert(session.input.end(), buffer, buffer + received);
+            if (received < static_cast<ssize_t>(sizeof(buffer))) break;
+            continue;
+        }
+        if (received == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)){
+            closeSession(worker, session.id);
+            return;
+        }
+        break;
+    }
+
+    if (!handleMessages(worker, session)){
+        closeSession(worker, session.id);
+        return;
+    }
+    flush(worker, session);
+}
+
+void GameServer::onWritable(Worker& worker, Session& session) {
+    session.writable = true;
+    flush(worker, session);
+}
+
+void GameServer::closeSession(Worker& worker, uint64_t id) {
+    auto found = worker.sessions.find(id);
+    if (found == worker.sessions.end()) return;
+
+    // Closing the fd also removes it from the epoll set, its timer is ignored once it fires
+    close(found->second->fd);
+    worker.sessions.erase(found);
+    worker.sessionCount.store(worker.sessions.size(), std::memory_order_relaxed);
+}
+
+bool GameServer::handleMessages(Worker& worker, Session& session) {
+    const std::vector<uint8_t>& input = session.input;
+    size_t offset = 0;
+
+    while (offset < input.size()){
+        uint8_t type = input[offset];
+
+        if (type == HELLO){
+            if (input.size() - offset < HELLO_SIZE) break;
+
+            int width = input[offset + 1], height = input[offset + 2];
+            if (width < MIN_SIZE || height < MIN_SIZE || width > MAX_WIDTH || height > MAX_HEIGHT) return false;
+
+            // A new game after a game over is always fine, giving up on one only now and then
+            if (session.game && !session.game->isGameOver() && nowUs() - session.startedUs < MIN_RESTART_US) return false;
+
+            startGame(worker, session, width, height);
+            offset += HELLO_SIZE;
+        }
+        else if (type == STATS){
+            sendStats(session);
+            offset++;
+        }
+        else if (type >= INPUT && type <= INPUT_LAST){
+            if (!session.game) return false;
+
+            GameStepResult result = session.game->applyInput(static_cast<GameInput>(type - INPUT));
+            sendResult(session, INPUT_RESULT, result);
+            offset++;
+        }
+        else{
+            return false;
+        }
+    }
+
+    session.input.erase(session.input.begin(), session.input.begin() + offset);
+    return true;
+}
+
+void GameServer::startGame(Worker& worker, Session& session, int width, int height) {
+    thread_local std::mt19937 seeds{std::random_device()()};
+    uint32_t seed = seeds();
+
+    session.game = std::make_unique<TetrisGame>(width, height, seed);
+    session.startedUs = nowUs();
+    session.gravityGeneration++; // The old game's timer may still be in the wheel
+
+    uint8_t welcome[WELCOME_SIZE] = {WELCOME};
+    put32(welcome + 1, seed);
+    session.output.insert(session.output.end(), welcome, welcome + WELCOME_SIZE);
+
+    scheduleGravity(worker, session, session.startedUs + TetrisGame::gravityInterval(0) * 1e6);
+}
+
+void GameServer::onGravity(Worker& worker, uint64_t id, uint32_t generation, uint64_t nowUs) {
+    auto found = worker.sessions.find(id);
+    if (found == worker.sessions.end()) return;
+
+    Session& session = *found->second;
+    // Left over from a game the client restarted
+    if (!session.game || session.gravityDeadlineUs == 0 || generation != session.gravityGeneration) return;
+
+    uint64_t lateUs = nowUs > session.gravityDeadlineUs ? nowUs - session.gravityDeadlineUs : 0;
+    worker.lateness[std::min<uint64_t>(lateUs / LATENESS_BUCKET_US, LATENESS_BUCKETS)].fetch_add(1, std::memory_order_relaxed);
+    if (lateUs > worker.latenessMaxUs.load(std::memory_order_relaxed)){
+        worker.latenessMaxUs.store(lateUs, std::memory_order_relaxed);
+    }
+    worker.gravityTicks.fetch_add(1, std::memory_order_relaxed);
+
+    GameStepResult result = session.game->gameLoop();
+    if (result.locked || result.gameOver){
+        sendResult(session, GRAVITY, result);
+        flush(worker, session);
+        if (worker.sessions.count(id) == 0) return; // Dropped while flushing
+    }
+
+    if (session.game->isGameOver()){
+        session.gravityDeadlineUs = 0;
+        return;
+    }
+
+    // Keep the cadence, unless the worker fell so far behind that steps would pile up
+    uint64_t interval = TetrisGame::gravityInterval(session.game->getPoints()) * 1e6;
+    scheduleGravity(worker, session, std::max(session.gravityDeadlineUs + interval, nowUs));
+}
+
+void GameServer::scheduleGravity(Worker& worker, Session& session, uint64_t deadlineUs) {
+    session.gravityDeadlineUs = deadlineUs;
+    worker.timers->schedule(session.id, deadlineUs / 1000, session.gravityGeneration);
+}
+
+void GameServer::sendResult(Session& session, uint8_t type, const GameStepResult& result) {
+    uint8_t message[RESULT_SIZE] = {type, resultFlags(result)};
+    put32(message + 2, session.game->getPoints());
+    session.output.insert(session.output.end(), message, message + RESULT_SIZE);
+}
+
+void GameServer::sendStats(Session& session) {
+    ServerStats stats = getStats();
+
+    uint8_t message[STATS_REPLY_SIZE] = {STATS_REPLY};
+    uint8_t* out = message + 1;
+    put32(out, stats.sessions); out += 4;
+    put16(out, stats.workers); out += 2;
+    put64(out, stats.gravityTicks); out += 8;
+    put64(out, stats.cpuMs); out += 8;
+    put64(out, stats.uptimeMs); out += 8;
+    for (uint32_t value : {stats.lateP50Us, stats.lateP99Us, stats.lateP999Us, stats.lateMaxUs}){
+        put32(out, value);
+        out += 4;
+    }
+    session.output.insert(session.output.end(), message, message + STATS_REPLY_SIZE);
+}
+
+void GameServer::flush(Worker& worker, Session& session) {
+    if (!session.writable || session.output.empty()) return;
+
+    ssize_t sent = send(session.fd, session.output.data(), session.output.size(), MSG_NOSIGNAL);
+    if (sent < 0){
+        if (errno != EAGAIN && errno != EWOULDBLOCK){
+            closeSession(worker, session.id);
+            return;
+        }
+        sent = 0;
+    }
+    session.output.erase(session.output.begin(), session.output.begin() + sent);
+
+    bool blocked = !session.output.empty();
+    if (blocked && session.output.size() > MAX_PENDING_OUTPUT){
+        closeSession(worker, session.id);
+        return;
+    }
+
+    // Only ask for EPOLLOUT while the socket buffer is full
+    if (blocked == session.writable){
+        session.writable = !blocked;
+
+        epoll_event event{};
+        event.events = blocked ? EPOLLIN | EPOLLOUT : EPOLLIN;
+        event.data.u64 = session.id;
+        epoll_ctl(worker.epollFd, EPOLL_CTL_MOD, session.fd, &event);
+    }
+}
+
+uint64_t GameServer::nowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "ServerProtocol.h"
+#include "TetrisGame.h"
+#include "TimerWheel.h"
+
+// Runs remote players' games, so scores come from the server and not from the client.
+// Every worker thread has its own epoll set and timer wheel. The listening socket is shared
+// with EPOLLEXCLUSIVE, a connection stays on the worker that accepted it, so sessions are
+// never touched by two threads. Linux only.
+class GameServer{
+public:
+    // address is a TCP port or "unix:<socket path>". TCP only accepts local connections unless
+    // allInterfaces is set.
+    GameServer(const std::string& address, int workers, bool allInterfaces = false);
+    ~GameServer();
+
+    bool start();
+    void stop();
+
+    ServerStats getStats() const;
+
+private:
+    struct Session{
+        uint64_t id;
+        int fd;
+
+        std::unique_ptr<TetrisGame> game; // Until the first HELLO
+        uint64_t startedUs = 0;
+        uint64_t gravityDeadlineUs = 0;   // 0 while no gravity step is scheduled
+        uint32_t gravityGeneration = 0;   // Tag of the current gravity timer, older ones are ignored
+
+        std::vector<uint8_t> input, output;
+        bool writable = true; // False while waiting for EPOLLOUT
+    };
+
+    // Gravity step lateness, 10 us buckets up to 100 ms
+    static constexpr size_t LATENESS_BUCKETS = 10000;
+    static constexpr uint64_t LATENESS_BUCKET_US = 10;
+
+    struct Worker{
+        int index = 0;
+        int epollFd = -1;
+        std::thread thread;
+
+        std::unordered_map<uint64_t, std::unique_ptr<Session>> sessions;
+        uint64_t nextSessionId = 1; // 0 is the listening socket
+        std::unique_ptr<TimerWheel> timers;
+
+        // Written by the worker only, read by getStats from any thread
+        std::atomic<uint32_t> sessionCount{0};
+        std::atomic<uint64_t> gravityTicks{0};
+        std::atomic<uint64_t> latenessMaxUs{0};
+        std::unique_ptr<std::atomic<uint32_t>[]> lateness{new std::atomic<uint32_t>[LATENESS_BUCKETS + 1]()};
+    };
+
+    const std::string address;
+    const int workerCount;
+    const bool allInterfaces;
+    int listenFd = -1;
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::atomic<bool> running{false};
+    uint64_t startUs = 0;
+
+    bool listenOn();
+    void run(Worker& worker);
+
+    void accept(Worker& worker);
+    void onReadable(Worker& worker, Session& session);
+    void onWritable(Worker& worker, Session& session);
+    void closeSession(Worker& worker, uint64_t id);
+
+    // Returns false on a protocol error
+    bool handleMessages(Worker& worker, Session& session);
+    void startGame(Worker& worker, Session& session, int width, int height);
+    void onGravity(Worker& worker, uint64_t id, uint32_t generation, uint64_t nowUs);
+    void scheduleGravity(Worker& worker, Session& session, uint64_t deadlineUs);
+
+    void sendResult(Session& session, uint8_t type, const GameStepResult& result);
+    void sendStats(Session& session);
+    void flush(Worker& worker, Session& session);
+
+    static uint64_t nowUs();
+};
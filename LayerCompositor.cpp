@@ -0,0 +1,69 @@
+#include "LayerCompositor.h"
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+LayerCompositor::LayerCompositor(SDL_Renderer* renderer, std::shared_ptr<ResourceManager> resourceManager, int width,
+                                 int height, DrawFunction drawBackground, DrawFunction drawOverlay)
+        : renderer(renderer), resourceManager(std::move(resourceManager)), width(width), height(height),
+          drawBackground(std::move(drawBackground)), drawOverlay(std::move(drawOverlay)) {
+    createTextures();
+}
+
+LayerCompositor::~LayerCompositor() {
+    destroyTextures(true);
+}
+
+void LayerCompositor::createTextures() {
+    background = resourceManager->acquireRenderTarget(width, height, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET);
+    overlay = resourceManager->acquireRenderTarget(width, height, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET);
+    if (background == nullptr || overlay == nullptr){
+        destroyTextures(true);
+        throw std::runtime_error("Could not create layer texture: " + std::string(SDL_GetError()));
+    }
+
+    // Overlay is mostly transparent, the board has to show through
+    SDL_SetTextureBlendMode(overlay, SDL_BLENDMODE_BLEND);
+
+    backgroundDirty = true;
+    overlayDirty = true;
+}
+
+void LayerCompositor::destroyTextures(bool keepForReuse) {
+    resourceManager->releaseRenderTarget(background, keepForReuse);
+    resourceManager->releaseRenderTarget(overlay, keepForReuse);
+    background = nullptr;
+    overlay = nullptr;
+}
+
+void LayerCompositor::resize(int width, int height) {
+    this->width = width;
+    this->height = height;
+
+    // Textures of the old size would never be asked for again
+    destroyTextures(false);
+    createTextures();
+}
+
+void LayerCompositor::renderBackground() {
+    renderLayer(background, drawBackground, backgroundDirty);
+}
+
+void LayerCompositor::renderOverlay() {
+    renderLayer(overlay, drawOverlay, overlayDirty);
+}
+
+void LayerCompositor::renderLayer(SDL_Texture* layer, const DrawFunction& draw, bool& dirty) {
+    if (dirty){
+        SDL_SetRenderTarget(renderer, layer);
+        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+        SDL_RenderClear(renderer);
+
+        draw();
+
+        SDL_SetRenderTarget(renderer, NULL);
+        dirty = false;
+    }
+
+    SDL_RenderCopy(renderer, layer, NULL, NULL);
+}
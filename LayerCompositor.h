@@ -0,0 +1,41 @@
+#pragma once
+#include <SDL.h>
+#include <functional>
+#include <memory>
+#include "ResourceManager.h"
+
+// Caches the parts of the screen that do not change between frames in render target
+// textures. The background layer is drawn under the board, the overlay layer on top of it.
+// A layer is only re-rendered after it has been invalidated, otherwise it costs one copy.
+class LayerCompositor{
+public:
+    using DrawFunction = std::function<void()>;
+
+    LayerCompositor(SDL_Renderer* renderer, std::shared_ptr<ResourceManager> resourceManager, int width, int height,
+                    DrawFunction drawBackground, DrawFunction drawOverlay);
+    ~LayerCompositor();
+
+    void invalidateBackground() { backgroundDirty = true; }
+    void invalidateOverlay() { overlayDirty = true; }
+
+    // Render targets were lost or the output size changed
+    void resize(int width, int height);
+
+    void renderBackground();
+    void renderOverlay();
+
+private:
+    SDL_Renderer* renderer;
+    std::shared_ptr<ResourceManager> resourceManager; // Owns the layer textures' memory
+    int width, height;
+
+    DrawFunction drawBackground, drawOverlay;
+
+    SDL_Texture* background = nullptr;
+    SDL_Texture* overlay = nullptr;
+    bool backgroundDirty = true, overlayDirty = true;
+
+    void createTextures();
+    void destroyTextures(bool keepForReuse);
+    void renderLayer(SDL_Texture* layer, const DrawFunction& draw, bool& dirty);
+};
@@ -0,0 +1,187 @@
+#include "ObservationRing.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <new>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "Trace.h"
+
+using namespace ObservationRing;
+
+uint64_t ObservationRing::nowNs() {
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<uint64_t>(now.tv_sec) * 1000000000ull + now.tv_nsec;
+}
+
+ObservationPublisher::~ObservationPublisher() {
+    if (memory == nullptr) return;
+
+    header->closed.store(1, std::memory_order_release);
+    munmap(memory, bytes);
+    shm_unlink(name.c_str());
+}
+
+bool ObservationPublisher::open(const std::string& name, int BLOCKS_X, int BLOCKS_Y, uint32_t slots) {
+    if (BLOCKS_X > UINT16_MAX || BLOCKS_Y > UINT16_MAX){
+        std::cout << "Board too big to publish" << std::endl;
+        return false;
+    }
+
+    size_t cellBytes = static_cast<size_t>(BLOCKS_X) * BLOCKS_Y;
+    size_t slotSize = (sizeof(Record) + cellBytes + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+    slots = std::max<uint32_t>(MIN_SLOTS, std::min<size_t>(slots, MAX_BYTES / slotSize));
+    if (slotSize > UINT32_MAX){
+        std::cout << "Board too big to publish" << std::endl;
+        return false;
+    }
+
+    // A ring left by a run that crashed would still be mapped by its readers, start a new one
+    shm_unlink(name.c_str());
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0){
+        std::cout << "Could not create shared memory " << name << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    size_t size = sizeof(Header) + slots * slotSize;
+    void* mapped = MAP_FAILED;
+    if (ftruncate(fd, static_cast<off_t>(size)) == 0){
+        mapped = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (mapped == MAP_FAILED){
+        std::cout << "Could not map shared memory " << name << ": " << strerror(errno) << std::endl;
+        shm_unlink(name.c_str());
+        return false;
+    }
+
+    this->name = name;
+    this->memory = mapped;
+    this->bytes = size;
+    this->BLOCKS_X = BLOCKS_X;
+    this->BLOCKS_Y = BLOCKS_Y;
+    cells.assign(cellBytes, 0);
+
+    // The new segment is zeroed: every slot has sequence 0, which no record uses
+    header = new (memory) Header();
+    header->slotCount = slots;
+    header->slotSize = static_cast<uint32_t>(slotSize);
+    header->width = static_cast<uint16_t>(BLOCKS_X);
+    header->height = static_cast<uint16_t>(BLOCKS_Y);
+    header->version = VERSION;
+    header->published.store(0, std::memory_order_relaxed);
+    header->closed.store(0, std::memory_order_relaxed);
+
+    header->magic.store(MAGIC, std::memory_order_release);
+    return true;
+}
+
+void ObservationPublisher::beginGame(const TetrisGame& game) {
+    if (memory == nullptr) return;
+
+    this->game++;
+    step = 0;
+    cellsBoard = nullptr; // The new game's board may have been allocated where the old one was
+    write(game, {}, NEW_GAME);
+}
+
+void ObservationPublisher::publish(const TetrisGame& game, const GameStepResult& result) {
+    if (memory == nullptr) return;
+
+    uint8_t events = (result.locked ? LOCKED : 0) | (result.hardDrop ? HARD_DROP : 0) | (result.gameOver ? GAME_OVER : 0);
+    step++;
+    write(game, result, events);
+}
+
+void ObservationPublisher::write(const TetrisGame& game, const GameStepResult& result, uint8_t events) {
+    TRACE_ZONE("ObservationPublisher::write");
+    const Board& board = game.getBoard();
+    if (&board != cellsBoard || board.getGeneration() != cellsGeneration){
+        for (int y = 0; y < BLOCKS_Y; y++){
+            for (int x = 0; x < BLOCKS_X; x++){
+                cells[static_cast<size_t>(y) * BLOCKS_X + x] = static_cast<uint8_t>(board.get(x, y));
+            }
+        }
+        cellsBoard = &board;
+        cellsGeneration = board.getGeneration();
+    }
+
+    uint64_t n = ++sequence;
+    uint8_t* slots = static_cast<uint8_t*>(memory) + sizeof(Header);
+    Record& record = *reinterpret_cast<Record*>(slots + (n % header->slotCount) * header->slotSize);
+
+    record.sequence.store(n | WRITING, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    const Tetromino& block = game.getCurrentBlock();
+    record.game = this->game;
+    record.step = step;
+    record.points = game.getPoints();
+    record.piecesPlaced = game.getPiecesPlaced();
+    record.linesCleared = game.getLinesCleared();
+    record.blockType = static_cast<uint8_t>(block.getType());
+    record.blockRotation = static_cast<uint8_t>(block.getRotation());
+    record.blockX = static_cast<int16_t>(block.getX());
+    record.blockY = static_cast<int16_t>(block.getY());
+    record.nextType = static_cast<uint8_t>(game.getNextBlock().getType());
+    record.events = events;
+    record.linesClearedNow = static_cast<uint8_t>(result.linesCleared);
+    memcpy(record.cells(), cells.data(), cells.size());
+    record.publishNs = nowNs();
+
+    record.sequence.store(n, std::memory_order_release);
+    header->published.store(n, std::memory_order_release);
+}
+
+ObservationReader::~ObservationReader() {
+    if (memory != nullptr) munmap(memory, bytes);
+}
+
+bool ObservationReader::attach(const std::string& name) {
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0){
+        std::cout << "Could not open shared memory " << name << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    struct stat info;
+    void* mapped = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && static_cast<size_t>(info.st_size) >= sizeof(Header)){
+        mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (mapped == MAP_FAILED){
+        std::cout << "Could not map shared memory " << name << std::endl;
+        return false;
+    }
+
+    // Any process can create a segment by that name, nothing in the header is trusted. The layout
+    // is copied once checked, so a writer cannot change it under the reader afterwards.
+    const Header* mappedHeader = static_cast<const Header*>(mapped);
+    uint32_t mappedSlotCount = mappedHeader->slotCount, mappedSlotSize = mappedHeader->slotSize;
+    int mappedWidth = mappedHeader->width, mappedHeight = mappedHeader->height;
+    if (mappedHeader->magic.load(std::memory_order_acquire) != MAGIC || mappedHeader->version != VERSION ||
+        mappedSlotCount == 0 || mappedSlotSize % alignof(Record) != 0 ||
+        mappedSlotSize < sizeof(Record) + static_cast<size_t>(mappedWidth) * mappedHeight ||
+        sizeof(Header) + static_cast<size_t>(mappedSlotCount) * mappedSlotSize > static_cast<size_t>(info.st_size)){
+        std::cout << name << " is not an observation ring of this version" << std::endl;
+        munmap(mapped, info.st_size);
+        return false;
+    }
+
+    if (memory != nullptr) munmap(memory, bytes);
+    memory = mapped;
+    bytes = info.st_size;
+    header = mappedHeader;
+    slotCount = mappedSlotCount;
+    slotSize = mappedSlotSize;
+    width = mappedWidth;
+    height = mappedHeight;
+    return true;
+}
@@ -0,0 +1,153 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "TetrisGame.h"
+
+// Every step of a game published into POSIX shared memory, for readers in other processes (bots,
+// recorders, overlays) that map it and read the records in place. One writer, any number of
+// readers, and the writer never waits for them: a reader that falls more than a ring behind sees
+// that the records it wanted were overwritten and skips ahead.
+//
+// The segment is a header followed by slotCount slots of slotSize bytes. Record n (counting from
+// 1) goes into slot n % slotCount. A slot's sequence is n | WRITING while the writer fills it and n
+// once it is complete, and the header's published sequence is then set to n. Readers check the
+// slot sequence before and after reading a record, like a seqlock; if it changed the record was
+// torn and must be dropped.
+namespace ObservationRing {
+    constexpr uint32_t MAGIC = 0x314F5354; // "TSO1"
+    constexpr uint32_t VERSION = 1;
+    constexpr uint64_t WRITING = 1ull << 63;
+
+    constexpr size_t CACHE_LINE = 64;
+    constexpr uint32_t DEFAULT_SLOTS = 256;
+    constexpr uint32_t MIN_SLOTS = 4;
+    constexpr size_t MAX_BYTES = 64 << 20; // Fewer slots for boards so big the default would exceed it
+
+    enum Events : uint8_t{
+        LOCKED = 1 << 0,
+        HARD_DROP = 1 << 1,
+        GAME_OVER = 1 << 2,
+        NEW_GAME = 1 << 3,
+    };
+
+    struct Header{
+        std::atomic<uint32_t> magic; // Written last by the writer, checked first by readers
+        uint32_t version;
+        uint32_t slotCount;
+        uint32_t slotSize;
+        uint16_t width, height;
+        std::atomic<uint32_t> closed; // Set when the writer goes away
+
+        alignas(CACHE_LINE) std::atomic<uint64_t> published; // Newest complete record, 0 before the first
+    };
+
+    // Cells follow the record, row by row from the top, one TetrominoType per cell
+    struct Record{
+        std::atomic<uint64_t> sequence;
+        uint64_t publishNs; // CLOCK_MONOTONIC, comparable between processes
+        uint32_t game;      // Counts the games published by this writer
+        uint32_t step;      // Records of this game, 0 is the start of the game
+        int32_t points, piecesPlaced, linesCleared;
+        uint8_t blockType, blockRotation, nextType;
+        uint8_t events, linesClearedNow;
+        int16_t blockX, blockY;
+
+        const uint8_t* cells() const { return reinterpret_cast<const uint8_t*>(this + 1); }
+        uint8_t* cells() { return reinterpret_cast<uint8_t*>(this + 1); }
+    };
+
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "Shared memory needs lock free atomics");
+
+    uint64_t nowNs();
+}
+
+class ObservationPublisher{
+public:
+    ObservationPublisher() = default;
+    ~ObservationPublisher(); // Marks the ring closed and unlinks it, readers keep their mapping
+
+    ObservationPublisher(const ObservationPublisher&) = delete;
+    ObservationPublisher& operator=(const ObservationPublisher&) = delete;
+
+    // name is a shared memory name like "/tetris". Replaces a ring left behind by an earlier run.
+    bool open(const std::string& name, int BLOCKS_X, int BLOCKS_Y, uint32_t slots = ObservationRing::DEFAULT_SLOTS);
+
+    // Publishes the starting state of a new game
+    void beginGame(const TetrisGame& game);
+
+    // Call after every step of the game. Does not allocate or make system calls.
+    void publish(const TetrisGame& game, const GameStepResult& result);
+
+    uint64_t getPublished() const { return sequence; }
+
+private:
+    std::string name;
+    void* memory = nullptr;
+    size_t bytes = 0;
+    ObservationRing::Header* header = nullptr;
+    int BLOCKS_X = 0, BLOCKS_Y = 0;
+
+    uint64_t sequence = 0;
+    uint32_t game = 0, step = 0;
+
+    // Copy of the board, only rescanned when its generation changes
+    std::vector<uint8_t> cells;
+    const Board* cellsBoard = nullptr;
+    uint64_t cellsGeneration = 0;
+
+    void write(const TetrisGame& game, const GameStepResult& result, uint8_t events);
+};
+
+class ObservationReader{
+public:
+    ObservationReader() = default;
+    ~ObservationReader();
+
+    ObservationReader(const ObservationReader&) = delete;
+    ObservationReader& operator=(const ObservationReader&) = delete;
+
+    // False unless name is a ring of this version whose slots fit the segment and the board
+    bool attach(const std::string& name);
+
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    uint32_t getSlotCount() const { return slotCount; }
+
+    uint64_t getPublished() const { return header->published.load(std::memory_order_acquire); }
+    bool isClosed() const { return header->closed.load(std::memory_order_acquire) != 0; }
+
+    enum class Status{
+        OK,
+        NOT_YET,     // Not published yet
+        OVERWRITTEN, // The writer has lapped the reader, before or while reading
+    };
+
+    // Hands record n to visit in place, then checks that it was not overwritten meanwhile. Results
+    // of visit must be thrown away unless this returns OK.
+    template<typename Visit>
+    Status read(uint64_t n, Visit&& visit) const{
+        const ObservationRing::Record& record = slot(n);
+        uint64_t before = record.sequence.load(std::memory_order_acquire);
+        if (before != n) return (before & ~ObservationRing::WRITING) > n ? Status::OVERWRITTEN : Status::NOT_YET;
+
+        visit(record);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return record.sequence.load(std::memory_order_relaxed) == n ? Status::OK : Status::OVERWRITTEN;
+    }
+
+private:
+    void* memory = nullptr;
+    size_t bytes = 0;
+    const ObservationRing::Header* header = nullptr;
+    uint32_t slotCount = 0, slotSize = 0; // Checked against the mapping by attach
+    int width = 0, height = 0;
+
+    const ObservationRing::Record& slot(uint64_t n) const{
+        const uint8_t* slots = static_cast<const uint8_t*>(memory) + sizeof(ObservationRing::Header);
+        return *reinterpret_cast<const ObservationRing::Record*>(slots + (n % slotCount) * slotSize);
+    }
+};
@@ -0,0 +1,119 @@
+#include "ReplayMode.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include "FrameCapture.h"
+#include "SpectatorStream.h"
+#include "TetrisWindow.h"
+
+namespace {
+    constexpr int SEEK_MS = 5000;
+}
+
+int runReplay(SDL_Renderer* renderer, const std::shared_ptr<ResourceManager>& resourceManager,
+              int width, int height, int blockSize, const std::string& path, const std::string& capturePath) {
+    SpectatorReader reader;
+    if (!reader.open(path)) return 1;
+
+    std::unique_ptr<FrameCapture> capture;
+    if (!capturePath.empty()){
+        capture = std::make_unique<FrameCapture>(capturePath, width, height, FrameCapture::DEFAULT_FPS, true);
+        if (!capture->isOpen()) return 1;
+    }
+
+    // Only draws the recorded states, the window's own game never runs
+    TetrisWindow window(blockSize, reader.getWidth(), reader.getHeight(), width - 360, height - 80,
+                        nullptr, renderer, resourceManager, 0);
+
+    const int BOARD_X = width/2 - window.getWidth()/2;
+    const int BOARD_Y = height/2 - window.getHeight()/2;
+
+    using Clock = std::chrono::steady_clock;
+    auto lastTime = Clock::now();
+    auto startTime = lastTime;
+    double playbackMs = 0;
+    bool paused = false;
+    bool running = true;
+
+    while (running){
+        SDL_Event event;
+        while (SDL_PollEvent(&event)){
+            if (event.type == SDL_QUIT){
+                running = false;
+            }
+            else if (event.type == SDL_KEYDOWN){
+                SDL_Keycode key = event.key.keysym.sym;
+                if (key == SDLK_ESCAPE){
+                    running = false;
+                }
+                else if (key == SDLK_SPACE){
+                    paused = !paused;
+                }
+                else if (key == SDLK_LEFT || key == SDLK_RIGHT){
+                    playbackMs += key == SDLK_LEFT ? -SEEK_MS : SEEK_MS;
+                    playbackMs = std::max(0.0, std::min<double>(playbackMs, reader.getDurationMs()));
+                    reader.seek(playbackMs);
+                }
+            }
+        }
+
+        auto currentTime = Clock::now();
+        if (capture){
+            // Recording time instead of wall clock time, every frame is captured
+            if (playbackMs > reader.getDurationMs()) break;
+            reader.advanceTo(playbackMs);
+        }
+        else if (!paused){
+            playbackMs += std::chrono::duration<double, std::milli>(currentTime - lastTime).count();
+            playbackMs = std::min<double>(playbackMs, reader.getDurationMs());
+            reader.advanceTo(playbackMs);
+        }
+        lastTime = currentTime;
+
+        SDL_SetRenderTarget(renderer, NULL);
+        SDL_SetRenderDrawColor(renderer, 0, 23, 66, 255);
+        SDL_RenderClear(renderer);
+        resourceManager->drawImage(0, 0, width, height, Texture::BACKGROUND);
+
+        window.renderState(reader.getBoard(), reader.getCurrentBlock(), reader.getNextBlock());
+
+        SDL_Rect boardLoc = {BOARD_X, BOARD_Y, window.getWidth(), window.getHeight()};
+        SDL_RenderCopy(renderer, window.getTexture(), NULL, &boardLoc);
+
+        SDL_Rect previewLoc = {BOARD_X + window.getWidth() + 20, BOARD_Y + blockSize,
+                               window.getBlockPreviewWidth(), window.getBlockPreviewHeight()};
+        SDL_RenderCopy(renderer, window.getBlockPreviewTexture(), NULL, &previewLoc);
+
+        resourceManager->drawText(10, 10, "Score: " + std::to_string(reader.getPoints()),
+                                  FontSize::SMALL, {255, 255, 255, 255});
+        resourceManager->drawText(10, height - 20,
+                                  "Replay " + std::to_string(reader.getTimeMs() / 1000) + " / "
+                                  + std::to_string(reader.getDurationMs() / 1000) + " s"
+                                  + (paused ? "  PAUSED" : ""),
+                                  FontSize::X_SMALL, {255, 255, 255, 255});
+
+        if (reader.isGameOver()){
+            resourceManager->drawText(width/2, height/2 - 50, "GAME OVER", FontSize::LARGE, {255, 255, 255, 255}, true);
+        }
+
+        if (capture){
+            capture->capture(renderer);
+            SDL_RenderPresent(renderer);
+            playbackMs += 1000.0 / FrameCapture::DEFAULT_FPS;
+            continue;
+        }
+
+        SDL_RenderPresent(renderer);
+        SDL_Delay(10);
+    }
+
+    if (capture){
+        capture.reset(); // Waits for the writer
+
+        double seconds = std::chrono::duration<double>(Clock::now() - startTime).count();
+        std::cout << "Rendered " << reader.getDurationMs() / 1000.0 << " s of replay in " << seconds << " s ("
+                  << reader.getDurationMs() / 1000.0 / seconds << "x real time)" << std::endl;
+    }
+
+    return 0;
+}
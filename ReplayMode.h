@@ -0,0 +1,11 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <SDL.h>
+#include "ResourceManager.h"
+
+// Plays back a spectator stream recorded with --record. SPACE pauses, LEFT and RIGHT seek.
+// With a capturePath the whole stream is rendered into a FrameCapture as fast as possible,
+// one frame per 1/60 s of the recording, and the function returns at the end of the stream.
+int runReplay(SDL_Renderer* renderer, const std::shared_ptr<ResourceManager>& resourceManager,
+              int width, int height, int blockSize, const std::string& path, const std::string& capturePath = "");
@@ -1,8 +1,15 @@
 #include "ResourceManager.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
 #include <iostream>
+#include <iterator>
 #include "SDL_mixer.h"
+#include "Trace.h"
 
 ResourceManager::ResourceManager(SDL_Renderer* renderer) : renderer(renderer) {
+    TRACE_ZONE("ResourceManager::load");
 
     // Initialize all sounds
     if (Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 2048) != 0){
@@ -34,21 +41,12 @@ ResourceManager::ResourceManager(SDL_Renderer* renderer) : renderer(renderer) {
     }
 
 
-    // Fonts follow the pattern 16-32-64-xxx
-
-    std::string font_loc = "res/fonts/Minimal5x7.ttf";
-
-    for (int i = 0; i < static_cast<int>(FontSize::_LAST_INDEX); i++){
-        int fontSize = pow(2, (4+i));
-
-        TTF_Font* font = TTF_OpenFont(font_loc.c_str(), fontSize);
-
-        if (!font){
-            std::cout << "Failed to load fonts: " << TTF_GetError() << std::endl;
-            return;
-        }
-
-        fonts.insert(std::pair<FontSize, TTF_Font*>(static_cast<FontSize>(i), font));
+    // The font file is read once, every size is opened from memory when it is first drawn
+    std::ifstream fontFile(fontLocation, std::ios::binary);
+    fontData.assign(std::istreambuf_iterator<char>(fontFile), std::istreambuf_iterator<char>());
+    if (fontData.empty()){
+        std::cout << "Failed to load font: " << fontLocation << std::endl;
+        return;
     }
 
     if (!(IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG)){
@@ -61,6 +59,26 @@ ResourceManager::ResourceManager(SDL_Renderer* renderer) : renderer(renderer) {
 }
 
 ResourceManager::~ResourceManager() {
+    for (auto& texture : textures){
+        SDL_DestroyTexture(texture.second.texture);
+    }
+    for (auto& text : texts){
+        SDL_DestroyTexture(text.second.texture);
+    }
+    for (RenderTarget& target : renderTargets){
+        SDL_DestroyTexture(target.cached.texture);
+    }
+    for (auto& atlas : blockAtlases){
+        SDL_DestroyTexture(atlas.second.cached.texture);
+    }
+    for (auto& image : sourceImages){
+        SDL_FreeSurface(image.second);
+    }
+
+    for (auto& font : fonts){
+        TTF_CloseFont(font.second);
+    }
+
     Mix_FreeMusic(backgroundMusic);
 
     std::map<Sound, Mix_Chunk*>::iterator it;
@@ -72,47 +90,305 @@ ResourceManager::~ResourceManager() {
 }
 
 void ResourceManager::playSound(Sound sound) {
+    TRACE_ZONE("ResourceManager::playSound");
     if (soundEffects.at(sound) == nullptr) return;
 
     Mix_PlayChannel(-1, soundEffects.at(sound), 0);
 }
 
 void ResourceManager::drawText(int x, int y, const std::string &text, FontSize size, SDL_Color color, bool aroundCenter) {
-    SDL_Surface* textSurface = TTF_RenderText_Solid(fonts.at(size), text.c_str(), color);
-    SDL_Texture* textTexture = SDL_CreateTextureFromSurface(renderer, textSurface);
+    TRACE_ZONE("ResourceManager::drawText");
+    SDL_Texture* textTexture = getText(text, size, color);
+    if (textTexture == nullptr) return;
+
+    int w, h;
+    SDL_QueryTexture(textTexture, NULL, NULL, &w, &h);
 
     SDL_Rect dest;
     if (aroundCenter){
-        dest = { x -textSurface->w/2, y - textSurface->h/2, textSurface->w, textSurface->h };
+        dest = { x - w/2, y - h/2, w, h };
     }else{
-        dest = {x, y, textSurface->w, textSurface->h};
+        dest = {x, y, w, h};
     }
 
-
     SDL_RenderCopy(renderer, textTexture, NULL, &dest);
+}
+
+SDL_Texture* ResourceManager::getText(const std::string& text, FontSize size, SDL_Color color) {
+    std::string key = std::to_string(static_cast<int>(size)) + ":" + std::to_string(color.r) + "," + std::to_string(color.g)
+                      + "," + std::to_string(color.b) + "," + std::to_string(color.a) + ":" + text;
+
+    auto cached = texts.find(key);
+    if (cached != texts.end()){
+        cached->second.lastUse = ++useClock;
+        return cached->second.texture;
+    }
+
+    TTF_Font* font = getFont(size);
+    if (font == nullptr) return nullptr;
+
+    SDL_Surface* textSurface = TTF_RenderText_Solid(font, text.c_str(), color);
+    if (textSurface == nullptr) return nullptr;
+
+    // Strings that keep changing, like the score, would otherwise pile up
+    if (texts.size() >= MAX_CACHED_TEXTS){
+        auto oldest = std::min_element(texts.begin(), texts.end(), [](const auto& a, const auto& b){
+            return a.second.lastUse < b.second.lastUse;
+        });
+        SDL_DestroyTexture(oldest->second.texture);
+        memoryStats.textBytes -= oldest->second.bytes;
+        memoryStats.evictions++;
+        texts.erase(oldest);
+    }
+
+    size_t bytes;
+    SDL_Texture* textTexture = createTexture(textSurface, bytes);
     SDL_FreeSurface(textSurface);
-    SDL_DestroyTexture(textTexture);
+    if (textTexture == nullptr) return nullptr;
+
+    texts[key] = {textTexture, bytes, ++useClock};
+    memoryStats.textBytes += bytes;
+    accountPeak();
+    return textTexture;
 }
 
-void ResourceManager::drawImage(int x, int y, Texture texture, bool aroundCenter) {
-    SDL_Surface* imageSurface = IMG_Load(textureLocations.at(texture).c_str());
-    SDL_Texture* imageTexture = SDL_CreateTextureFromSurface(renderer, imageSurface);
+TTF_Font* ResourceManager::getFont(FontSize size) {
+    auto cached = fonts.find(size);
+    if (cached != fonts.end()) return cached->second;
 
-    SDL_Rect dest;
-    if (aroundCenter){
-        dest = { x -imageSurface->w/2, y - imageSurface->h/2, imageSurface->w, imageSurface->h };
-    }else{
-        dest = {x, y, imageSurface->w, imageSurface->h};
+    TRACE_ZONE("ResourceManager::openFont");
+
+    // Sizes follow the pattern 16-32-64-xxx
+    int pointSize = std::max(1, static_cast<int>(std::lround((16 << static_cast<int>(size)) * textScale)));
+
+    // Closing the font closes the RWops too, the data stays with fontData
+    SDL_RWops* source = SDL_RWFromConstMem(fontData.data(), fontData.size());
+    TTF_Font* font = TTF_OpenFontRW(source, 1, pointSize);
+    if (font == nullptr){
+        std::cout << "Failed to open font at " << pointSize << "pt: " << TTF_GetError() << std::endl;
+        return nullptr;
     }
 
-    SDL_RenderCopy(renderer, imageTexture, NULL, &dest);
-    SDL_FreeSurface(imageSurface);
-    SDL_DestroyTexture(imageTexture);
+    fonts.insert({size, font});
+    return font;
+}
+
+void ResourceManager::setTextScale(float scale) {
+    if (scale == textScale) return;
+    textScale = scale;
+
+    for (auto& font : fonts){
+        TTF_CloseFont(font.second);
+    }
+    fonts.clear();
+
+    for (auto& text : texts){
+        SDL_DestroyTexture(text.second.texture);
+        memoryStats.textBytes -= text.second.bytes;
+    }
+    texts.clear();
+}
+
+SDL_Texture* ResourceManager::getTexture(Texture texture) {
+    auto cached = textures.find(texture);
+    if (cached != textures.end()){
+        textureCacheStats.hits++;
+        cached->second.lastUse = ++useClock;
+        return cached->second.texture;
+    }
+
+    textureCacheStats.misses++;
+    TRACE_ZONE("ResourceManager::loadTexture");
+
+    SDL_Surface* image = IMG_Load(textureLocations.at(texture).c_str());
+    if (image == nullptr){
+        std::cout << "Failed to load texture: " << textureLocations.at(texture) << " (" << IMG_GetError() << ")" << std::endl;
+        return nullptr;
+    }
+
+    size_t bytes;
+    SDL_Texture* imageTexture = createTexture(image, bytes);
+    SDL_FreeSurface(image);
+    if (imageTexture == nullptr) return nullptr;
+
+    textures[texture] = {imageTexture, bytes, ++useClock};
+    textureCacheStats.cached = textures.size();
+    memoryStats.imageBytes += bytes;
+    accountPeak();
+    return imageTexture;
+}
+
+SDL_Texture* ResourceManager::createTexture(SDL_Surface* surface, size_t& bytes) {
+    // The renderer picks a 32 bit format for surfaces, the real size is known once it exists
+    bytes = static_cast<size_t>(surface->w) * surface->h * 4;
+    if (!makeRoom(bytes)){
+        memoryStats.refused++;
+        if (memoryStats.refused == 1){
+            std::cout << "Texture of " << bytes / 1024 << " KB does not fit the texture budget of "
+                      << memoryStats.budgetBytes / 1024 << " KB" << std::endl;
+        }
+        return nullptr;
+    }
+
+    SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
+    if (texture == nullptr){
+        std::cout << "Failed to create texture: " << SDL_GetError() << std::endl;
+        return nullptr;
+    }
+
+    Uint32 format;
+    int w, h;
+    SDL_QueryTexture(texture, &format, NULL, &w, &h);
+    bytes = static_cast<size_t>(w) * h * SDL_BYTESPERPIXEL(format);
+    return texture;
+}
+
+void ResourceManager::setTextureBudget(size_t bytes) {
+    memoryStats.budgetBytes = bytes;
+    makeRoom(0);
+}
+
+bool ResourceManager::makeRoom(size_t bytes) {
+    if (memoryStats.budgetBytes == 0) return true;
+
+    // Render targets and atlases in use stay, if they leave no room there is no point in evicting the rest
+    size_t pinned = 0;
+    for (const RenderTarget& target : renderTargets){
+        if (target.inUse) pinned += target.cached.bytes;
+    }
+    for (const auto& atlas : blockAtlases){
+        if (atlas.second.users > 0) pinned += atlas.second.cached.bytes;
+    }
+    if (pinned + bytes > memoryStats.budgetBytes) return false;
+
+    while (memoryStats.totalBytes() + bytes > memoryStats.budgetBytes){
+        if (!evictLeastRecentlyUsed()) return false;
+    }
+    return true;
+}
+
+bool ResourceManager::evictLeastRecentlyUsed() {
+    // Few enough textures that looking through all of them is cheaper than keeping them ordered
+    CachedTexture* oldest = nullptr;
+    for (auto& texture : textures){
+        if (!oldest || texture.second.lastUse < oldest->lastUse) oldest = &texture.second;
+    }
+    for (auto& text : texts){
+        if (!oldest || text.second.lastUse < oldest->lastUse) oldest = &text.second;
+    }
+    for (RenderTarget& target : renderTargets){
+        if (target.inUse) continue;
+        if (!oldest || target.cached.lastUse < oldest->lastUse) oldest = &target.cached;
+    }
+    for (auto& atlas : blockAtlases){
+        if (atlas.second.users > 0) continue;
+        if (!oldest || atlas.second.cached.lastUse < oldest->lastUse) oldest = &atlas.second.cached;
+    }
+    if (oldest == nullptr) return false;
+
+    SDL_DestroyTexture(oldest->texture);
+    memoryStats.evictions++;
+
+    for (auto it = textures.begin(); it != textures.end(); it++){
+        if (&it->second != oldest) continue;
+        memoryStats.imageBytes -= oldest->bytes;
+        textures.erase(it);
+        textureCacheStats.cached = textures.size();
+        return true;
+    }
+    for (auto it = texts.begin(); it != texts.end(); it++){
+        if (&it->second != oldest) continue;
+        memoryStats.textBytes -= oldest->bytes;
+        texts.erase(it);
+        return true;
+    }
+    for (auto it = renderTargets.begin(); it != renderTargets.end(); it++){
+        if (&it->cached != oldest) continue;
+        memoryStats.renderTargetBytes -= oldest->bytes;
+        renderTargets.erase(it);
+        return true;
+    }
+    for (auto it = blockAtlases.begin(); it != blockAtlases.end(); it++){
+        if (&it->second.cached != oldest) continue;
+        memoryStats.imageBytes -= oldest->bytes;
+        blockAtlases.erase(it);
+        return true;
+    }
+    return true;
+}
+
+void ResourceManager::accountPeak() {
+    memoryStats.peakBytes = std::max(memoryStats.peakBytes, memoryStats.totalBytes());
+}
+
+SDL_Texture* ResourceManager::acquireRenderTarget(int width, int height, Uint32 format, int access) {
+    for (RenderTarget& target : renderTargets){
+        if (target.inUse || target.width != width || target.height != height
+            || target.format != format || target.access != access) continue;
+
+        // Same state as a new texture, the previous owner may have changed it
+        SDL_SetTextureBlendMode(target.cached.texture, target.blendMode);
+        target.inUse = true;
+        target.cached.lastUse = ++useClock;
+        memoryStats.renderTargetsReused++;
+        return target.cached.texture;
+    }
+
+    size_t bytes = static_cast<size_t>(width) * height * SDL_BYTESPERPIXEL(format);
+    if (!makeRoom(bytes)){
+        while (evictLeastRecentlyUsed()){}
+        memoryStats.overBudget++;
+        std::cout << "Render target of " << bytes / 1024 << " KB goes over the texture budget of "
+                  << memoryStats.budgetBytes / 1024 << " KB" << std::endl;
+    }
+
+    SDL_Texture* texture = SDL_CreateTexture(renderer, format, access, width, height);
+    if (texture == nullptr) return nullptr;
+
+    SDL_BlendMode blendMode;
+    SDL_GetTextureBlendMode(texture, &blendMode);
+    renderTargets.push_back({{texture, bytes, ++useClock}, width, height, format, access, blendMode, true});
+    memoryStats.renderTargetBytes += bytes;
+    memoryStats.renderTargetsCreated++;
+    accountPeak();
+    return texture;
+}
+
+void ResourceManager::releaseRenderTarget(SDL_Texture* texture, bool keepForReuse) {
+    if (texture == nullptr) return;
+
+    for (auto it = renderTargets.begin(); it != renderTargets.end(); it++){
+        if (it->cached.texture != texture) continue;
+
+        if (keepForReuse){
+            it->inUse = false;
+            it->cached.lastUse = ++useClock;
+        }
+        else{
+            SDL_DestroyTexture(texture);
+            memoryStats.renderTargetBytes -= it->cached.bytes;
+            renderTargets.erase(it);
+        }
+        return;
+    }
+
+    SDL_DestroyTexture(texture);
+}
+
+void ResourceManager::drawImage(int x, int y, Texture texture, bool aroundCenter, float scale) {
+    SDL_Texture* imageTexture = getTexture(texture);
+    if (imageTexture == nullptr) return;
+
+    int w, h;
+    SDL_QueryTexture(imageTexture, NULL, NULL, &w, &h);
+
+    drawImage(x, y, std::lround(w * scale), std::lround(h * scale), texture, aroundCenter);
 }
 
 void ResourceManager::drawImage(int x, int y, int w, int h, Texture texture, bool aroundCenter) {
-    SDL_Surface* imageSurface = IMG_Load(textureLocations.at(texture).c_str());
-    SDL_Texture* imageTexture = SDL_CreateTextureFromSurface(renderer, imageSurface);
+    TRACE_ZONE("ResourceManager::drawImage");
+    SDL_Texture* imageTexture = getTexture(texture);
+    if (imageTexture == nullptr) return;
 
     SDL_Rect dest;
     if (aroundCenter){
@@ -122,7 +398,113 @@ void ResourceManager::drawImage(int x, int y, int w, int h, Texture texture, boo
     }
 
     SDL_RenderCopy(renderer, imageTexture, NULL, &dest);
-    SDL_FreeSurface(imageSurface);
-    SDL_DestroyTexture(imageTexture);
+}
+
+bool ResourceManager::loadSprite(Texture texture, int width, int height, Sprite& sprite) {
+    TRACE_ZONE("ResourceManager::loadSprite");
+    SDL_Surface* image = getSourceImage(texture);
+    if (image == nullptr) return false;
+
+    SDL_Surface* scaled = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, SDL_PIXELFORMAT_ARGB8888);
+    if (scaled == nullptr){
+        std::cout << "Failed to create surface: " << SDL_GetError() << std::endl;
+        return false;
+    }
+
+    // Blended over black like the renderer does, the rasterizer copies pixels without blending
+    blitScaledOverBlack(image, scaled, 0, 0, width, height);
+
+    sprite.width = width;
+    sprite.height = height;
+    sprite.pixels.resize(static_cast<size_t>(width) * height);
+
+    SDL_LockSurface(scaled);
+    for (int y = 0; y < height; y++){
+        const uint8_t* row = static_cast<const uint8_t*>(scaled->pixels) + y * scaled->pitch;
+        memcpy(sprite.pixels.data() + static_cast<size_t>(y) * width, row, width * sizeof(uint32_t));
+    }
+    SDL_UnlockSurface(scaled);
+    SDL_FreeSurface(scaled);
+
+    return true;
+}
+
+SDL_Texture* ResourceManager::acquireBlockAtlas(int cellSize) {
+    auto cached = blockAtlases.find(cellSize);
+    if (cached != blockAtlases.end()){
+        textureCacheStats.hits++;
+        cached->second.cached.lastUse = ++useClock;
+        cached->second.users++;
+        return cached->second.cached.texture;
+    }
+
+    textureCacheStats.misses++;
+    TRACE_ZONE("ResourceManager::buildBlockAtlas");
+
+    // Sizes seen while a window is dragged bigger are not needed again
+    auto oldest = blockAtlases.end();
+    for (auto it = blockAtlases.begin(); it != blockAtlases.end(); it++){
+        if (it->second.users > 0) continue;
+        if (oldest == blockAtlases.end() || it->second.cached.lastUse < oldest->second.cached.lastUse) oldest = it;
+    }
+    if (blockAtlases.size() >= MAX_CACHED_ATLASES && oldest != blockAtlases.end()){
+        SDL_DestroyTexture(oldest->second.cached.texture);
+        memoryStats.imageBytes -= oldest->second.cached.bytes;
+        memoryStats.evictions++;
+        blockAtlases.erase(oldest);
+    }
+
+    int blocks = static_cast<int>(LAST_BLOCK) - static_cast<int>(FIRST_BLOCK) + 1;
+    SDL_Surface* atlas = SDL_CreateRGBSurfaceWithFormat(0, blocks * cellSize, cellSize, 32, SDL_PIXELFORMAT_ARGB8888);
+    if (atlas == nullptr){
+        std::cout << "Failed to create surface: " << SDL_GetError() << std::endl;
+        return nullptr;
+    }
+
+    SDL_FillRect(atlas, NULL, 0xFF000000);
+    for (int i = 0; i < blocks; i++){
+        Texture block = static_cast<Texture>(static_cast<int>(FIRST_BLOCK) + i);
+        SDL_Surface* image = getSourceImage(block);
+        if (image != nullptr) blitScaledOverBlack(image, atlas, i * cellSize, 0, cellSize, cellSize);
+    }
+
+    size_t bytes;
+    SDL_Texture* atlasTexture = createTexture(atlas, bytes);
+    SDL_FreeSurface(atlas);
+    if (atlasTexture == nullptr) return nullptr;
+
+    blockAtlases[cellSize] = {{atlasTexture, bytes, ++useClock}, 1};
+    memoryStats.imageBytes += bytes;
+    accountPeak();
+    return atlasTexture;
+}
+
+void ResourceManager::releaseBlockAtlas(int cellSize) {
+    auto cached = blockAtlases.find(cellSize);
+    if (cached != blockAtlases.end() && cached->second.users > 0) cached->second.users--;
+}
+
+SDL_Rect ResourceManager::blockAtlasRect(Texture block, int cellSize) {
+    return {(static_cast<int>(block) - static_cast<int>(FIRST_BLOCK)) * cellSize, 0, cellSize, cellSize};
+}
+
+SDL_Surface* ResourceManager::getSourceImage(Texture texture) {
+    auto cached = sourceImages.find(texture);
+    if (cached != sourceImages.end()) return cached->second;
+
+    TRACE_ZONE("ResourceManager::loadImage");
+    SDL_Surface* image = IMG_Load(textureLocations.at(texture).c_str());
+    if (image == nullptr){
+        std::cout << "Failed to load image: " << textureLocations.at(texture) << " (" << IMG_GetError() << ")" << std::endl;
+        return nullptr;
+    }
+
+    sourceImages[texture] = image;
+    return image;
+}
 
+void ResourceManager::blitScaledOverBlack(SDL_Surface* image, SDL_Surface* target, int x, int y, int width, int height) {
+    SDL_Rect dest = {x, y, width, height};
+    SDL_FillRect(target, &dest, 0xFF000000);
+    SDL_BlitScaled(image, NULL, target, &dest);
 }
@@ -1,9 +1,11 @@
 #pragma once
 #include <map>
 #include <string>
+#include <vector>
 #include <SDL_image.h>
 #include <SDL_mixer.h>
 #include <SDL_ttf.h>
+#include "BoardRasterizer.h"
 
 enum class Sound{
     CLEAR_ROW,
@@ -33,6 +35,31 @@ enum class Texture{
     BLOCK_Z,
 };
 
+struct TextureCacheStats{
+    int hits = 0;
+    int misses = 0;
+    int cached = 0;
+};
+
+// Bytes of texture memory held, by kind of texture. Images and text are reloaded when they are
+// needed again, so they are evicted least recently used first when a budget is set. Render
+// targets in use are never evicted, released ones are kept for reuse until there is no room.
+struct TextureMemoryStats{
+    size_t imageBytes = 0;
+    size_t textBytes = 0;
+    size_t renderTargetBytes = 0; // In use and kept for reuse
+    size_t peakBytes = 0;
+    size_t budgetBytes = 0;       // 0 is no budget
+
+    int evictions = 0;
+    int renderTargetsCreated = 0;
+    int renderTargetsReused = 0;
+    int refused = 0;    // Textures not created because they would not fit in the budget
+    int overBudget = 0; // Render targets created anyway, see acquireRenderTarget
+
+    size_t totalBytes() const { return imageBytes + textBytes + renderTargetBytes; }
+};
+
 
 class ResourceManager{
 public:
@@ -41,12 +68,40 @@ public:
 
     void playSound(Sound sound);
     void drawText(int x, int y, const std::string& text, FontSize size, SDL_Color color, bool aroundCenter = false);
-    void drawImage(int x, int y, Texture texture, bool aroundCenter = false);
+    void drawImage(int x, int y, Texture texture, bool aroundCenter = false, float scale = 1);
     void drawImage(int x, int y, int w, int h, Texture texture, bool aroundCenter = false);
 
+    // Loads an image scaled to width x height as ARGB8888 pixels, for drawing on the CPU
+    bool loadSprite(Texture texture, int width, int height, Sprite& sprite);
+
+    // Every block image scaled once to cellSize x cellSize, blended over black, side by side in
+    // one texture, so cells are drawn without scaling and all from the same texture. The last few
+    // sizes are kept. Null if it could not be created. The atlas is not evicted until it is handed
+    // back with releaseBlockAtlas, don't keep it past that.
+    SDL_Texture* acquireBlockAtlas(int cellSize);
+    void releaseBlockAtlas(int cellSize);
+    static SDL_Rect blockAtlasRect(Texture block, int cellSize);
+
+    // Text is rendered with fonts this much bigger, e.g. on HiDPI screens. Changing it drops the
+    // cached fonts and text.
+    void setTextScale(float scale);
+
 
     bool isInitialized() const{ return initSuccess;}
 
+    const TextureCacheStats& getTextureCacheStats() const { return textureCacheStats; }
+    const TextureMemoryStats& getTextureMemoryStats() const { return memoryStats; }
+
+    // Evicts textures until everything fits, later textures that would not fit are not created
+    void setTextureBudget(size_t bytes);
+
+    // Render targets (or streaming textures) are handed back with releaseRenderTarget and given
+    // out again to the next request of the same size and format. Nothing can be drawn without
+    // them, so one that does not fit the budget is still created once everything else is evicted.
+    // Null only if SDL could not create it.
+    SDL_Texture* acquireRenderTarget(int width, int height, Uint32 format, int access);
+    void releaseRenderTarget(SDL_Texture* texture, bool keepForReuse = true);
+
 private:
     bool initSuccess = false;
 
@@ -73,6 +128,63 @@ private:
 
     Mix_Music* backgroundMusic;
 
-    std::map<FontSize, TTF_Font*> fonts;
+    struct CachedTexture{
+        SDL_Texture* texture = nullptr;
+        size_t bytes = 0;
+        uint64_t lastUse = 0;
+    };
+
+    struct RenderTarget{
+        CachedTexture cached;
+        int width, height;
+        Uint32 format;
+        int access;
+        SDL_BlendMode blendMode; // What SDL gave the texture when it was created
+        bool inUse;
+    };
+
+    std::map<Texture, CachedTexture> textures;
+    TextureCacheStats textureCacheStats;
+
+    // Text is drawn from a texture as long as the same string, size and color come up again
+    static constexpr size_t MAX_CACHED_TEXTS = 32;
+    std::map<std::string, CachedTexture> texts;
+
+    std::vector<RenderTarget> renderTargets;
+
+    static constexpr Texture FIRST_BLOCK = Texture::BLOCK_I, LAST_BLOCK = Texture::BLOCK_Z;
+    static constexpr size_t MAX_CACHED_ATLASES = 4;
+    struct BlockAtlas{
+        CachedTexture cached;
+        int users = 0; // Acquired and not released yet, never evicted while above 0
+    };
+    std::map<int, BlockAtlas> blockAtlases; // By cell size
+
+    // Decoded images kept for scaling to new sizes without reading the files again
+    std::map<Texture, SDL_Surface*> sourceImages;
+    SDL_Surface* getSourceImage(Texture texture);
+
+    // Scales image to width x height over black into an ARGB8888 surface at x, y
+    static void blitScaledOverBlack(SDL_Surface* image, SDL_Surface* target, int x, int y, int width, int height);
+
+    TextureMemoryStats memoryStats;
+    uint64_t useClock = 0;
+
+    SDL_Texture* getTexture(Texture texture);
+    SDL_Texture* getText(const std::string& text, FontSize size, SDL_Color color);
+
+    // Creates a texture from surface if it fits, accounted in bytes
+    SDL_Texture* createTexture(SDL_Surface* surface, size_t& bytes);
+    bool makeRoom(size_t bytes);
+    bool evictLeastRecentlyUsed();
+    void accountPeak();
+
+    const std::string fontLocation = "res/fonts/Minimal5x7.ttf";
+    std::vector<char> fontData;
+
+    std::map<FontSize, TTF_Font*> fonts; // Opened on first use
+    float textScale = 1;
+
+    TTF_Font* getFont(FontSize size);
     SDL_Renderer* renderer;
 };
\ No newline at end of file
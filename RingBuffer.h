@@ -0,0 +1,39 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+// Single producer, single consumer lock-free ring buffer.
+// The producer never blocks: push() fails when the consumer has fallen behind.
+template<typename T, size_t CAPACITY>
+class RingBuffer{
+    static_assert(CAPACITY > 0 && (CAPACITY & (CAPACITY - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    bool push(const T& item){
+        size_t head = headIndex.load(std::memory_order_relaxed);
+        if (head - tailIndex.load(std::memory_order_acquire) == CAPACITY) return false;
+
+        buffer[head & (CAPACITY - 1)] = item;
+        headIndex.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& item){
+        size_t tail = tailIndex.load(std::memory_order_relaxed);
+        if (tail == headIndex.load(std::memory_order_acquire)) return false;
+
+        item = buffer[tail & (CAPACITY - 1)];
+        tailIndex.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    static constexpr size_t capacity() { return CAPACITY; }
+
+private:
+    std::array<T, CAPACITY> buffer;
+
+    // Kept on separate cache lines so producer and consumer don't false share
+    alignas(64) std::atomic<size_t> headIndex{0};
+    alignas(64) std::atomic<size_t> tailIndex{0};
+};
@@ -0,0 +1,294 @@
+#include "RollbackSession.h"
+#include <algorithm>
+#include <chrono>
+#include "Trace.h"
+
+namespace {
+    enum PacketType : uint8_t{
+        PACKET_SYNC = 1,
+        PACKET_INPUT = 2,
+        PACKET_CHECKSUM = 3,
+    };
+
+    constexpr int MAX_INPUTS_PER_PACKET = 64;
+
+    uint64_t nowUs(){
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // Little endian on the wire, whatever the host is
+    void put32(uint8_t* out, uint32_t value){
+        for (int i = 0; i < 4; i++) out[i] = value >> (8 * i);
+    }
+
+    uint32_t get32(const uint8_t* in){
+        uint32_t value = 0;
+        for (int i = 0; i < 4; i++) value |= static_cast<uint32_t>(in[i]) << (8 * i);
+        return value;
+    }
+
+    void put64(uint8_t* out, uint64_t value){
+        put32(out, value);
+        put32(out + 4, value >> 32);
+    }
+
+    uint64_t get64(const uint8_t* in){
+        return get32(in) | static_cast<uint64_t>(get32(in + 4)) << 32;
+    }
+
+    void mergeEvents(GameStepResult& into, const GameStepResult& result){
+        into.locked |= result.locked;
+        into.hardDrop |= result.hardDrop;
+        into.linesCleared += result.linesCleared;
+        into.gameOver |= result.gameOver;
+    }
+}
+
+RollbackSession::RollbackSession(UdpSocket& socket, int BLOCKS_X, int BLOCKS_Y)
+        : socket(socket), BLOCKS_X(BLOCKS_X), BLOCKS_Y(BLOCKS_Y),
+          state{{TetrisGame(BLOCKS_X, BLOCKS_Y, 0), 0}, {TetrisGame(BLOCKS_X, BLOCKS_Y, 0), 0}},
+          lastReceiveUs(nowUs()) {
+}
+
+bool RollbackSession::synchronize(uint32_t proposedSeed) {
+    if (started) return true;
+
+    if (!sawPeer) seed = proposedSeed;
+    receivePackets();
+
+    if (!started && sawPeer && peerSawUs){
+        started = true;
+
+        state.local = {TetrisGame(BLOCKS_X, BLOCKS_Y, seed), gravityFrames(0)};
+        state.remote = {TetrisGame(BLOCKS_X, BLOCKS_Y, seed), gravityFrames(0)};
+        snapshots.assign(MAX_ROLLBACK + 2, state);
+    }
+
+    sendSync();
+    return started;
+}
+
+bool RollbackSession::advanceFrame(FrameInput localInput, GameStepResult& localEvents) {
+    TRACE_ZONE("RollbackSession::advanceFrame");
+    localEvents = {};
+
+    receivePackets();
+    if (!started) return false;
+
+    // Never predict further ahead than the snapshots reach, wait for the peer instead
+    if (currentFrame - remoteConfirmed >= MAX_ROLLBACK){
+        stats.stalledFrames++;
+        sendInputs();
+        return false;
+    }
+
+    if (rollbackFrame != -1){
+        TRACE_ZONE("RollbackSession::rollback");
+        TRACE_COUNTER("rollback_depth", currentFrame - rollbackFrame);
+        uint64_t start = nowUs();
+
+        state = snapshots[rollbackFrame % snapshots.size()];
+        for (int frame = rollbackFrame; frame < currentFrame; frame++){
+            snapshots[frame % snapshots.size()] = state;
+            simulateFrame(state, frame, nullptr);
+        }
+
+        stats.lastRollbackDepth = currentFrame - rollbackFrame;
+        stats.lastResimulationUs = nowUs() - start;
+        stats.maxRollbackDepth = std::max(stats.maxRollbackDepth, stats.lastRollbackDepth);
+        stats.maxResimulationUs = std::max(stats.maxResimulationUs, stats.lastResimulationUs);
+        stats.totalResimulationUs += stats.lastResimulationUs;
+        stats.rollbacks++;
+        stats.resimulatedFrames += stats.lastRollbackDepth;
+
+        rollbackFrame = -1;
+    }
+    else{
+        stats.lastRollbackDepth = 0;
+        stats.lastResimulationUs = 0;
+    }
+
+    localInputs.push_back(localInput);
+
+    snapshots[currentFrame % snapshots.size()] = state;
+    simulateFrame(state, currentFrame, &localEvents);
+    currentFrame++;
+
+    updateChecksums();
+    sendInputs();
+
+    stats.frame = currentFrame;
+    stats.confirmedFrame = remoteConfirmed;
+    return true;
+}
+
+double RollbackSession::getSilenceSeconds() const {
+    return (nowUs() - lastReceiveUs) / 1e6;
+}
+
+FrameInput RollbackSession::remoteInputFor(int frame) const {
+    // Prediction: nothing pressed. Most frames have no input, and repeating the last
+    // input would repeat a move or a drop.
+    if (frame < static_cast<int>(remoteInputs.size()) && remoteInputs[frame] != -1){
+        return remoteInputs[frame];
+    }
+    return 0;
+}
+
+void RollbackSession::simulateFrame(MatchState& match, int frame, GameStepResult* localEvents) {
+    if (static_cast<int>(usedRemoteInputs.size()) <= frame) usedRemoteInputs.resize(frame + 1);
+
+    FrameInput remoteInput = remoteInputFor(frame);
+    usedRemoteInputs[frame] = remoteInput;
+
+    simulatePlayer(match.local, localInputs[frame], localEvents);
+    simulatePlayer(match.remote, remoteInput, nullptr);
+}
+
+void RollbackSession::simulatePlayer(PlayerState& player, FrameInput input, GameStepResult* events) {
+    GameStepResult result;
+
+    for (int i = 0; i <= static_cast<int>(GameInput::HARD_DROP); i++){
+        GameInput gameInput = static_cast<GameInput>(i);
+        if (input & inputBit(gameInput)){
+            mergeEvents(result, player.game.applyInput(gameInput));
+        }
+    }
+
+    if (--player.gravityCountdown <= 0){
+        mergeEvents(result, player.game.gameLoop());
+        player.gravityCountdown = gravityFrames(player.game.getPoints());
+    }
+
+    if (events != nullptr) mergeEvents(*events, result);
+}
+
+int RollbackSession::gravityFrames(int points) {
+    // Same speed as TetrisGame::gravityInterval, in whole frames so both peers agree exactly
+    return std::max(1, FRAMES_PER_SECOND * 1000 / (points + 3000));
+}
+
+void RollbackSession::receivePackets() {
+    uint8_t packet[512];
+    int size;
+
+    while ((size = socket.receive(packet, sizeof(packet))) > 0){
+        lastReceiveUs = nowUs();
+
+        if (packet[0] == PACKET_SYNC && size >= 6){
+            uint32_t peerSeed = get32(packet + 1);
+
+            sawPeer = true;
+            peerSawUs |= packet[5] != 0;
+            if (!started) seed = std::min(seed, peerSeed);
+
+            // Peer is still waiting for us
+            if (started && packet[5] == 0) sendSync();
+        }
+        else if (packet[0] == PACKET_INPUT && size >= 10){
+            int firstFrame = static_cast<int32_t>(get32(packet + 1));
+            int confirmed = static_cast<int32_t>(get32(packet + 6));
+            int count = std::min<int>(packet[5], size - 10);
+
+            // The peer stalls before it gets MAX_ROLLBACK frames ahead of the inputs it has from
+            // us, and cannot confirm inputs we never sent. Anything else is not from a real peer.
+            if (firstFrame < 0 || firstFrame > currentFrame + MAX_ROLLBACK - count) continue;
+            if (confirmed < 0 || confirmed > static_cast<int>(localInputs.size())) continue;
+
+            // Inputs only come once the peer has started, so it saw our sync
+            peerSawUs = true;
+            peerConfirmed = std::max(peerConfirmed, confirmed);
+
+            if (!started) continue;
+            for (int i = std::max(0, remoteConfirmed - firstFrame); i < count; i++){
+                onRemoteInput(firstFrame + i, packet[10 + i]);
+            }
+        }
+        else if (packet[0] == PACKET_CHECKSUM && size >= 13 && started){
+            // Checksums are only sent for frames whose inputs the peer has from us
+            int frame = static_cast<int32_t>(get32(packet + 1));
+            if (frame <= 0 || frame % CHECKSUM_INTERVAL != 0 || frame > currentFrame) continue;
+
+            onPeerChecksum(frame, get64(packet + 5));
+        }
+    }
+}
+
+void RollbackSession::onRemoteInput(int frame, FrameInput input) {
+    if (static_cast<int>(remoteInputs.size()) <= frame) remoteInputs.resize(frame + 1, -1);
+    if (remoteInputs[frame] != -1) return;
+
+    remoteInputs[frame] = input;
+
+    if (frame < currentFrame && usedRemoteInputs[frame] != input){
+        rollbackFrame = rollbackFrame == -1 ? frame : std::min(rollbackFrame, frame);
+    }
+
+    while (remoteConfirmed < static_cast<int>(remoteInputs.size()) && remoteInputs[remoteConfirmed] != -1){
+        remoteConfirmed++;
+    }
+}
+
+void RollbackSession::sendInputs() {
+    int first = std::max(peerConfirmed, static_cast<int>(localInputs.size()) - MAX_INPUTS_PER_PACKET);
+    int count = static_cast<int>(localInputs.size()) - first;
+
+    uint8_t packet[10 + MAX_INPUTS_PER_PACKET];
+    packet[0] = PACKET_INPUT;
+    put32(packet + 1, first);
+    packet[5] = count;
+    put32(packet + 6, remoteConfirmed);
+    std::copy(localInputs.begin() + first, localInputs.end(), packet + 10);
+
+    socket.send(packet, 10 + count);
+}
+
+void RollbackSession::sendSync() {
+    uint8_t packet[6];
+    packet[0] = PACKET_SYNC;
+    put32(packet + 1, seed);
+    packet[5] = sawPeer;
+
+    socket.send(packet, sizeof(packet));
+}
+
+void RollbackSession::updateChecksums() {
+    // The state before frame f is final once every remote input before f is known
+    int finalFrame = std::min(remoteConfirmed, currentFrame - 1);
+    if (rollbackFrame != -1) finalFrame = std::min(finalFrame, rollbackFrame);
+
+    int next = (checksummedFrame / CHECKSUM_INTERVAL + 1) * CHECKSUM_INTERVAL;
+    for (int frame = next; frame <= finalFrame; frame += CHECKSUM_INTERVAL){
+        const MatchState& snapshot = snapshots[frame % snapshots.size()];
+        size_t index = frame / CHECKSUM_INTERVAL;
+
+        if (remoteChecksums.size() <= index) remoteChecksums.resize(index + 1, 0);
+        remoteChecksums[index] = snapshot.remote.game.checksum();
+
+        if (index < pendingPeerChecksums.size() && pendingPeerChecksums[index] != 0){
+            onPeerChecksum(frame, pendingPeerChecksums[index]);
+        }
+
+        uint8_t packet[13];
+        packet[0] = PACKET_CHECKSUM;
+        put32(packet + 1, frame);
+        put64(packet + 5, snapshot.local.game.checksum());
+        socket.send(packet, sizeof(packet));
+
+        checksummedFrame = frame;
+    }
+}
+
+void RollbackSession::onPeerChecksum(int frame, uint64_t checksum) {
+    size_t index = frame / CHECKSUM_INTERVAL;
+
+    if (index >= remoteChecksums.size() || remoteChecksums[index] == 0){
+        if (pendingPeerChecksums.size() <= index) pendingPeerChecksums.resize(index + 1, 0);
+        pendingPeerChecksums[index] = checksum;
+        return;
+    }
+
+    stats.checksumsCompared++;
+    if (remoteChecksums[index] != checksum) stats.desyncs++;
+}
@@ -0,0 +1,106 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "TetrisGame.h"
+#include "UdpSocket.h"
+
+// Inputs pressed during one frame, one bit per GameInput
+using FrameInput = uint8_t;
+
+inline FrameInput inputBit(GameInput input){
+    return 1 << static_cast<int>(input);
+}
+
+struct RollbackStats{
+    int frame = 0;
+    int confirmedFrame = 0; // Every remote input before this frame is known
+
+    int lastRollbackDepth = 0;
+    int maxRollbackDepth = 0;
+    double lastResimulationUs = 0;
+    double maxResimulationUs = 0;
+    double totalResimulationUs = 0;
+
+    long rollbacks = 0;
+    long resimulatedFrames = 0;
+    long stalledFrames = 0;
+    long checksumsCompared = 0;
+    long desyncs = 0;
+};
+
+// Two player match kept in sync with rollback: the remote player's inputs are predicted,
+// and when the real inputs arrive and differ, the match is restored from the snapshot taken
+// before the mispredicted frame and simulated forward again. Local inputs apply immediately.
+class RollbackSession{
+public:
+    static constexpr int FRAMES_PER_SECOND = 60;
+    static constexpr int MAX_ROLLBACK = 30;
+
+    RollbackSession(UdpSocket& socket, int BLOCKS_X, int BLOCKS_Y);
+
+    // Agrees on a seed with the peer, call every frame until it returns true
+    bool synchronize(uint32_t proposedSeed);
+
+    // Returns false when the peer is too far behind and this frame had to be skipped
+    bool advanceFrame(FrameInput localInput, GameStepResult& localEvents);
+
+    const TetrisGame& getLocalGame() const { return state.local.game; }
+    const TetrisGame& getRemoteGame() const { return state.remote.game; }
+
+    const RollbackStats& getStats() const { return stats; }
+
+    // Seconds since anything was heard from the peer
+    double getSilenceSeconds() const;
+
+private:
+    struct PlayerState{
+        TetrisGame game;
+        int gravityCountdown;
+    };
+
+    struct MatchState{
+        PlayerState local, remote;
+    };
+
+    UdpSocket& socket;
+    const int BLOCKS_X, BLOCKS_Y;
+
+    bool started = false;
+    uint32_t seed = 0;
+    bool peerSawUs = false;
+    bool sawPeer = false;
+
+    MatchState state;
+    std::vector<MatchState> snapshots; // State before frame f is at f % snapshots.size()
+
+    int currentFrame = 0;
+    int rollbackFrame = -1; // Earliest frame simulated with a wrong prediction
+
+    std::vector<FrameInput> localInputs;
+    std::vector<int16_t> remoteInputs; // -1 while unknown
+    std::vector<FrameInput> usedRemoteInputs;
+    int remoteConfirmed = 0;
+    int peerConfirmed = 0;
+
+    std::vector<uint64_t> remoteChecksums; // Our view of the remote game, by checksum index
+    std::vector<uint64_t> pendingPeerChecksums; // Received before we got that far
+    int checksummedFrame = 0;
+
+    uint64_t lastReceiveUs;
+
+    RollbackStats stats;
+
+    void receivePackets();
+    void onRemoteInput(int frame, FrameInput input);
+    void onPeerChecksum(int frame, uint64_t checksum);
+    void sendInputs();
+    void sendSync();
+    void updateChecksums();
+
+    FrameInput remoteInputFor(int frame) const;
+    void simulateFrame(MatchState& match, int frame, GameStepResult* localEvents);
+    static void simulatePlayer(PlayerState& player, FrameInput input, GameStepResult* events);
+    static int gravityFrames(int points);
+
+    static constexpr int CHECKSUM_INTERVAL = 30;
+};
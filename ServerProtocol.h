@@ -0,0 +1,84 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Byte stream between game_server and its clients, over TCP or a UNIX socket. Every message
+// starts with its type, integers are little endian.
+//
+// Client to server:
+//   HELLO         type, width u8, height u8     Starts a new game, also after a game over. Restarting
+//                                               a game in progress within a second of its start
+//                                               closes the connection.
+//   INPUT         type + GameInput              One byte per key press
+//   STATS         type                          Asks for ServerStats
+// Server to client:
+//   WELCOME       type, seed u32                The server picks the seed, clients can't
+//   INPUT_RESULT  type, flags u8, points u32    Reply to every INPUT, in order
+//   GRAVITY       type, flags u8, points u32    A gravity step locked a block or ended the game
+//   STATS_REPLY   type, ServerStats fields in declaration order
+namespace ServerProtocol{
+    enum MessageType : uint8_t{
+        HELLO = 0x01,
+        STATS = 0x02,
+        INPUT = 0x10, // 0x10 + GameInput, up to INPUT_LAST
+        INPUT_LAST = 0x14,
+
+        WELCOME = 0x81,
+        INPUT_RESULT = 0x82,
+        STATS_REPLY = 0x83,
+        GRAVITY = 0x84,
+    };
+
+    // Flags of INPUT_RESULT and GRAVITY, lines cleared are in bits 2-4
+    constexpr uint8_t FLAG_LOCKED = 1;
+    constexpr uint8_t FLAG_GAME_OVER = 2;
+    constexpr int LINES_SHIFT = 2;
+
+    constexpr int MIN_SIZE = 4, MAX_WIDTH = 64, MAX_HEIGHT = 64;
+
+    constexpr size_t HELLO_SIZE = 3;
+    constexpr size_t WELCOME_SIZE = 5;
+    constexpr size_t RESULT_SIZE = 6;
+    constexpr size_t STATS_REPLY_SIZE = 1 + 4 + 2 + 8 + 8 + 8 + 4*4;
+
+    inline void put16(uint8_t* out, uint16_t value){
+        out[0] = value;
+        out[1] = value >> 8;
+    }
+
+    inline void put32(uint8_t* out, uint32_t value){
+        for (int i = 0; i < 4; i++) out[i] = value >> (8*i);
+    }
+
+    inline void put64(uint8_t* out, uint64_t value){
+        for (int i = 0; i < 8; i++) out[i] = value >> (8*i);
+    }
+
+    inline uint16_t get16(const uint8_t* in){
+        return in[0] | in[1] << 8;
+    }
+
+    inline uint32_t get32(const uint8_t* in){
+        uint32_t value = 0;
+        for (int i = 0; i < 4; i++) value |= static_cast<uint32_t>(in[i]) << (8*i);
+        return value;
+    }
+
+    inline uint64_t get64(const uint8_t* in){
+        uint64_t value = 0;
+        for (int i = 0; i < 8; i++) value |= static_cast<uint64_t>(in[i]) << (8*i);
+        return value;
+    }
+}
+
+// Load of the whole server, summed over its workers
+struct ServerStats{
+    uint32_t sessions = 0;
+    uint16_t workers = 0;
+    uint64_t gravityTicks = 0;
+    uint64_t cpuMs = 0;    // User and system time of the server process
+    uint64_t uptimeMs = 0;
+
+    // How late gravity steps ran after their deadline
+    uint32_t lateP50Us = 0, lateP99Us = 0, lateP999Us = 0, lateMaxUs = 0;
+};
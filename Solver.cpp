@@ -0,0 +1,708 @@
+#include "Solver.h"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <istream>
+#include <mutex>
+#include <ostream>
+#include <random>
+#include <string>
+#include <thread>
+#include "Trace.h"
+
+namespace {
+    constexpr int MAX_ROTATIONS = 4;
+    constexpr int BLOCK_TYPES = static_cast<int>(TetrominoType::P) + 1;
+    constexpr int MAX_QUEUE = 32;
+    constexpr int MAX_WIDTH = 64; // One bit per column
+    constexpr const char* TYPE_NAMES = ".IJLOSTZP";
+
+    struct BlockShapes{
+        int rotations = 0;
+        int matrixSizeX = 0;
+        std::array<BlockShape, MAX_ROTATIONS> shapes;
+    };
+
+    // Built once, Tetromino::getShape() fills its cache on first use and is not thread safe
+    const BlockShapes& shapesOf(TetrominoType type){
+        static const std::array<BlockShapes, BLOCK_TYPES> all = []{
+            std::array<BlockShapes, BLOCK_TYPES> result;
+            for (int i = 1; i < BLOCK_TYPES; i++){
+                std::unique_ptr<Tetromino> block = Tetromino::create(static_cast<TetrominoType>(i), 0, 0);
+                result[i].rotations = std::min(block->getRotationCount(), MAX_ROTATIONS);
+                result[i].matrixSizeX = block->getMatrixSizeX();
+                for (int rotation = 0; rotation < result[i].rotations; rotation++){
+                    block->setPose(0, 0, rotation);
+                    result[i].shapes[rotation] = block->getShape();
+                }
+            }
+            return result;
+        }();
+        return all[static_cast<size_t>(type)];
+    }
+
+    // Same rules as Board::checkCollisions, on one bit per cell
+    bool collides(const uint64_t* rows, int width, int height, const BlockShape& shape, int x, int y){
+        for (int i = 0; i < shape.count; i++){
+            int cellX = x + shape.x[i], cellY = y + shape.y[i];
+            if (cellX < 0 || cellX >= width || cellY < 0 || cellY >= height) return true;
+            if ((rows[cellY] >> cellX) & 1) return true;
+        }
+        return false;
+    }
+
+    struct Placement{
+        int x, y, rotation;
+        int cost;      // Inputs including the hard drop
+        uint64_t cells; // Locked cells, for finding placements that only differ in rotation
+    };
+
+    // Breadth first search over the poses reachable at the start height
+    struct Reach{
+        int width = 0;
+        std::vector<int> distance, parent;
+        std::vector<GameInput> input;
+        std::vector<int> queue;
+
+        int index(int x, int rotation) const { return rotation * (width + 8) + x + 4; }
+        int xOf(int index) const { return index % (width + 8) - 4; }
+        int rotationOf(int index) const { return index / (width + 8); }
+
+        bool run(const uint64_t* rows, int width, int height, TetrominoType type, int startX, int y, int startRotation){
+            const BlockShapes& block = shapesOf(type);
+            this->width = width;
+            size_t states = static_cast<size_t>(MAX_ROTATIONS * (width + 8));
+            distance.assign(states, -1);
+            parent.resize(states);
+            input.resize(states);
+            queue.clear();
+
+            if (collides(rows, width, height, block.shapes[startRotation], startX, y)) return false;
+
+            int start = index(startX, startRotation);
+            distance[start] = 0;
+            queue.push_back(start);
+
+            for (size_t head = 0; head < queue.size(); head++){
+                int current = queue[head];
+                int x = xOf(current), rotation = rotationOf(current);
+
+                const int next[4][2] = {
+                        {x - 1, rotation},
+                        {x + 1, rotation},
+                        {x, (rotation + 1) % block.rotations},
+                        {x, (rotation + block.rotations - 1) % block.rotations},
+                };
+                const GameInput inputs[4] = {GameInput::MOVE_LEFT, GameInput::MOVE_RIGHT, GameInput::ROTATE_CW, GameInput::ROTATE_CCW};
+
+                for (int i = 0; i < 4; i++){
+                    int nextX = next[i][0], nextRotation = next[i][1];
+                    if (nextX < -4 || nextX >= width + 4) continue;
+                    int nextIndex = index(nextX, nextRotation);
+                    if (distance[nextIndex] >= 0) continue;
+                    if (collides(rows, width, height, block.shapes[nextRotation], nextX, y)) continue;
+
+                    distance[nextIndex] = distance[current] + 1;
+                    parent[nextIndex] = current;
+                    input[nextIndex] = inputs[i];
+                    queue.push_back(nextIndex);
+                }
+            }
+            return true;
+        }
+
+        void inputsTo(int target, std::vector<GameInput>& inputs) const{
+            inputs.clear();
+            for (int current = target; distance[current] > 0; current = parent[current]){
+                inputs.push_back(input[current]);
+            }
+            std::reverse(inputs.begin(), inputs.end());
+            inputs.push_back(GameInput::HARD_DROP);
+        }
+    };
+
+    int dropY(const uint64_t* rows, int width, int height, const BlockShape& shape, int x, int y){
+        while (!collides(rows, width, height, shape, x, y + 1)) y++;
+        return y;
+    }
+
+    uint64_t cellsKey(const BlockShape& shape, int x, int y){
+        // Top left corner of the cells and a 4x4 mask relative to it
+        int minX = INT_MAX, minY = INT_MAX;
+        for (int i = 0; i < shape.count; i++){
+            minX = std::min(minX, x + shape.x[i]);
+            minY = std::min(minY, y + shape.y[i]);
+        }
+
+        uint64_t mask = 0;
+        for (int i = 0; i < shape.count; i++){
+            mask |= 1ull << ((y + shape.y[i] - minY) * 4 + x + shape.x[i] - minX);
+        }
+        return static_cast<uint64_t>(minY) << 40 | static_cast<uint64_t>(minX) << 32 | mask;
+    }
+
+    // Every distinct resting place of the block, cheapest first. False if the block can't spawn.
+    bool generatePlacements(const uint64_t* rows, int width, int height, TetrominoType type, int startX, int startY,
+                            int startRotation, Reach& reach, std::vector<Placement>& placements){
+        placements.clear();
+        if (!reach.run(rows, width, height, type, startX, startY, startRotation)) return false;
+
+        // Blocks fall freely until they are 4 rows above the highest cell
+        int top = 0;
+        while (top < height && rows[top] == 0) top++;
+        int freeFallY = std::max(startY, top - 4);
+
+        const BlockShapes& block = shapesOf(type);
+        for (int state : reach.queue){
+            int x = reach.xOf(state), rotation = reach.rotationOf(state);
+            const BlockShape& shape = block.shapes[rotation];
+            int y = dropY(rows, width, height, shape, x, freeFallY);
+            uint64_t cells = cellsKey(shape, x, y);
+            int cost = reach.distance[state] + 1;
+
+            // The queue is in order of distance, the first placement found is the cheapest
+            bool duplicate = false;
+            for (const Placement& placement : placements){
+                if (placement.cells == cells){
+                    duplicate = true;
+                    break;
+                }
+            }
+            if (!duplicate) placements.push_back({x, y, rotation, cost, cells});
+        }
+        return true;
+    }
+
+    struct Start{
+        int x, y, rotation;
+    };
+
+    Start spawnPose(TetrominoType type, int width){
+        // Same as TetrisGame::newBlock
+        return {width/2 - shapesOf(type).matrixSizeX/2, 0, 0};
+    }
+
+    uint64_t mix(uint64_t value){
+        // splitmix64 finalizer
+        value += 0x9e3779b97f4a7c15ull;
+        value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ull;
+        value = (value ^ (value >> 27)) * 0x94d049bb133111ebull;
+        return value ^ (value >> 31);
+    }
+
+    // Locks the block and clears full rows. Returns the rows cleared.
+    int lockPlacement(uint64_t* rows, int width, const BlockShape& shape, const Placement& placement){
+        for (int i = 0; i < shape.count; i++){
+            rows[placement.y + shape.y[i]] |= 1ull << (placement.x + shape.x[i]);
+        }
+
+        // Only rows the block landed in can have been filled
+        const uint64_t full = width == 64 ? ~0ull : (1ull << width) - 1;
+        int bottom = -1;
+        for (int i = 0; i < shape.count; i++){
+            int y = placement.y + shape.y[i];
+            if (rows[y] == full) bottom = std::max(bottom, y);
+        }
+        if (bottom < 0) return 0;
+
+        int cleared = 0;
+        for (int y = bottom; y >= 0; y--){
+            if (rows[y] == full){
+                cleared++;
+            }
+            else if (cleared > 0){
+                rows[y + cleared] = rows[y];
+            }
+        }
+        for (int y = 0; y < cleared; y++){
+            rows[y] = 0;
+        }
+        return cleared;
+    }
+
+    int countCells(const uint64_t* rows, int height){
+        int count = 0;
+        for (int y = 0; y < height; y++){
+            count += __builtin_popcountll(rows[y]);
+        }
+        return count;
+    }
+
+    int countNonEmptyRows(const uint64_t* rows, int height){
+        int count = 0;
+        for (int y = 0; y < height; y++){
+            if (rows[y] != 0) count++;
+        }
+        return count;
+    }
+
+    // A column that is full in every row still to be cleared walls off the columns on either side of
+    // it. Blocks of 4 cells can only fill the space between two walls if it is a multiple of 4.
+    bool segmentsFillable(const uint64_t* rows, int width, int height, int fieldRows){
+        for (int y = 0; y < height - fieldRows; y++){
+            if (rows[y] != 0) return true; // Cells above the field, the columns don't tell anything
+        }
+
+        uint64_t walls = ~0ull;
+        for (int y = height - fieldRows; y < height; y++){
+            walls &= rows[y];
+        }
+
+        int empty = 0;
+        for (int x = 0; x <= width; x++){
+            if (x == width || ((walls >> x) & 1)){
+                if (empty % 4 != 0) return false;
+                empty = 0;
+                continue;
+            }
+            for (int y = height - fieldRows; y < height; y++){
+                if (!((rows[y] >> x) & 1)) empty++;
+            }
+        }
+        return true;
+    }
+
+    enum class Outcome{
+        NO_SOLUTION,
+        FOUND,
+        INCOMPLETE, // Cut short by the time budget or by a cheaper solution, not safe to remember
+    };
+
+    // Shared by the threads of one depth
+    struct Search{
+        int width, height, depth;
+        std::vector<TetrominoType> blocks; // Current block first
+        Start start;
+
+        const uint64_t* cellKeys;
+        std::vector<uint64_t> suffixKeys; // Hash of the blocks still to come, per step
+        std::vector<int> remainingCells;  // Cells of the blocks still to come, per step
+        bool tetrominoesOnly;
+
+        std::atomic<uint64_t>* table;
+        uint64_t tableMask;
+
+        std::chrono::steady_clock::time_point deadline;
+        std::atomic<bool> stop{false};
+
+        std::atomic<int> bestCost{INT_MAX};
+        std::mutex bestMutex;
+        std::vector<Placement> bestPath;
+        std::chrono::steady_clock::time_point firstSolution;
+
+        std::atomic<uint64_t> nodes{0}, tableHits{0};
+    };
+
+    struct SearchThread{
+        std::vector<std::vector<uint64_t>> rows; // Board before each step
+        std::vector<std::vector<Placement>> placements;
+        std::vector<Placement> path;
+        Reach reach;
+        uint64_t nodes = 0, tableHits = 0;
+
+        explicit SearchThread(const Search& search)
+            : rows(search.depth + 1, std::vector<uint64_t>(search.height)),
+              placements(search.depth), path(search.depth){
+        }
+    };
+
+    uint64_t hashRows(const uint64_t* rows, int width, int height, const uint64_t* cellKeys){
+        uint64_t hash = 0;
+        for (int y = 0; y < height; y++){
+            for (uint64_t bits = rows[y]; bits != 0; bits &= bits - 1){
+                hash ^= cellKeys[y * width + __builtin_ctzll(bits)];
+            }
+        }
+        return hash;
+    }
+
+    uint64_t tableKey(const Search& search, int step, uint64_t hash){
+        return (hash ^ search.suffixKeys[step]) | 1; // 0 marks an empty slot
+    }
+
+    Outcome searchFrom(Search& search, SearchThread& thread, int step, uint64_t hash, int cost);
+
+    // Places one block on the board of step and searches on from the result
+    Outcome searchPlacement(Search& search, SearchThread& thread, int step, uint64_t hash, int cost, const Placement& placement){
+        const int width = search.width, height = search.height;
+        const BlockShape& shape = shapesOf(search.blocks[step]).shapes[placement.rotation];
+
+        uint64_t* rows = thread.rows[step + 1].data();
+        std::copy(thread.rows[step].begin(), thread.rows[step].end(), rows);
+
+        int cleared = lockPlacement(rows, width, shape, placement);
+        if (cleared > 0){
+            hash = hashRows(rows, width, height, search.cellKeys);
+        }
+        else{
+            for (int i = 0; i < shape.count; i++){
+                hash ^= search.cellKeys[(placement.y + shape.y[i]) * width + placement.x + shape.x[i]];
+            }
+        }
+
+        thread.path[step] = placement;
+        cost += placement.cost;
+
+        int filled = countCells(rows, height);
+        if (filled == 0){
+            std::lock_guard<std::mutex> lock(search.bestMutex);
+            if (cost < search.bestCost){
+                if (search.bestPath.empty()) search.firstSolution = std::chrono::steady_clock::now();
+                search.bestCost = cost;
+                search.bestPath.assign(thread.path.begin(), thread.path.begin() + step + 1);
+            }
+            return Outcome::FOUND;
+        }
+
+        // Every row with a cell in it still has to be filled and cleared with the blocks left
+        int remaining = search.remainingCells[step + 1];
+        if (remaining == 0) return Outcome::NO_SOLUTION;
+        if ((filled + remaining) % width != 0) return Outcome::NO_SOLUTION;
+        if (countNonEmptyRows(rows, height) > (filled + remaining) / width) return Outcome::NO_SOLUTION;
+        if (search.tetrominoesOnly && !segmentsFillable(rows, width, height, (filled + remaining) / width)) return Outcome::NO_SOLUTION;
+
+        return searchFrom(search, thread, step + 1, hash, cost);
+    }
+
+    Outcome searchFrom(Search& search, SearchThread& thread, int step, uint64_t hash, int cost){
+        if ((++thread.nodes & 1023) == 0 && std::chrono::steady_clock::now() > search.deadline){
+            search.stop = true;
+        }
+        if (search.stop) return Outcome::INCOMPLETE;
+
+        uint64_t key = tableKey(search, step, hash);
+        std::atomic<uint64_t>& slot = search.table[key & search.tableMask];
+        if (slot.load(std::memory_order_relaxed) == key){
+            thread.tableHits++;
+            return Outcome::NO_SOLUTION;
+        }
+
+        TetrominoType type = search.blocks[step];
+        Start start = step == 0 ? search.start : spawnPose(type, search.width);
+        std::vector<Placement>& placements = thread.placements[step];
+        bool spawned = generatePlacements(thread.rows[step].data(), search.width, search.height, type,
+                                          start.x, start.y, start.rotation, thread.reach, placements);
+
+        Outcome outcome = Outcome::NO_SOLUTION;
+        if (spawned){
+            for (const Placement& placement : placements){
+                // Placements are sorted by cost, none of the rest can beat the best solution either
+                if (cost + placement.cost >= search.bestCost.load(std::memory_order_relaxed)){
+                    if (outcome == Outcome::NO_SOLUTION) outcome = Outcome::INCOMPLETE;
+                    break;
+                }
+
+                Outcome child = searchPlacement(search, thread, step, hash, cost, placement);
+                if (child == Outcome::FOUND) outcome = Outcome::FOUND;
+                else if (child == Outcome::INCOMPLETE && outcome == Outcome::NO_SOLUTION) outcome = Outcome::INCOMPLETE;
+            }
+        }
+
+        if (outcome == Outcome::NO_SOLUTION){
+            slot.store(key, std::memory_order_relaxed);
+        }
+        return outcome;
+    }
+}
+
+SolverPosition SolverPosition::fromGame(const TetrisGame& game, int previewCount) {
+    SolverPosition position;
+    const Board& board = game.getBoard();
+    position.width = board.getWidth();
+    position.height = board.getHeight();
+
+    position.cells.resize(static_cast<size_t>(position.width) * position.height);
+    for (int y = 0; y < position.height; y++){
+        for (int x = 0; x < position.width; x++){
+            position.cells[y * position.width + x] = board.get(x, y);
+        }
+    }
+
+    const Tetromino& current = game.getCurrentBlock();
+    position.currentType = current.getType();
+    position.currentX = current.getX();
+    position.currentY = current.getY();
+    position.currentRotation = current.getRotation();
+
+    position.queue.push_back(game.getNextBlock().getType());
+    for (TetrominoType type : game.previewBlocks(previewCount)){
+        position.queue.push_back(type);
+    }
+    return position;
+}
+
+void SolverPosition::write(std::ostream& out) const {
+    out << "size " << width << " " << height << "\n";
+    out << "current " << TYPE_NAMES[static_cast<size_t>(currentType)] << " " << currentX << " " << currentY << " " << currentRotation << "\n";
+    out << "queue ";
+    for (TetrominoType type : queue){
+        out << TYPE_NAMES[static_cast<size_t>(type)];
+    }
+    out << "\n";
+
+    for (int y = 0; y < height; y++){
+        for (int x = 0; x < width; x++){
+            out << TYPE_NAMES[static_cast<size_t>(cells[y * width + x])];
+        }
+        out << "\n";
+    }
+}
+
+bool SolverPosition::read(std::istream& in) {
+    auto typeOf = [](char name, TetrominoType& type){
+        const char* found = std::char_traits<char>::find(TYPE_NAMES, BLOCK_TYPES, name);
+        if (found == nullptr) return false;
+        type = static_cast<TetrominoType>(found - TYPE_NAMES);
+        return true;
+    };
+
+    std::string word, current, blocks;
+    if (!(in >> word >> width >> height) || word != "size") return false;
+    if (width < 1 || width > MAX_WIDTH || height < 1) return false;
+    if (!(in >> word >> current >> currentX >> currentY >> currentRotation) || word != "current") return false;
+    if (current.size() != 1 || !typeOf(current[0], currentType) || currentType == TetrominoType::EMPTY) return false;
+    // The pose indexes the shapes and the search state, keep it where a block can be
+    if (currentRotation < 0 || currentRotation >= shapesOf(currentType).rotations) return false;
+    if (currentX < -4 || currentX >= width + 4 || currentY < -4 || currentY >= height) return false;
+    if (!(in >> word) || word != "queue") return false;
+
+    // The queue may be empty, then the next line is already the first row
+    std::getline(in, blocks);
+    queue.clear();
+    for (char name : blocks){
+        if (name == ' ' || name == '\r') continue;
+        TetrominoType type;
+        if (!typeOf(name, type) || type == TetrominoType::EMPTY) return false;
+        queue.push_back(type);
+    }
+
+    cells.assign(static_cast<size_t>(width) * height, TetrominoType::EMPTY);
+    for (int y = 0; y < height; y++){
+        std::string row;
+        if (!(in >> row) || static_cast<int>(row.size()) != width) return false;
+        for (int x = 0; x < width; x++){
+            if (!typeOf(row[x], cells[y * width + x])) return false;
+        }
+    }
+    return true;
+}
+
+Solver::Solver(const SolverOptions& options)
+    : options(options){
+    size_t entries = size_t{1} << options.tableBits;
+    table = std::make_unique<std::atomic<uint64_t>[]>(entries);
+    tableMask = entries - 1;
+    for (size_t i = 0; i < entries; i++){
+        table[i].store(0, std::memory_order_relaxed);
+    }
+
+    std::mt19937_64 random(0x5eed);
+    blockKeys.resize((MAX_QUEUE + 1) * BLOCK_TYPES + MAX_QUEUE + 1);
+    for (uint64_t& key : blockKeys){
+        key = random();
+    }
+}
+
+Solver::~Solver() = default;
+
+void Solver::resize(int width, int height) {
+    if (width == this->width && height == this->height) return;
+    this->width = width;
+    this->height = height;
+
+    std::mt19937_64 random(static_cast<uint64_t>(width) << 32 | static_cast<uint32_t>(height));
+    cellKeys.resize(static_cast<size_t>(width) * height);
+    for (uint64_t& key : cellKeys){
+        key = random();
+    }
+
+    // Hashes of the old size mean nothing now
+    for (size_t i = 0; i <= tableMask; i++){
+        table[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+SolverResult Solver::solve(const SolverPosition& position) {
+    TRACE_ZONE("Solver::solve");
+    auto startTime = std::chrono::steady_clock::now();
+    SolverResult result;
+
+    if (position.width < 1 || position.width > MAX_WIDTH || position.currentType == TetrominoType::EMPTY) return result;
+    resize(position.width, position.height);
+
+    std::vector<uint64_t> rows(position.height);
+    for (int y = 0; y < position.height; y++){
+        for (int x = 0; x < position.width; x++){
+            if (position.cells[y * position.width + x] != TetrominoType::EMPTY) rows[y] |= 1ull << x;
+        }
+    }
+    const int filled = countCells(rows.data(), position.height);
+    const uint64_t rootHash = hashRows(rows.data(), position.width, position.height, cellKeys.data());
+
+    std::vector<TetrominoType> blocks = {position.currentType};
+    blocks.insert(blocks.end(), position.queue.begin(), position.queue.end());
+    blocks.resize(std::min<size_t>(blocks.size(), std::min(options.maxBlocks, MAX_QUEUE)));
+
+    int threadCount = options.threads > 0 ? options.threads : static_cast<int>(std::thread::hardware_concurrency());
+    threadCount = std::max(threadCount, 1);
+
+    auto deadline = startTime + std::chrono::milliseconds(options.timeBudgetMs);
+    int depthCells = 0;
+
+    for (int depth = 1; depth <= static_cast<int>(blocks.size()) && !result.found && !result.timedOut; depth++){
+        depthCells += shapesOf(blocks[depth - 1]).shapes[0].count;
+
+        // Only depths that fill a whole number of rows can clear the board
+        int total = filled + depthCells;
+        if (total % position.width != 0) continue;
+        if (countNonEmptyRows(rows.data(), position.height) > total / position.width) continue;
+
+        Search search;
+        search.width = position.width;
+        search.height = position.height;
+        search.depth = depth;
+        search.blocks.assign(blocks.begin(), blocks.begin() + depth);
+        search.start = {position.currentX, position.currentY, position.currentRotation % shapesOf(position.currentType).rotations};
+        search.cellKeys = cellKeys.data();
+        search.table = table.get();
+        search.tableMask = tableMask;
+        search.deadline = deadline;
+
+        search.tetrominoesOnly = std::none_of(search.blocks.begin(), search.blocks.end(),
+                                              [](TetrominoType type){ return type == TetrominoType::P; });
+        search.suffixKeys.assign(depth + 1, 0);
+        search.remainingCells.assign(depth + 1, 0);
+        for (int step = depth - 1; step >= 0; step--){
+            search.remainingCells[step] = search.remainingCells[step + 1] + shapesOf(blocks[step]).shapes[0].count;
+        }
+        for (int step = 0; step < depth; step++){
+            uint64_t key = blockKeys[(MAX_QUEUE + 1) * BLOCK_TYPES + depth - step];
+            for (int i = step; i < depth; i++){
+                key ^= blockKeys[(i - step) * BLOCK_TYPES + static_cast<int>(blocks[i])];
+            }
+            search.suffixKeys[step] = key;
+        }
+        // The current block may have moved away from its spawn pose
+        search.suffixKeys[0] ^= mix(static_cast<uint64_t>(search.start.x + 64) << 40 ^
+                                    static_cast<uint64_t>(search.start.y + 64) << 8 ^ search.start.rotation);
+
+        // Root placements are shared out between the threads, the table between them all
+        SearchThread root(search);
+        root.rows[0] = rows;
+        uint64_t rootKey = tableKey(search, 0, rootHash);
+        bool known = table[rootKey & tableMask].load(std::memory_order_relaxed) == rootKey;
+        bool spawned = !known && generatePlacements(rows.data(), search.width, search.height, blocks[0],
+                                                    search.start.x, search.start.y, search.start.rotation,
+                                                    root.reach, root.placements[0]);
+        if (known) result.tableHits++;
+
+        if (spawned){
+            const std::vector<Placement>& placements = root.placements[0];
+            std::atomic<size_t> next{0};
+            std::atomic<bool> incomplete{false}, found{false};
+
+            auto work = [&]{
+                SearchThread thread(search);
+                thread.rows[0] = rows;
+                for (size_t index = next++; index < placements.size(); index = next++){
+                    const Placement& placement = placements[index];
+                    if (placement.cost >= search.bestCost.load(std::memory_order_relaxed)){
+                        incomplete = true;
+                        continue;
+                    }
+                    Outcome outcome = searchPlacement(search, thread, 0, rootHash, 0, placement);
+                    if (outcome == Outcome::FOUND) found = true;
+                    if (outcome == Outcome::INCOMPLETE) incomplete = true;
+                }
+                search.nodes += thread.nodes;
+                search.tableHits += thread.tableHits;
+            };
+
+            std::vector<std::thread> workers;
+            for (int i = 1; i < threadCount; i++){
+                workers.emplace_back(work);
+            }
+            work();
+            for (std::thread& worker : workers){
+                worker.join();
+            }
+
+            if (!found && !incomplete){
+                table[rootKey & tableMask].store(rootKey, std::memory_order_relaxed);
+            }
+        }
+
+        result.deepestSearched = depth;
+        result.nodes += search.nodes + 1;
+        result.tableHits += search.tableHits;
+        result.timedOut = search.stop;
+
+        if (!search.bestPath.empty()){
+            result.found = true;
+            result.inputCount = search.bestCost;
+            result.firstSolutionMs = std::chrono::duration<double, std::milli>(search.firstSolution - startTime).count();
+
+            // Play the solution through again for the inputs of each block
+            std::vector<uint64_t> board = rows;
+            Reach reach;
+            for (size_t step = 0; step < search.bestPath.size(); step++){
+                const Placement& placement = search.bestPath[step];
+                Start start = step == 0 ? search.start : spawnPose(blocks[step], position.width);
+                reach.run(board.data(), position.width, position.height, blocks[step], start.x, start.y, start.rotation);
+
+                SolverMove move;
+                move.type = blocks[step];
+                move.x = placement.x;
+                move.y = placement.y;
+                move.rotation = placement.rotation;
+                reach.inputsTo(reach.index(placement.x, placement.rotation), move.inputs);
+                result.moves.push_back(move);
+
+                lockPlacement(board.data(), position.width, shapesOf(blocks[step]).shapes[placement.rotation], placement);
+            }
+        }
+    }
+
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - startTime;
+    result.elapsedMs = elapsed.count();
+    return result;
+}
+
+bool Solver::findInputs(const SolverPosition& position, int x, int rotation, std::vector<GameInput>& inputs) {
+    if (position.width < 1 || position.width > MAX_WIDTH || position.currentType == TetrominoType::EMPTY) return false;
+    const BlockShapes& block = shapesOf(position.currentType);
+    if (rotation < 0 || rotation >= block.rotations || x < -4 || x >= position.width + 4) return false;
+
+    std::vector<uint64_t> rows(position.height);
+    for (int y = 0; y < position.height; y++){
+        for (int cellX = 0; cellX < position.width; cellX++){
+            if (position.cells[y * position.width + cellX] != TetrominoType::EMPTY) rows[y] |= 1ull << cellX;
+        }
+    }
+
+    Reach reach;
+    if (!reach.run(rows.data(), position.width, position.height, position.currentType,
+                   position.currentX, position.currentY, position.currentRotation % block.rotations)) return false;
+
+    int target = reach.index(x, rotation);
+    if (reach.distance[target] < 0) return false;
+
+    reach.inputsTo(target, inputs);
+    return true;
+}
+
+const char* Solver::inputName(GameInput input) {
+    switch (input){
+        case GameInput::MOVE_LEFT:
+            return "left";
+        case GameInput::MOVE_RIGHT:
+            return "right";
+        case GameInput::ROTATE_CW:
+            return "cw";
+        case GameInput::ROTATE_CCW:
+            return "ccw";
+        case GameInput::HARD_DROP:
+            return "drop";
+    }
+    return "?";
+}
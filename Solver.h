@@ -0,0 +1,82 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <vector>
+#include "TetrisGame.h"
+
+// A position to search from: the static blocks and the blocks that will fall on them
+struct SolverPosition{
+    int width = 0, height = 0;
+    std::vector<TetrominoType> cells; // Row major, top row first
+
+    TetrominoType currentType = TetrominoType::EMPTY;
+    int currentX = 0, currentY = 0, currentRotation = 0;
+
+    std::vector<TetrominoType> queue; // Blocks after the current one, next block first
+
+    // The game's board, current and next block, followed by previewCount more blocks from its seed
+    static SolverPosition fromGame(const TetrisGame& game, int previewCount = 0);
+
+    // Plain text, see the README for the format
+    void write(std::ostream& out) const;
+    bool read(std::istream& in);
+};
+
+struct SolverMove{
+    TetrominoType type = TetrominoType::EMPTY;
+    int x = 0, y = 0, rotation = 0; // Pose the block locks in
+    std::vector<GameInput> inputs;  // Fewest inputs from the spawn pose, ending with a hard drop
+};
+
+struct SolverResult{
+    bool found = false;
+    std::vector<SolverMove> moves;
+    int inputCount = 0;
+    int deepestSearched = 0; // Blocks, iterative deepening stops at the first depth with a solution
+    bool timedOut = false;
+
+    uint64_t nodes = 0;
+    uint64_t tableHits = 0;
+    double elapsedMs = 0;
+    double firstSolutionMs = 0; // The rest of the time went into looking for fewer inputs
+};
+
+struct SolverOptions{
+    int timeBudgetMs = 50;
+    int threads = 0;     // 0 uses every core
+    int tableBits = 20;  // Transposition table of 2^tableBits entries
+    int maxBlocks = 10;  // Deepest the search goes, also limited by the queue
+};
+
+// Searches for perfect clears: sequences of placements from the queue that leave the board
+// empty, using the fewest blocks and then the fewest inputs. Placements are the ones reachable
+// by moving and rotating at the spawn height and hard dropping, the way the game is played
+// without waiting for gravity. Positions that were fully searched without a solution are
+// remembered by their Zobrist hash in a table shared by the search threads and kept between
+// calls, so asking again after one block locked is cheap.
+class Solver{
+public:
+    explicit Solver(const SolverOptions& options = {});
+    ~Solver();
+
+    SolverResult solve(const SolverPosition& position);
+
+    // Fewest inputs that bring the current block of position to (x, rotation) and drop it
+    static bool findInputs(const SolverPosition& position, int x, int rotation, std::vector<GameInput>& inputs);
+
+    static const char* inputName(GameInput input);
+
+private:
+    SolverOptions options;
+
+    int width = 0, height = 0;
+    std::vector<uint64_t> cellKeys;  // One per cell of the board
+    std::vector<uint64_t> blockKeys; // One per (position in the queue, block type)
+
+    std::unique_ptr<std::atomic<uint64_t>[]> table; // Keys of positions without a solution
+    uint64_t tableMask = 0;
+
+    void resize(int width, int height);
+};
@@ -0,0 +1,16 @@
+#include "SoundEffects.h"
+
+SoundEffects::SoundEffects(std::shared_ptr<ResourceManager> resourceManager)
+        : resourceManager(std::move(resourceManager)) {
+}
+
+void SoundEffects::onGameEvents(const GameEvent* events, int count) {
+    for (int i = 0; i < count; i++){
+        switch (events[i].type){
+            case GameEventType::HARD_DROP: resourceManager->playSound(Sound::DROP); break;
+            case GameEventType::LINES_CLEARED: resourceManager->playSound(Sound::CLEAR_ROW); break;
+            case GameEventType::GAME_OVER: resourceManager->playSound(Sound::GAME_OVER); break;
+            default: break;
+        }
+    }
+}
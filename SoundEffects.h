@@ -0,0 +1,15 @@
+#pragma once
+#include <memory>
+#include "GameEvents.h"
+#include "ResourceManager.h"
+
+// Plays the sound of every game event that has one
+class SoundEffects : public GameEventListener{
+public:
+    explicit SoundEffects(std::shared_ptr<ResourceManager> resourceManager);
+
+    void onGameEvents(const GameEvent* events, int count) override;
+
+private:
+    std::shared_ptr<ResourceManager> resourceManager;
+};
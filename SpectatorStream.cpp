@@ -0,0 +1,354 @@
+#include "SpectatorStream.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+using namespace SpectatorStream;
+
+namespace {
+    void putVarint(std::vector<uint8_t>& out, uint64_t value){
+        while (value >= 0x80){
+            out.push_back(static_cast<uint8_t>(value) | 0x80);
+            value >>= 7;
+        }
+        out.push_back(static_cast<uint8_t>(value));
+    }
+
+    // Zigzag, so small negative positions stay one byte
+    void putSigned(std::vector<uint8_t>& out, int value){
+        putVarint(out, (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31));
+    }
+
+    // Returns 0 and leaves offset at the end of data on truncated input
+    uint64_t getVarint(const std::vector<uint8_t>& in, size_t& offset){
+        uint64_t value = 0;
+        for (int shift = 0; offset < in.size() && shift < 64; shift += 7){
+            uint8_t byte = in[offset++];
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) return value;
+        }
+        offset = in.size();
+        return 0;
+    }
+
+    int getSigned(const std::vector<uint8_t>& in, size_t& offset){
+        uint32_t value = getVarint(in, offset);
+        return static_cast<int>(value >> 1) ^ -static_cast<int>(value & 1);
+    }
+
+    uint8_t getByte(const std::vector<uint8_t>& in, size_t& offset){
+        return offset < in.size() ? in[offset++] : 0;
+    }
+
+    void putPose(std::vector<uint8_t>& out, const LockedPose& pose){
+        out.push_back(static_cast<uint8_t>(pose.type));
+        out.push_back(pose.rotation);
+        putSigned(out, pose.x);
+        putSigned(out, pose.y);
+    }
+
+    LockedPose getPose(const std::vector<uint8_t>& in, size_t& offset){
+        LockedPose pose;
+        pose.type = static_cast<TetrominoType>(getByte(in, offset));
+        pose.rotation = getByte(in, offset);
+        pose.x = getSigned(in, offset);
+        pose.y = getSigned(in, offset);
+        return pose;
+    }
+
+    bool operator!=(const LockedPose& a, const LockedPose& b){
+        return a.type != b.type || a.rotation != b.rotation || a.x != b.x || a.y != b.y;
+    }
+
+    uint64_t nowUs(){
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+}
+
+SpectatorWriter::~SpectatorWriter() {
+    if (file != nullptr) fclose(file);
+}
+
+bool SpectatorWriter::open(const std::string& path, int BLOCKS_X, int BLOCKS_Y) {
+    file = fopen(path.c_str(), "wb");
+    if (file == nullptr){
+        std::cout << "Could not open " << path << " for recording: " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    this->BLOCKS_X = BLOCKS_X;
+    this->BLOCKS_Y = BLOCKS_Y;
+
+    buffer.reserve(256);
+    buffer.insert(buffer.end(), std::begin(MAGIC), std::end(MAGIC));
+    putVarint(buffer, BLOCKS_X);
+    putVarint(buffer, BLOCKS_Y);
+    fwrite(buffer.data(), 1, buffer.size(), file);
+    bytesWritten += buffer.size();
+
+    startUs = nowUs();
+    return true;
+}
+
+void SpectatorWriter::record(const TetrisGame& game, const GameStepResult& result) {
+    if (file == nullptr) return;
+
+    uint32_t nowMs = (nowUs() - startUs) / 1000;
+    bool keyframe = keyframeRequested || nowMs - lastKeyframeMs >= KEYFRAME_INTERVAL_MS;
+
+    const Tetromino& block = game.getCurrentBlock();
+    LockedPose currentPiece = {block.getType(), block.getRotation(), block.getX(), block.getY()};
+
+    uint8_t flags = 0;
+    if (keyframe){
+        flags = KEYFRAME | PIECE | NEXT | SCORE;
+    }
+    else{
+        if (result.locked) flags |= LOCK;
+        if (currentPiece != piece) flags |= PIECE;
+        if (game.getNextBlock().getType() != next) flags |= NEXT;
+        if (game.getPoints() != points || game.getLinesCleared() != lines) flags |= SCORE;
+    }
+    if (result.linesCleared > 0) flags |= CLEAR;
+    if (result.gameOver) flags |= GAME_OVER;
+
+    if (flags == 0) return;
+
+    buffer.clear();
+    putVarint(buffer, nowMs - lastRecordMs);
+    buffer.push_back(flags);
+
+    if (flags & KEYFRAME){
+        putVarint(buffer, nowMs);
+        writeGrid(game.getBoard());
+        buffer.push_back(game.isGameOver());
+    }
+    if (flags & LOCK) putPose(buffer, result.lockedPose);
+    if (flags & PIECE) putPose(buffer, currentPiece);
+    if (flags & NEXT) buffer.push_back(static_cast<uint8_t>(game.getNextBlock().getType()));
+    if (flags & SCORE){
+        putVarint(buffer, game.getPoints());
+        putVarint(buffer, game.getLinesCleared());
+    }
+    if (flags & CLEAR) buffer.push_back(result.linesCleared);
+
+    flushRecord();
+
+    piece = currentPiece;
+    next = game.getNextBlock().getType();
+    points = game.getPoints();
+    lines = game.getLinesCleared();
+
+    lastRecordMs = nowMs;
+    if (keyframe){
+        lastKeyframeMs = nowMs;
+        keyframeRequested = false;
+    }
+}
+
+void SpectatorWriter::writeGrid(const Board& board) {
+    // Run length encoded, row by row
+    TetrominoType runType = board.get(0, 0);
+    uint64_t runLength = 0;
+
+    for (int y = 0; y < BLOCKS_Y; y++){
+        for (int x = 0; x < BLOCKS_X; x++){
+            TetrominoType type = board.get(x, y);
+            if (type != runType){
+                buffer.push_back(static_cast<uint8_t>(runType));
+                putVarint(buffer, runLength);
+                runType = type;
+                runLength = 0;
+            }
+            runLength++;
+        }
+    }
+
+    buffer.push_back(static_cast<uint8_t>(runType));
+    putVarint(buffer, runLength);
+}
+
+void SpectatorWriter::flushRecord() {
+    uint8_t length[10];
+    size_t lengthSize = 0;
+    for (uint64_t value = buffer.size(); ; value >>= 7){
+        length[lengthSize++] = (value & 0x7f) | (value >= 0x80 ? 0x80 : 0);
+        if (value < 0x80) break;
+    }
+
+    fwrite(length, 1, lengthSize, file);
+    fwrite(buffer.data(), 1, buffer.size(), file);
+    bytesWritten += lengthSize + buffer.size();
+}
+
+bool SpectatorReader::open(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in){
+        std::cout << "Could not open " << path << std::endl;
+        return false;
+    }
+    data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+
+    if (data.size() < sizeof(MAGIC) || !std::equal(std::begin(MAGIC), std::end(MAGIC), data.begin())){
+        std::cout << path << " is not a spectator stream" << std::endl;
+        return false;
+    }
+
+    size_t offset = sizeof(MAGIC);
+    uint64_t streamWidth = getVarint(data, offset);
+    uint64_t streamHeight = getVarint(data, offset);
+    if (streamWidth < 1 || streamHeight < 1 || streamWidth > MAX_BOARD_SIZE || streamHeight > MAX_BOARD_SIZE){
+        std::cout << path << " has an invalid board size" << std::endl;
+        return false;
+    }
+    width = static_cast<int>(streamWidth);
+    height = static_cast<int>(streamHeight);
+    firstRecord = offset;
+
+    // Index the keyframes so seeking does not replay from the start
+    uint32_t recordMs = 0;
+    while (offset < data.size()){
+        uint8_t flags;
+        size_t next;
+        if (!readRecord(offset, false, recordMs, flags, next)){
+            std::cout << path << " is cut off at byte " << offset << std::endl;
+            return false;
+        }
+        if (flags & KEYFRAME) keyframes.push_back({offset, recordMs});
+        offset = next;
+    }
+    durationMs = recordMs;
+
+    // Play it through once, seeking only ever replays records that passed here
+    board = Board::create(width, height);
+    recordMs = 0;
+    for (offset = firstRecord; offset < data.size(); ){
+        uint8_t flags;
+        size_t next;
+        if (!readRecord(offset, true, recordMs, flags, next)){
+            std::cout << path << " has a corrupt record at byte " << offset << std::endl;
+            return false;
+        }
+        offset = next;
+    }
+
+    board = Board::create(width, height);
+    currentBlock.reset();
+    nextBlock.reset();
+    points = lines = 0;
+    gameOver = false;
+    seek(0);
+    return true;
+}
+
+bool SpectatorReader::advanceTo(uint32_t timeMs) {
+    while (position < data.size()){
+        uint32_t recordMs = lastRecordMs;
+        uint8_t flags;
+        size_t next;
+        readRecord(position, false, recordMs, flags, next);
+        if (recordMs > timeMs) break;
+
+        // Checked by open, a failure here would mean the data changed
+        if (!readRecord(position, true, lastRecordMs, flags, next)) next = data.size();
+        position = next;
+    }
+
+    this->timeMs = timeMs;
+    return position < data.size();
+}
+
+void SpectatorReader::seek(uint32_t timeMs) {
+    auto keyframe = std::upper_bound(keyframes.begin(), keyframes.end(), timeMs,
+                                     [](uint32_t time, const Keyframe& frame){ return time < frame.timeMs; });
+
+    // Records before the first keyframe only make sense on top of an empty board
+    position = keyframe == keyframes.begin() ? firstRecord : std::prev(keyframe)->offset;
+    lastRecordMs = keyframe == keyframes.begin() ? 0 : std::prev(keyframe)->timeMs;
+
+    advanceTo(timeMs);
+}
+
+bool SpectatorReader::readRecord(size_t offset, bool apply, uint32_t& recordTimeMs, uint8_t& flags, size_t& next) {
+    uint64_t length = getVarint(data, offset);
+    if (length == 0 || length > data.size() - offset) return false;
+    size_t end = offset + length;
+    next = end;
+
+    recordTimeMs += getVarint(data, offset);
+    flags = getByte(data, offset);
+
+    if (flags & KEYFRAME) recordTimeMs = getVarint(data, offset);
+    if (!apply) return offset <= end;
+
+    if (flags & KEYFRAME){
+        int cell = 0;
+        while (cell < width * height && offset < end){
+            uint8_t type = getByte(data, offset);
+            if (type > static_cast<uint8_t>(TetrominoType::P)) return false;
+
+            int run = std::min<uint64_t>(getVarint(data, offset), width * height - cell);
+            for (int i = 0; i < run; i++, cell++){
+                board->set(cell % width, cell / width, static_cast<TetrominoType>(type));
+            }
+        }
+        if (cell < width * height) return false;
+        gameOver = getByte(data, offset);
+    }
+
+    if (flags & LOCK){
+        LockedPose pose = getPose(data, offset);
+        std::unique_ptr<Tetromino> block = Tetromino::create(pose.type, 0, 0);
+        if (!block || !isOnBoard(*block, pose)) return false;
+
+        // board.lock does not check, every cell it writes must be free
+        for (int i = 0; i < block->getShape().count; i++){
+            if (board->isOccupied(pose.x + block->getShape().x[i], pose.y + block->getShape().y[i])) return false;
+        }
+
+        block->lockToBoard(*board);
+        board->clearFullRows(pose.y, pose.y + block->getMatrixSizeY() - 1);
+    }
+
+    if (flags & PIECE){
+        LockedPose pose = getPose(data, offset);
+        if (!currentBlock || currentBlock->getType() != pose.type){
+            currentBlock = Tetromino::create(pose.type, 0, 0);
+        }
+        // The falling block may overlap others once the game is over, but never leaves the board
+        if (currentBlock && !isOnBoard(*currentBlock, pose)) return false;
+    }
+
+    if (flags & NEXT){
+        nextBlock = Tetromino::create(static_cast<TetrominoType>(getByte(data, offset)), 0, 1);
+    }
+
+    if (flags & SCORE){
+        points = getVarint(data, offset);
+        lines = getVarint(data, offset);
+    }
+
+    if (flags & GAME_OVER) gameOver = true;
+
+    return offset <= end;
+}
+
+bool SpectatorReader::isOnBoard(Tetromino& block, const LockedPose& pose) const {
+    if (pose.rotation < 0 || pose.rotation >= block.getRotationCount()) return false;
+
+    // Far enough out that no cell can be on the board, and adding the cell offsets cannot overflow
+    if (pose.x < -block.getMatrixSizeX() || pose.x > width || pose.y < -block.getMatrixSizeY() || pose.y > height) return false;
+
+    block.setPose(pose.x, pose.y, pose.rotation);
+    const BlockShape& shape = block.getShape();
+    for (int i = 0; i < shape.count; i++){
+        int x = pose.x + shape.x[i];
+        int y = pose.y + shape.y[i];
+        if (x < 0 || x >= width || y < 0 || y >= height) return false;
+    }
+    return true;
+}
@@ -0,0 +1,117 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Board.h"
+#include "TetrisGame.h"
+
+// Compact recording of one board for spectating and replays. The file starts with "TSS1" and the
+// board size, followed by length prefixed records. A record holds the milliseconds since the
+// previous one and only what changed: the locked block, the falling block's pose, the next block,
+// the score and cleared lines. Keyframes carry the whole board and let a reader join or seek.
+namespace SpectatorStream {
+    enum Flags : uint8_t{
+        KEYFRAME = 1 << 0,
+        LOCK = 1 << 1,
+        PIECE = 1 << 2,
+        NEXT = 1 << 3,
+        SCORE = 1 << 4,
+        CLEAR = 1 << 5,
+        GAME_OVER = 1 << 6,
+    };
+
+    constexpr char MAGIC[4] = {'T', 'S', 'S', '1'};
+    constexpr uint32_t KEYFRAME_INTERVAL_MS = 5000;
+    constexpr int MAX_BOARD_SIZE = 4096; // Largest side the game plays on
+}
+
+class SpectatorWriter{
+public:
+    SpectatorWriter() = default;
+    ~SpectatorWriter();
+
+    bool open(const std::string& path, int BLOCKS_X, int BLOCKS_Y);
+
+    // Call after every step of the game. Does not allocate, except when a keyframe of a huge board
+    // needs more room than any before it.
+    void record(const TetrisGame& game, const GameStepResult& result);
+
+    // The next record carries the whole board, e.g. after starting a new game
+    void requestKeyframe() { keyframeRequested = true; }
+
+    uint64_t getBytesWritten() const { return bytesWritten; }
+
+private:
+    FILE* file = nullptr;
+    int BLOCKS_X = 0, BLOCKS_Y = 0;
+
+    std::vector<uint8_t> buffer; // Current record, reused
+    uint64_t bytesWritten = 0;
+
+    uint64_t startUs = 0;
+    uint32_t lastRecordMs = 0, lastKeyframeMs = 0;
+    bool keyframeRequested = true;
+
+    // What the spectators have seen so far
+    LockedPose piece;
+    TetrominoType next = TetrominoType::EMPTY;
+    int points = -1, lines = -1;
+
+    void writeGrid(const Board& board);
+    void flushRecord();
+};
+
+class SpectatorReader{
+public:
+    // Reads the whole file and checks every record, so a truncated or corrupt stream fails here
+    // rather than halfway through a replay
+    bool open(const std::string& path);
+
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+
+    // Applies every record up to and including timeMs. Returns false once the stream has ended.
+    bool advanceTo(uint32_t timeMs);
+
+    // Restarts from the last keyframe before timeMs
+    void seek(uint32_t timeMs);
+
+    uint32_t getTimeMs() const { return timeMs; }
+    uint32_t getDurationMs() const { return durationMs; }
+
+    const Board& getBoard() const { return *board; }
+    const Tetromino* getCurrentBlock() const { return currentBlock.get(); }
+    const Tetromino* getNextBlock() const { return nextBlock.get(); }
+
+    int getPoints() const { return points; }
+    int getLinesCleared() const { return lines; }
+    bool isGameOver() const { return gameOver; }
+
+private:
+    std::vector<uint8_t> data;
+    size_t firstRecord = 0, position = 0;
+
+    struct Keyframe{
+        size_t offset;
+        uint32_t timeMs;
+    };
+    std::vector<Keyframe> keyframes;
+
+    int width = 0, height = 0;
+    uint32_t timeMs = 0, durationMs = 0;
+    uint32_t lastRecordMs = 0;
+
+    std::unique_ptr<Board> board;
+    std::unique_ptr<Tetromino> currentBlock, nextBlock;
+    int points = 0, lines = 0;
+    bool gameOver = false;
+
+    // Reads the record at offset, applying it when apply is set, and sets next to the offset after
+    // it. Returns false when the record is cut off, or would put cells outside the board or a
+    // block on top of others; nothing after it can be trusted then.
+    bool readRecord(size_t offset, bool apply, uint32_t& recordTimeMs, uint8_t& flags, size_t& next);
+
+    bool isOnBoard(Tetromino& block, const LockedPose& pose) const;
+};
@@ -0,0 +1,252 @@
+#include "Telemetry.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include "Trace.h"
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+namespace {
+    const std::string UNIX_PREFIX = "unix:";
+
+    // Counters restart when a new game is spawned
+    int counterDelta(int now, int before){
+        return now >= before ? now - before : now;
+    }
+
+    float percentile(std::vector<float>& values, double p){
+        if (values.empty()) return 0;
+
+        size_t index = std::min(values.size() - 1, static_cast<size_t>(p * values.size()));
+        std::nth_element(values.begin(), values.begin() + index, values.end());
+        return values[index];
+    }
+
+    const char* causeToString(GameOverCause cause){
+        switch (cause){
+            case GameOverCause::BLOCK_OUT:
+                return "block_out";
+            case GameOverCause::QUIT:
+                return "quit";
+            default:
+                return "none";
+        }
+    }
+}
+
+Telemetry::Telemetry(const std::string& target, int exportIntervalMs)
+        : target(target), exportIntervalMs(exportIntervalMs) {
+    frameTimes.reserve(SAMPLE_CAPACITY);
+
+    lastExportUs = nowUs();
+    lastCpuSeconds = processCpuSeconds();
+    exportThread = std::thread(&Telemetry::exportLoop, this);
+}
+
+Telemetry::~Telemetry() {
+    {
+        std::lock_guard<std::mutex> lock(stopMutex);
+        stopping = true;
+    }
+    stopCondition.notify_all();
+    exportThread.join();
+
+    closeOutput();
+}
+
+void Telemetry::record(const TelemetrySample& sample) {
+    if (!samples.push(sample)){
+        droppedSamples.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+uint64_t Telemetry::nowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Telemetry::exportLoop() {
+    TRACE_THREAD_NAME("telemetry");
+
+    std::unique_lock<std::mutex> lock(stopMutex);
+    while (!stopping){
+        stopCondition.wait_for(lock, std::chrono::milliseconds(exportIntervalMs));
+
+        lock.unlock();
+        exportBatch();
+        lock.lock();
+    }
+    lock.unlock();
+
+    // Samples recorded after the last pass, like the final frame and the quit
+    exportBatch();
+}
+
+double Telemetry::processCpuSeconds() {
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+void Telemetry::exportBatch() {
+    TRACE_ZONE("Telemetry::exportBatch");
+    line.clear();
+    frameTimes.clear();
+
+    // CPU use of the whole process since the last export, 100 is one core kept busy
+    uint64_t exportUs = nowUs();
+    double cpuSeconds = processCpuSeconds();
+    double exportSeconds = (exportUs - lastExportUs) / 1e6;
+    double cpuPercent = exportSeconds > 0 ? (cpuSeconds - lastCpuSeconds) * 100 / exportSeconds : 0;
+    lastExportUs = exportUs;
+    lastCpuSeconds = cpuSeconds;
+
+    TelemetrySample sample{};
+    TelemetrySample first{};
+    int frames = 0;
+
+    while (samples.pop(sample)){
+        if (frames == 0) first = hasLast ? last : sample;
+
+        frameTimes.push_back(sample.frameMs);
+        frames++;
+
+        if (sample.gameOver != GameOverCause::NONE){
+            appendGameOver(sample);
+        }
+    }
+
+    if (frames == 0){
+        // Nothing was drawn, the main loop is waiting for input
+        appendIdle(exportSeconds, cpuPercent);
+        writeOutput(line);
+        return;
+    }
+
+    appendInterval(first, sample, frames, droppedSamples.exchange(0, std::memory_order_relaxed), cpuPercent);
+
+    last = sample;
+    hasLast = true;
+
+    writeOutput(line);
+}
+
+void Telemetry::appendGameOver(const TelemetrySample& sample) {
+    char buffer[256];
+    snprintf(buffer, sizeof(buffer),
+             "{\"ts_us\":%llu,\"event\":\"game_over\",\"cause\":\"%s\",\"score\":%d,\"lines\":%d,\"pieces\":%d}\n",
+             static_cast<unsigned long long>(sample.timestampUs), causeToString(sample.gameOver),
+             sample.points, sample.linesCleared, sample.piecesPlaced);
+    line += buffer;
+}
+
+void Telemetry::appendIdle(double seconds, double cpuPercent) {
+    char buffer[128];
+    snprintf(buffer, sizeof(buffer), "{\"ts_us\":%llu,\"event\":\"idle\",\"interval_s\":%.3f,\"cpu_percent\":%.2f}\n",
+             static_cast<unsigned long long>(nowUs()), seconds, cpuPercent);
+    line += buffer;
+}
+
+void Telemetry::appendInterval(const TelemetrySample& first, const TelemetrySample& latest, int frames, uint64_t dropped,
+                               double cpuPercent) {
+    double seconds = (latest.timestampUs - first.timestampUs) / 1e6;
+    if (seconds <= 0) seconds = exportIntervalMs / 1000.0;
+
+    int pieces = counterDelta(latest.piecesPlaced, first.piecesPlaced);
+    int lines = counterDelta(latest.linesCleared, first.linesCleared);
+    int score = counterDelta(latest.points, first.points);
+    int actions = counterDelta(latest.actions, first.actions);
+
+    float maxFrame = *std::max_element(frameTimes.begin(), frameTimes.end());
+    float p50 = percentile(frameTimes, 0.50);
+    float p95 = percentile(frameTimes, 0.95);
+    float p99 = percentile(frameTimes, 0.99);
+
+    char buffer[768];
+    snprintf(buffer, sizeof(buffer),
+             "{\"ts_us\":%llu,\"event\":\"interval\",\"interval_s\":%.3f,\"frames\":%d,\"dropped_samples\":%llu,"
+             "\"frame_ms\":{\"p50\":%.3f,\"p95\":%.3f,\"p99\":%.3f,\"max\":%.3f},"
+             "\"pieces_per_s\":%.3f,\"lines\":%d,\"lines_total\":%d,\"score\":%d,\"score_per_s\":%.3f,\"apm\":%.1f,"
+             "\"cpu_percent\":%.2f,"
+             "\"assets\":{\"texture_hits\":%d,\"texture_misses\":%d,\"textures_cached\":%d}}\n",
+             static_cast<unsigned long long>(latest.timestampUs), seconds, frames, static_cast<unsigned long long>(dropped),
+             p50, p95, p99, maxFrame,
+             pieces / seconds, lines, latest.linesCleared, latest.points, score / seconds, actions * 60.0 / seconds,
+             cpuPercent, latest.textureCacheHits, latest.textureCacheMisses, latest.texturesCached);
+    line += buffer;
+}
+
+bool Telemetry::ensureOutput() {
+    if (file != nullptr || socketFd != -1) return true;
+
+    if (target.compare(0, UNIX_PREFIX.size(), UNIX_PREFIX) == 0){
+        std::string path = target.substr(UNIX_PREFIX.size());
+
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(address.sun_path)){
+            std::cout << "Telemetry socket path too long: " << path << std::endl;
+            return false;
+        }
+        path.copy(address.sun_path, path.size());
+
+        socketFd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (socketFd == -1) return false;
+
+        if (connect(socketFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0){
+            // Collector not running (yet), try again next interval
+            close(socketFd);
+            socketFd = -1;
+            return false;
+        }
+        return true;
+    }
+
+    file = fopen(target.c_str(), "a");
+    if (file == nullptr){
+        std::cout << "Failed to open telemetry file: " << target << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void Telemetry::writeOutput(const std::string& data) {
+    if (!ensureOutput()) return;
+
+    if (file != nullptr){
+        fwrite(data.data(), 1, data.size(), file);
+        fflush(file);
+        return;
+    }
+
+    size_t written = 0;
+    while (written < data.size()){
+        ssize_t result = send(socketFd, data.data() + written, data.size() - written, MSG_NOSIGNAL);
+        if (result <= 0){
+            // Collector went away, reconnect on the next interval
+            close(socketFd);
+            socketFd = -1;
+            return;
+        }
+        written += result;
+    }
+}
+
+void Telemetry::closeOutput() {
+    if (file != nullptr){
+        fclose(file);
+        file = nullptr;
+    }
+    if (socketFd != -1){
+        close(socketFd);
+        socketFd = -1;
+    }
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "RingBuffer.h"
+
+enum class GameOverCause{
+    NONE,
+    BLOCK_OUT, // New block spawned on top of the stack
+    QUIT,      // Window closed mid game
+};
+
+// One sample is pushed by the main loop every frame. Counters are cumulative,
+// rates and percentiles are worked out by the export thread.
+struct TelemetrySample{
+    uint64_t timestampUs;
+    float frameMs;
+
+    int points;
+    int piecesPlaced;
+    int linesCleared;
+    int actions;
+
+    int textureCacheHits;
+    int textureCacheMisses;
+    int texturesCached;
+
+    GameOverCause gameOver;
+};
+
+// Collects gameplay and performance metrics and periodically exports them as
+// newline-delimited JSON. Target is either a file path or "unix:<socket path>".
+class Telemetry{
+public:
+    explicit Telemetry(const std::string& target, int exportIntervalMs = 1000);
+    ~Telemetry();
+
+    void record(const TelemetrySample& sample);
+
+    static uint64_t nowUs();
+
+private:
+    static constexpr size_t SAMPLE_CAPACITY = 4096;
+
+    RingBuffer<TelemetrySample, SAMPLE_CAPACITY> samples;
+    std::atomic<uint64_t> droppedSamples{0};
+
+    std::string target;
+    const int exportIntervalMs;
+
+    FILE* file = nullptr;
+    int socketFd = -1;
+
+    std::thread exportThread;
+    std::mutex stopMutex;
+    std::condition_variable stopCondition;
+    bool stopping = false;
+
+    // Export thread state
+    uint64_t lastExportUs = 0;
+    double lastCpuSeconds = 0;
+    bool hasLast = false;
+    TelemetrySample last{};
+    std::vector<float> frameTimes;
+    std::string line;
+
+    void exportLoop();
+    void exportBatch();
+    void appendGameOver(const TelemetrySample& sample);
+    void appendInterval(const TelemetrySample& first, const TelemetrySample& latest, int frames, uint64_t dropped,
+                        double cpuPercent);
+    void appendIdle(double seconds, double cpuPercent);
+
+    // User and system time the whole process has used so far
+    static double processCpuSeconds();
+
+    bool ensureOutput();
+    void writeOutput(const std::string& data);
+    void closeOutput();
+};
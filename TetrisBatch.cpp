@@ -0,0 +1,323 @@
+#include "TetrisBatch.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+#include "TetrisGame.h"
+
+namespace {
+    constexpr int BLOCK_TYPES = static_cast<int>(TetrominoType::P) + 1;
+    constexpr int MAX_ROTATIONS = 4;
+    constexpr int MATRIX_ROWS = 4;
+
+    // Rows are stored with wall bits around the board, PAD_X to the left and the rest of the word
+    // to the right, and PAD_Y solid rows above and below. Blocks in range of the board can then be
+    // tested without bounds checks: a cell outside the board hits a wall bit.
+    constexpr int PAD_X = 4;
+    constexpr int PAD_Y = 4;
+    constexpr uint32_t SOLID = ~0u;
+
+    // Block matrices as one bit mask per matrix row, bit 0 is the leftmost column
+    struct ShapeTable{
+        std::array<std::array<std::array<uint32_t, MATRIX_ROWS>, MAX_ROTATIONS>, BLOCK_TYPES> rows{};
+        std::array<int, BLOCK_TYPES> rotations{};
+        std::array<int, BLOCK_TYPES> matrixSizeX{};
+    };
+
+    const ShapeTable& shapeTable(){
+        static const ShapeTable table = []{
+            ShapeTable result;
+            for (int type = 1; type < BLOCK_TYPES; type++){
+                std::unique_ptr<Tetromino> block = Tetromino::create(static_cast<TetrominoType>(type), 0, 0);
+                result.rotations[type] = std::min(block->getRotationCount(), MAX_ROTATIONS);
+                result.matrixSizeX[type] = block->getMatrixSizeX();
+
+                for (int rotation = 0; rotation < result.rotations[type]; rotation++){
+                    block->setPose(0, 0, rotation);
+                    const BlockShape& shape = block->getShape();
+                    for (int i = 0; i < shape.count; i++){
+                        result.rows[type][rotation][shape.y[i]] |= 1u << shape.x[i];
+                    }
+                }
+            }
+            return result;
+        }();
+        return table;
+    }
+
+    // Bytes of 0 and 1 for every combination of 8 cells, observations are written 8 cells at a time
+    const std::array<uint64_t, 256>& cellBytes(){
+        static const std::array<uint64_t, 256> table = []{
+            std::array<uint64_t, 256> result{};
+            for (int bits = 0; bits < 256; bits++){
+                uint8_t bytes[8];
+                for (int i = 0; i < 8; i++){
+                    bytes[i] = (bits >> i) & 1;
+                }
+                memcpy(&result[bits], bytes, sizeof(bytes));
+            }
+            return result;
+        }();
+        return table;
+    }
+
+    constexpr int8_t ACTION_DX[TETRIS_ACTION_COUNT] = {0, -1, 1, 0, 0, 0};
+    constexpr int8_t ACTION_ROTATION[TETRIS_ACTION_COUNT] = {0, 0, 0, 1, -1, 0};
+}
+
+// Struct of arrays: the state of environment i is element i of every array, so the per step loops
+// read the blocks of neighbouring environments from consecutive memory. Row y of every board is one
+// contiguous array too, which puts the rows of one board count elements apart: a collision test
+// reads four of them, one per cache line once count is 16 or more, and is not vectorised.
+struct TetrisBatch{
+    int count, width, height, stepsPerGravity;
+    uint32_t emptyRow;
+
+    std::vector<uint32_t> rows; // (y + PAD_Y) * count + env
+
+    std::vector<int32_t> x, y, rotation;
+    std::vector<uint8_t> type, next;
+    std::vector<int32_t> points;
+    std::vector<int32_t> gravityCounter;
+
+    std::vector<uint32_t> seeds;
+    std::vector<uint32_t> games;
+    std::vector<std::mt19937> random;
+
+    // Per step scratch
+    std::vector<uint8_t> locking;
+    std::vector<float> stepRewards;
+    std::vector<uint8_t> stepDones;
+
+    uint32_t& row(int env, int rowY){ return rows[static_cast<size_t>(rowY + PAD_Y) * count + env]; }
+    uint32_t row(int env, int rowY) const { return rows[static_cast<size_t>(rowY + PAD_Y) * count + env]; }
+
+    bool collides(int env, int blockType, int blockRotation, int blockX, int blockY) const{
+        const std::array<uint32_t, MATRIX_ROWS>& mask = shapeTable().rows[blockType][blockRotation];
+        const uint32_t* column = rows.data() + static_cast<size_t>(blockY + PAD_Y) * count + env;
+        const int shift = blockX + PAD_X;
+
+        uint32_t hit = 0;
+        for (int dy = 0; dy < MATRIX_ROWS; dy++){
+            hit |= column[static_cast<size_t>(dy) * count] & (mask[dy] << shift);
+        }
+        return hit != 0;
+    }
+
+    // Same as TetrisGame::newBlock after the current block locked. False is game over.
+    bool spawn(int env){
+        int blockType = next[env];
+        type[env] = next[env];
+        next[env] = static_cast<uint8_t>(TetrisGame::randomType(random[env]));
+
+        x[env] = width/2 - shapeTable().matrixSizeX[blockType]/2;
+        y[env] = 0;
+        rotation[env] = 0;
+        return !collides(env, blockType, 0, x[env], 0);
+    }
+
+    void reset(int env){
+        for (int rowY = 0; rowY < height; rowY++){
+            row(env, rowY) = emptyRow;
+        }
+
+        random[env].seed(seeds[env] + games[env] * static_cast<uint32_t>(count));
+        next[env] = static_cast<uint8_t>(TetrisGame::randomType(random[env]));
+        spawn(env);
+
+        points[env] = 0;
+        gravityCounter[env] = 0;
+    }
+
+    // Returns the rows cleared
+    int lock(int env){
+        const std::array<uint32_t, MATRIX_ROWS>& mask = shapeTable().rows[type[env]][rotation[env]];
+        const int shift = x[env] + PAD_X;
+
+        int lowest = -1;
+        for (int dy = 0; dy < MATRIX_ROWS; dy++){
+            if (mask[dy] == 0) continue;
+            row(env, y[env] + dy) |= mask[dy] << shift;
+            lowest = y[env] + dy;
+        }
+
+        // Only rows the block landed in can have been filled, everything above them moves down
+        int cleared = 0;
+        for (int rowY = lowest; rowY >= 0; rowY--){
+            uint32_t value = row(env, rowY);
+            if (value == SOLID){
+                cleared++;
+            }
+            else if (cleared > 0){
+                row(env, rowY + cleared) = value;
+            }
+        }
+        for (int rowY = 0; rowY < cleared; rowY++){
+            row(env, rowY) = emptyRow;
+        }
+        return cleared;
+    }
+
+    void writeObservation(int env, uint8_t* out) const{
+        const std::array<uint64_t, 256>& bytes = cellBytes();
+        for (int rowY = 0; rowY < height; rowY++){
+            uint32_t value = row(env, rowY) >> PAD_X;
+            uint8_t* cells = out + static_cast<size_t>(rowY) * width;
+            for (int cellX = 0; cellX < width; cellX += 8){
+                memcpy(cells + cellX, &bytes[(value >> cellX) & 0xFF], std::min(8, width - cellX));
+            }
+        }
+
+        const std::array<uint32_t, MATRIX_ROWS>& mask = shapeTable().rows[type[env]][rotation[env]];
+        for (int dy = 0; dy < MATRIX_ROWS; dy++){
+            for (uint32_t bits = mask[dy]; bits != 0; bits &= bits - 1){
+                out[static_cast<size_t>(y[env] + dy) * width + x[env] + __builtin_ctz(bits)] = TETRIS_CELL_FALLING;
+            }
+        }
+
+        out[static_cast<size_t>(width) * height] = type[env];
+        out[static_cast<size_t>(width) * height + 1] = next[env];
+    }
+};
+
+extern "C" {
+
+TetrisBatch* tetris_batch_create(int count, int width, int height, int steps_per_gravity, const uint32_t* seeds) {
+    if (count < 1 || width < 4 || width > TETRIS_BATCH_MAX_WIDTH || height < 4 || steps_per_gravity < 1 || seeds == nullptr){
+        return nullptr;
+    }
+
+    TetrisBatch* batch = new TetrisBatch();
+    batch->count = count;
+    batch->width = width;
+    batch->height = height;
+    batch->stepsPerGravity = steps_per_gravity;
+    batch->emptyRow = ~(((1u << width) - 1) << PAD_X);
+
+    batch->rows.assign(static_cast<size_t>(height + 2 * PAD_Y) * count, SOLID);
+    batch->x.resize(count);
+    batch->y.resize(count);
+    batch->rotation.resize(count);
+    batch->type.resize(count);
+    batch->next.resize(count);
+    batch->points.resize(count);
+    batch->gravityCounter.resize(count);
+    batch->seeds.assign(seeds, seeds + count);
+    batch->games.assign(count, 0);
+    batch->random.resize(count);
+    batch->locking.resize(count);
+    batch->stepRewards.resize(count);
+    batch->stepDones.resize(count);
+
+    for (int env = 0; env < count; env++){
+        batch->reset(env);
+    }
+    return batch;
+}
+
+void tetris_batch_destroy(TetrisBatch* batch) {
+    delete batch;
+}
+
+size_t tetris_batch_observation_size(const TetrisBatch* batch) {
+    return static_cast<size_t>(batch->width) * batch->height + 2;
+}
+
+void tetris_batch_reset(TetrisBatch* batch, const uint32_t* seeds, uint8_t* observations) {
+    size_t observationSize = tetris_batch_observation_size(batch);
+    for (int env = 0; env < batch->count; env++){
+        if (seeds != nullptr) batch->seeds[env] = seeds[env];
+        batch->games[env] = 0;
+        batch->reset(env);
+        if (observations != nullptr) batch->writeObservation(env, observations + env * observationSize);
+    }
+}
+
+void tetris_batch_step(TetrisBatch* batch, const uint8_t* actions, uint8_t* observations, float* rewards, uint8_t* dones) {
+    TetrisBatch& b = *batch;
+    const int count = b.count;
+    const ShapeTable& shapes = shapeTable();
+
+    // Moves and rotations, chosen with conditional moves rather than jumps. The collision test
+    // reads the board with a stride, so the compiler keeps this a scalar loop.
+    for (int env = 0; env < count; env++){
+        int action = actions[env] < TETRIS_ACTION_COUNT ? actions[env] : static_cast<int>(TETRIS_ACTION_NONE);
+        int blockType = b.type[env];
+        int rotations = shapes.rotations[blockType];
+
+        int newX = b.x[env] + ACTION_DX[action];
+        int newRotation = b.rotation[env] + ACTION_ROTATION[action];
+        newRotation += newRotation < 0 ? rotations : 0;
+        newRotation -= newRotation >= rotations ? rotations : 0;
+
+        bool blocked = b.collides(env, blockType, newRotation, newX, b.y[env]);
+        b.x[env] = blocked ? b.x[env] : newX;
+        b.rotation[env] = blocked ? b.rotation[env] : newRotation;
+
+        bool gravity = ++b.gravityCounter[env] >= b.stepsPerGravity;
+        b.gravityCounter[env] = gravity ? 0 : b.gravityCounter[env];
+
+        // 1 locks after a hard drop, 2 after falling onto something
+        bool hardDrop = action == TETRIS_ACTION_HARD_DROP;
+        b.locking[env] = hardDrop ? 1 : 0;
+        b.locking[env] |= (!hardDrop && gravity) ? 2 : 0;
+    }
+
+    // Falling is a move down that locks the block if it is blocked. Only environments whose block
+    // falls or drops this step get past the first test, and a hard drop loops down row by row.
+    for (int env = 0; env < count; env++){
+        b.stepRewards[env] = 0;
+        b.stepDones[env] = 0;
+        if (b.locking[env] == 0) continue;
+
+        if (b.locking[env] == 2){
+            if (!b.collides(env, b.type[env], b.rotation[env], b.x[env], b.y[env] + 1)){
+                b.y[env]++;
+                continue;
+            }
+        }
+        else{
+            while (!b.collides(env, b.type[env], b.rotation[env], b.x[env], b.y[env] + 1)) b.y[env]++;
+        }
+
+        int cleared = b.lock(env);
+        int score = TetrisGame::scoreForLines(cleared);
+        b.points[env] += score;
+        b.stepRewards[env] = static_cast<float>(score);
+
+        if (!b.spawn(env)){
+            b.stepDones[env] = 1;
+            b.games[env]++;
+            b.reset(env);
+        }
+    }
+
+    std::copy(b.stepRewards.begin(), b.stepRewards.end(), rewards);
+    std::copy(b.stepDones.begin(), b.stepDones.end(), dones);
+
+    if (observations != nullptr){
+        size_t observationSize = tetris_batch_observation_size(batch);
+        for (int env = 0; env < count; env++){
+            b.writeObservation(env, observations + env * observationSize);
+        }
+    }
+}
+
+int tetris_batch_cell(const TetrisBatch* batch, int env, int x, int y) {
+    return (batch->row(env, y) >> (x + PAD_X)) & 1;
+}
+
+void tetris_batch_block(const TetrisBatch* batch, int env, int* type, int* x, int* y, int* rotation) {
+    *type = batch->type[env];
+    *x = batch->x[env];
+    *y = batch->y[env];
+    *rotation = batch->rotation[env];
+}
+
+int tetris_batch_points(const TetrisBatch* batch, int env) {
+    return batch->points[env];
+}
+
+}
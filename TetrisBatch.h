@@ -0,0 +1,63 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// C interface for stepping many independent games in lockstep, e.g. from Python with ctypes.
+// Every game follows the rules of TetrisGame: a step applies the action like
+// TetrisGame::applyInput, then one gravity step like TetrisGame::gameLoop every
+// steps_per_gravity steps, unless the action was a hard drop. Rewards are the points
+// TetrisGame::scoreForLines gives for the rows cleared during the step.
+//
+// A game that ends is reset in the same step: its done flag is set, its reward is that of the
+// last step, and its observation is already the first one of the next game. Game k (counting
+// from 0) of environment i is seeded with seeds[i] + k * count, so seeding with 0..count-1 never
+// plays the same sequence twice. With the same seed a game gets the same blocks as TetrisGame.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum{
+    TETRIS_ACTION_NONE,
+    TETRIS_ACTION_LEFT,
+    TETRIS_ACTION_RIGHT,
+    TETRIS_ACTION_ROTATE_CW,
+    TETRIS_ACTION_ROTATE_CCW,
+    TETRIS_ACTION_HARD_DROP,
+    TETRIS_ACTION_COUNT,
+};
+
+// Observations are width * height cells, row by row from the top, followed by the type of the
+// falling block and the type of the next block (TetrominoType values)
+enum{
+    TETRIS_CELL_EMPTY,
+    TETRIS_CELL_LOCKED,
+    TETRIS_CELL_FALLING,
+};
+
+#define TETRIS_BATCH_MAX_WIDTH 24
+
+typedef struct TetrisBatch TetrisBatch;
+
+// Null if the arguments are out of range. seeds has count entries.
+TetrisBatch* tetris_batch_create(int count, int width, int height, int steps_per_gravity, const uint32_t* seeds);
+void tetris_batch_destroy(TetrisBatch* batch);
+
+// Bytes of one environment's observation
+size_t tetris_batch_observation_size(const TetrisBatch* batch);
+
+// Starts a new game in every environment. observations may be null.
+void tetris_batch_reset(TetrisBatch* batch, const uint32_t* seeds, uint8_t* observations);
+
+// actions, rewards and dones have one entry per environment, observations
+// count * tetris_batch_observation_size bytes. observations may be null when they are not needed.
+void tetris_batch_step(TetrisBatch* batch, const uint8_t* actions, uint8_t* observations, float* rewards, uint8_t* dones);
+
+// For checking a single environment against TetrisGame
+int tetris_batch_cell(const TetrisBatch* batch, int env, int x, int y);
+void tetris_batch_block(const TetrisBatch* batch, int env, int* type, int* x, int* y, int* rotation);
+int tetris_batch_points(const TetrisBatch* batch, int env);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,182 @@
+#include "TetrisGame.h"
+#include "Trace.h"
+
+TetrisGame::TetrisGame(int BLOCKS_X, int BLOCKS_Y, uint32_t seed)
+        : BLOCKS_X(BLOCKS_X), BLOCKS_Y(BLOCKS_Y), grid(Board::create(BLOCKS_X, BLOCKS_Y)), random(seed) {
+    GameStepResult result;
+    newBlock(result);
+}
+
+TetrisGame::TetrisGame(const TetrisGame& other) {
+    *this = other;
+}
+
+TetrisGame& TetrisGame::operator=(const TetrisGame& other) {
+    if (this == &other) return *this;
+
+    BLOCKS_X = other.BLOCKS_X;
+    BLOCKS_Y = other.BLOCKS_Y;
+
+    grid = other.grid->clone();
+    currentBlock = std::make_unique<Tetromino>(*other.currentBlock);
+    nextBlock = std::make_unique<Tetromino>(*other.nextBlock);
+
+    random = other.random;
+
+    points = other.points;
+    piecesPlaced = other.piecesPlaced;
+    linesCleared = other.linesCleared;
+    ticks = other.ticks;
+    gameOver = other.gameOver;
+
+    return *this;
+}
+
+GameStepResult TetrisGame::gameLoop() {
+    GameStepResult result;
+    if (gameOver) return result;
+
+    ticks++;
+
+    CollisionType collisionType = currentBlock->tryMove(*grid, 0, 1);
+    if (collisionType == COLLISION_BLOCKS) newBlock(result);
+
+    return result;
+}
+
+GameStepResult TetrisGame::applyInput(GameInput input) {
+    GameStepResult result;
+    if (gameOver) return result;
+
+    switch (input){
+        case GameInput::ROTATE_CW:
+            currentBlock->tryRotation(*grid, 1);
+            break;
+        case GameInput::ROTATE_CCW:
+            currentBlock->tryRotation(*grid, -1);
+            break;
+        case GameInput::MOVE_LEFT:
+            currentBlock->tryMove(*grid, -1, 0);
+            break;
+        case GameInput::MOVE_RIGHT:
+            currentBlock->tryMove(*grid, 1, 0);
+            break;
+        case GameInput::HARD_DROP: // SLAM
+            currentBlock->drop(*grid);
+            result.hardDrop = true;
+            newBlock(result);
+            break;
+    }
+
+    return result;
+}
+
+void TetrisGame::newBlock(GameStepResult& result) {
+    TRACE_ZONE("TetrisGame::newBlock");
+    if (currentBlock){
+        currentBlock->lockToBoard(*grid);
+        piecesPlaced++;
+        result.locked = true;
+        result.lockedPose = {currentBlock->getType(), currentBlock->getRotation(), currentBlock->getX(), currentBlock->getY()};
+
+        // Only rows touched by the locked block can have been filled
+        int fromY = currentBlock->getY();
+        {
+            TRACE_ZONE("Board::clearFullRows");
+            result.linesCleared = grid->clearFullRows(fromY, fromY + currentBlock->getMatrixSizeY() - 1);
+        }
+
+        linesCleared += result.linesCleared;
+        points += scoreForLines(result.linesCleared);
+    }
+
+    if (!nextBlock){
+        nextBlock = getRandomBlock();
+        nextBlock->forceMove(0, 1); // Center
+    }
+
+    currentBlock = std::move(nextBlock);
+    currentBlock->forceMove( BLOCKS_X/2-currentBlock->getMatrixSizeX()/2 ,-1);
+
+    nextBlock = getRandomBlock();
+    nextBlock->forceMove(0, 1); // Center
+
+
+    if (currentBlock->tryMove(*grid, 0, 0) != CollisionType::NO_COLLISION){
+        // Game over
+        gameOver = true;
+        result.gameOver = true;
+    }
+}
+
+uint64_t TetrisGame::checksum() const {
+    // FNV-1a
+    uint64_t hash = 14695981039346656037ull;
+    auto add = [&hash](uint64_t value){
+        hash ^= value;
+        hash *= 1099511628211ull;
+    };
+
+    for (int y = 0; y < BLOCKS_Y; y++){
+        for (int x = 0; x < BLOCKS_X; x++){
+            add(static_cast<uint64_t>(grid->get(x, y)));
+        }
+    }
+
+    for (const Tetromino* block : {currentBlock.get(), nextBlock.get()}){
+        add(static_cast<uint64_t>(block->getType()));
+        add(block->getRotation());
+        add(block->getX());
+        add(block->getY());
+    }
+
+    add(points);
+    add(piecesPlaced);
+    add(ticks);
+    add(gameOver);
+
+    return hash;
+}
+
+int TetrisGame::scoreForLines(int lines) {
+    switch(lines){
+        case 0:
+            return 0;
+        case 1:
+            return 40;
+        case 2:
+            return 100;
+        case 3:
+            return 300;
+        case 4:
+            return 1200;
+        default:
+            return 1000000;
+    }
+}
+
+float TetrisGame::gravityInterval(int points) {
+    return 1.0f / (points/1000.0f + 3);
+}
+
+std::unique_ptr<Tetromino> TetrisGame::getRandomBlock() {
+    return Tetromino::create(randomType(random), 0, 0);
+}
+
+TetrominoType TetrisGame::randomType(std::mt19937& random) {
+    // Plain modulo instead of a distribution, so the sequence is the same with every standard library
+    static constexpr TetrominoType TYPES[] = {
+            TetrominoType::I, TetrominoType::O, TetrominoType::T, TetrominoType::L,
+            TetrominoType::J, TetrominoType::S, TetrominoType::Z,
+    };
+    return TYPES[random() % 7];
+}
+
+std::vector<TetrominoType> TetrisGame::previewBlocks(int count) const {
+    std::mt19937 copy = random;
+    std::vector<TetrominoType> types;
+    for (int i = 0; i < count; i++){
+        types.push_back(randomType(copy));
+    }
+    return types;
+}
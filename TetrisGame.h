@@ -0,0 +1,85 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+#include "Board.h"
+#include "Tetromino.h"
+
+enum class GameInput{
+    MOVE_LEFT,
+    MOVE_RIGHT,
+    ROTATE_CW,
+    ROTATE_CCW,
+    HARD_DROP,
+};
+
+// Where the block that locked during a step came to rest
+struct LockedPose{
+    TetrominoType type = TetrominoType::EMPTY;
+    int rotation = 0;
+    int x = 0, y = 0;
+};
+
+// What happened during one call into the game, the window posts it as GameEvents
+struct GameStepResult{
+    bool locked = false;
+    LockedPose lockedPose;
+    bool hardDrop = false;
+    int linesCleared = 0;
+    bool gameOver = false;
+};
+
+// Rules of the game without any rendering or audio. Given the same seed and the same
+// sequence of calls, two games always end up in the same state.
+class TetrisGame{
+public:
+    TetrisGame(int BLOCKS_X, int BLOCKS_Y, uint32_t seed);
+    TetrisGame(const TetrisGame& other);
+    TetrisGame& operator=(const TetrisGame& other);
+
+    // One gravity step
+    GameStepResult gameLoop();
+    GameStepResult applyInput(GameInput input);
+
+    const Board& getBoard() const { return *grid; }
+    const Tetromino& getCurrentBlock() const { return *currentBlock; }
+    const Tetromino& getNextBlock() const { return *nextBlock; }
+
+    // Types of the count blocks that come after the next block, without changing the game
+    std::vector<TetrominoType> previewBlocks(int count) const;
+
+    int getPoints() const { return points; }
+    int getPiecesPlaced() const { return piecesPlaced; }
+    int getLinesCleared() const { return linesCleared; }
+    int getTicks() const { return ticks; }
+    bool isGameOver() const { return gameOver; }
+
+    // Hash of everything that affects how the game continues, for comparing two copies
+    uint64_t checksum() const;
+
+    static int scoreForLines(int lines);
+
+    // The block the game draws next from random, for simulations that must give the same sequence
+    static TetrominoType randomType(std::mt19937& random);
+
+    // Seconds between gravity steps, the game speeds up as the score goes up
+    static float gravityInterval(int points);
+
+private:
+    int BLOCKS_X, BLOCKS_Y;
+
+    std::unique_ptr<Board> grid;
+    std::unique_ptr<Tetromino> currentBlock, nextBlock;
+
+    std::mt19937 random;
+
+    int points = 0;
+    int piecesPlaced = 0;
+    int linesCleared = 0;
+    int ticks = 0;
+    bool gameOver = false;
+
+    void newBlock(GameStepResult& result);
+    std::unique_ptr<Tetromino> getRandomBlock();
+};
@@ -1,252 +1,428 @@
 #include "TetrisWindow.h"
 #include <SDL.h>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
 #include <iostream>
-#include <random>
 #include <utility>
+#include "Trace.h"
+
+
+std::map<TetrominoType, Texture> TetrisWindow::tetrominoTextures = {
+        {TetrominoType::L, Texture::BLOCK_L},
+        {TetrominoType::J, Texture::BLOCK_J},
+        {TetrominoType::I, Texture::BLOCK_I},
+        {TetrominoType::O, Texture::BLOCK_O},
+        {TetrominoType::S, Texture::BLOCK_S},
+        {TetrominoType::T, Texture::BLOCK_T},
+        {TetrominoType::Z, Texture::BLOCK_Z},
+};
+
+TetrisWindow::TetrisWindow(int BLOCK_SIZE, int BLOCKS_X, int BLOCKS_Y, int MAX_VIEW_WIDTH, int MAX_VIEW_HEIGHT,
+                           GameEventBus* events, SDL_Renderer *renderer, std::shared_ptr<ResourceManager> resourceManager,
+                           uint32_t seed, RenderBackend backend)
+        : BLOCKS_X(BLOCKS_X), BLOCKS_Y(BLOCKS_Y),
+          game(BLOCKS_X, BLOCKS_Y, seed), renderer(renderer), backend(backend),
+          resourceManager(std::move(resourceManager)), events(events){
+
+    layOut(BLOCK_SIZE, MAX_VIEW_WIDTH, MAX_VIEW_HEIGHT);
+    createTextures();
+
+    if (events != nullptr) events->post({GameEventType::GAME_STARTED, game.getPoints()});
+}
 
+void TetrisWindow::resize(int BLOCK_SIZE, int MAX_VIEW_WIDTH, int MAX_VIEW_HEIGHT) {
+    TRACE_ZONE("TetrisWindow::resize");
+    int oldWidth = WIDTH, oldHeight = HEIGHT, oldBlockSize = this->BLOCK_SIZE;
+    layOut(BLOCK_SIZE, MAX_VIEW_WIDTH, MAX_VIEW_HEIGHT);
+    if (WIDTH == oldWidth && HEIGHT == oldHeight && BLOCK_SIZE == oldBlockSize) return;
 
-TetrisWindow::TetrisWindow(int BLOCK_SIZE, int BLOCKS_X, int BLOCKS_Y, int* points,
-                           SDL_Renderer *renderer, std::shared_ptr<ResourceManager> resourceManager)
-        : BLOCK_SIZE(BLOCK_SIZE), BLOCKS_X(BLOCKS_X), BLOCKS_Y(BLOCKS_Y), renderer(renderer), points(points), resourceManager(std::move(resourceManager)),
-          WIDTH(BLOCK_SIZE * BLOCKS_X + BLOCKS_X - 2),
-          HEIGHT(BLOCK_SIZE * BLOCKS_Y + BLOCKS_Y - 2){
-
-    // Initialize grid
-    grid = std::vector<std::vector<GridElement>>(BLOCKS_Y, std::vector<GridElement>(BLOCKS_X, {TetrominoType::EMPTY}));
-
-    const int PREVIEW_DIMENSIONS = 4; // Biggest block, n x n grid
+    // Textures of the old size would never be asked for again, the game itself carries on
+    resourceManager->releaseRenderTarget(texture, false);
+    resourceManager->releaseRenderTarget(nextBlockPreviewTexture, false);
+    createTextures();
+}
 
-    nextBlockGrid = std::vector<std::vector<GridElement>>(PREVIEW_DIMENSIONS, std::vector<GridElement>(PREVIEW_DIMENSIONS, {TetrominoType::EMPTY})); // Biggest block is 4
+void TetrisWindow::layOut(int BLOCK_SIZE, int MAX_VIEW_WIDTH, int MAX_VIEW_HEIGHT) {
+    this->BLOCK_SIZE = BLOCK_SIZE;
+    VIEW_BLOCKS_X = std::max(1, std::min(BLOCKS_X, (MAX_VIEW_WIDTH + 1) / (BLOCK_SIZE + 1)));
+    VIEW_BLOCKS_Y = std::max(1, std::min(BLOCKS_Y, (MAX_VIEW_HEIGHT + 1) / (BLOCK_SIZE + 1)));
+    WIDTH = BLOCK_SIZE * VIEW_BLOCKS_X + VIEW_BLOCKS_X - 2;
+    HEIGHT = BLOCK_SIZE * VIEW_BLOCKS_Y + VIEW_BLOCKS_Y - 2;
 
     NEXT_PREVIEW_WIDTH = BLOCK_SIZE * PREVIEW_DIMENSIONS + PREVIEW_DIMENSIONS-2;
     NEXT_PREVIEW_HEIGHT = BLOCK_SIZE * PREVIEW_DIMENSIONS + PREVIEW_DIMENSIONS-2;
+}
 
-    newBlock();
+void TetrisWindow::createTextures() {
+    // Streaming textures match the sprites' pixel format, so rows are copied as they are
+    Uint32 format = SDL_PIXELFORMAT_RGBA8888;
+    int access = SDL_TEXTUREACCESS_TARGET;
+    if (backend == RenderBackend::STREAMING){
+        format = SDL_PIXELFORMAT_ARGB8888;
+        access = SDL_TEXTUREACCESS_STREAMING;
+        loadSprites();
+    }
 
-    // Create texture
-    texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, WIDTH, HEIGHT);
+    // Create texture, only as big as the visible part of the board. The resource manager hands
+    // out the textures of the previous game when a new one starts with the same size.
+    texture = resourceManager->acquireRenderTarget(WIDTH, HEIGHT, format, access);
     if (texture == nullptr){
         throw std::runtime_error("Could not create texture: " + std::string(SDL_GetError()));
     }
 
-    nextBlockPreviewTexture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, NEXT_PREVIEW_WIDTH, NEXT_PREVIEW_HEIGHT);
+    nextBlockPreviewTexture = resourceManager->acquireRenderTarget(NEXT_PREVIEW_WIDTH, NEXT_PREVIEW_HEIGHT, format, access);
     if (nextBlockPreviewTexture == nullptr){
+        resourceManager->releaseRenderTarget(texture);
+        texture = nullptr;
         throw std::runtime_error("Could not create texture: " + std::string(SDL_GetError()));
     }
 }
 
+TetrisWindow::~TetrisWindow() {
+    resourceManager->releaseRenderTarget(texture);
+    resourceManager->releaseRenderTarget(nextBlockPreviewTexture);
+}
+
 
 void TetrisWindow::renderLoop() {
-    if (gameOver) return;
+    if (hint.valid() && hint.wait_for(std::chrono::seconds(0)) == std::future_status::ready){
+        printHint(hint.get());
+    }
+    if (game.isGameOver()) return;
 
-    renderGrid(texture, grid, currentBlock.get());
-    renderGrid(nextBlockPreviewTexture, nextBlockGrid, nextBlock.get());
+    renderState(game.getBoard(), &game.getCurrentBlock(), &game.getNextBlock());
 }
 
-void TetrisWindow::gameLoop() {
-    if (!currentBlock)return;
-
-    CollisionType collisionType = currentBlock->tryMove(grid, 0, 1);
-    if (collisionType == COLLISION_BLOCKS) newBlock();
+void TetrisWindow::renderState(const Board& board, const Tetromino* currentBlock, const Tetromino* nextBlock) {
+    if (currentBlock != nullptr) updateCamera(*currentBlock);
+    renderGrid(board, currentBlock);
+    renderPreview(nextBlock);
+}
 
+void TetrisWindow::gameLoop() {
+    TRACE_ZONE("TetrisWindow::gameLoop");
+    handleResult(game.gameLoop());
 }
 
 void TetrisWindow::onKeyPress(SDL_Keycode key) {
 
-    if (!currentBlock)return;
     if (key == SDLK_UP){
-        currentBlock->tryRotation(grid, 1);
+        handleResult(game.applyInput(GameInput::ROTATE_CW));
     }
     else if (key == SDLK_DOWN){
-        currentBlock->tryRotation(grid, -1);
+        handleResult(game.applyInput(GameInput::ROTATE_CCW));
     }
     else if (key == SDLK_LEFT){
-        currentBlock->tryMove(grid, -1, 0);
+        handleResult(game.applyInput(GameInput::MOVE_LEFT));
     }
     else if (key == SDLK_RIGHT){
-        currentBlock->tryMove(grid, 1, 0);
+        handleResult(game.applyInput(GameInput::MOVE_RIGHT));
     }
     else if (key == SDLK_SPACE){ // SLAM
-        while (currentBlock->tryMove(grid, 0, 1) == NO_COLLISION){}
-        resourceManager->playSound(Sound::DROP);
-        newBlock();
+        handleResult(game.applyInput(GameInput::HARD_DROP));
+    }
+    else if (key == SDLK_h){
+        showHint();
+    }
+}
+
+void TetrisWindow::showHint() {
+    TRACE_ZONE("TetrisWindow::showHint");
+    if (hint.valid()){
+        std::cout << "Hint: still searching" << std::endl;
+        return;
+    }
+    SolverPosition position = SolverPosition::fromGame(game, HINT_PREVIEW_BLOCKS);
+
+    if (!hintPositionFile.empty()){
+        std::ofstream file(hintPositionFile);
+        position.write(file);
     }
+
+    // Up to the solver's time budget, too long to hold up a frame
+    if (!solver) solver = std::make_unique<Solver>();
+    Solver* search = solver.get();
+    hint = std::async(std::launch::async, [search, position]{
+        TRACE_THREAD_NAME("hint");
+        return search->solve(position);
+    });
+}
+
+void TetrisWindow::printHint(const SolverResult& result) {
+    if (!result.found){
+        std::cout << "Hint: no perfect clear with the next " << result.deepestSearched << " blocks ("
+                  << result.elapsedMs << " ms)" << std::endl;
+        return;
+    }
+
+    std::cout << "Hint: perfect clear in " << result.moves.size() << " blocks, " << result.inputCount << " inputs:";
+    for (const SolverMove& move : result.moves){
+        std::cout << " |";
+        for (GameInput input : move.inputs){
+            std::cout << " " << Solver::inputName(input);
+        }
+    }
+    std::cout << " (" << result.elapsedMs << " ms)" << std::endl;
 }
 
 void TetrisWindow::onKeyRelease(SDL_Keycode key) {
 
 }
 
-void TetrisWindow::newBlock() {
-    if (currentBlock){
-        currentBlock->drawToGrid(grid, true);
-        checkRows();
+void TetrisWindow::setGame(const TetrisGame& state, const GameStepResult& events) {
+    game = state;
+    handleResult(events);
+}
+
+void TetrisWindow::setRecorder(SpectatorWriter* recorder) {
+    this->recorder = recorder;
+    if (recorder != nullptr){
+        recorder->requestKeyframe();
+        recorder->record(game, {});
     }
+}
 
-    if (!nextBlock){
-        nextBlock = getRandomBlock();
-        nextBlock->forceMove(0, 1); // Center
+void TetrisWindow::setObservationPublisher(ObservationPublisher* publisher) {
+    this->publisher = publisher;
+    if (publisher != nullptr){
+        publisher->beginGame(game);
     }
+}
 
-    currentBlock = std::move(nextBlock);
-    currentBlock->forceMove( BLOCKS_X/2-currentBlock->getMatrixSizeX()/2 ,-1);
+void TetrisWindow::setHintPositionFile(const std::string& path) {
+    hintPositionFile = path;
+}
 
-    nextBlock = getRandomBlock();
-    nextBlock->forceMove(0, 1); // Center
+void TetrisWindow::handleResult(const GameStepResult& result) {
+    if (recorder != nullptr){
+        recorder->record(game, result);
+    }
+    if (publisher != nullptr){
+        publisher->publish(game, result);
+    }
 
+    if (events == nullptr) return;
 
-    if (currentBlock->tryMove(grid, 0, 0) != CollisionType::NO_COLLISION){
-        // Game over
-        gameOver = true;
-        resourceManager->playSound(Sound::GAME_OVER);
+    if (result.hardDrop){
+        events->post({GameEventType::HARD_DROP});
+    }
+    if (result.locked){
+        events->post({GameEventType::PIECE_LOCKED, game.getPiecesPlaced(), result.lockedPose});
+    }
+    if (result.linesCleared > 0){
+        events->post({GameEventType::LINES_CLEARED, result.linesCleared});
+    }
+    if (game.getPoints() != postedPoints){
+        postedPoints = game.getPoints();
+        events->post({GameEventType::SCORE_CHANGED, postedPoints});
     }
+    if (result.gameOver){
+        events->post({GameEventType::GAME_OVER});
+    }
+}
 
+void TetrisWindow::updateCamera(const Tetromino& currentBlock) {
+    // Keep the falling block centered, clamped to the board edges
+    int centerX = currentBlock.getX() + currentBlock.getMatrixSizeX()/2;
+    int centerY = currentBlock.getY() + currentBlock.getMatrixSizeY()/2;
 
+    cameraX = std::max(0, std::min(BLOCKS_X - VIEW_BLOCKS_X, centerX - VIEW_BLOCKS_X/2));
+    cameraY = std::max(0, std::min(BLOCKS_Y - VIEW_BLOCKS_Y, centerY - VIEW_BLOCKS_Y/2));
 }
 
-void TetrisWindow::checkRows() {
+void TetrisWindow::renderGrid(const Board& grid, const Tetromino* currentBlock) {
+    TRACE_ZONE("TetrisWindow::renderGrid");
+    if (backend == RenderBackend::STREAMING){
+        rasterizeGrid(grid, currentBlock);
+        return;
+    }
 
-    std::vector<int> indexes;
+    SDL_Texture* atlas = resourceManager->acquireBlockAtlas(BLOCK_SIZE);
+    SDL_SetRenderTarget(renderer, texture);
 
-    for (int y = 0; y < BLOCKS_Y; y++){
+    // Background
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+    SDL_RenderClear(renderer);
 
-        int blockCount = 0;
-        for (int x = 0; x < BLOCKS_X; x++){
-            if (grid[y][x].type != TetrominoType::EMPTY && grid[y][x].isStatic)blockCount++;
-        }
+    // Static blocks, only the cells inside the viewport
+    for (int y = 0; y < VIEW_BLOCKS_Y; y++){
+        for (int x = 0; x < VIEW_BLOCKS_X; x++){
+            TetrominoType type = grid.get(cameraX + x, cameraY + y);
+            if (type == TetrominoType::EMPTY) continue;
 
-        if (blockCount == BLOCKS_X){
-            // Clear row
-            for (int x = 0; x < BLOCKS_X; x++){
-                grid[y][x] = {TetrominoType::EMPTY};
-            }
-            indexes.push_back(y);
+            drawCell(x, y, type, atlas);
         }
     }
 
-    if (!indexes.empty()){
-        resourceManager->playSound(Sound::CLEAR_ROW);
-    }
-    switch(indexes.size()){
-        case 0:
-            break;
-        case 1:
-            *points += 40;
-            break;
-        case 2:
-            *points += 100;
-            break;
-        case 3:
-            *points += 300;
-            break;
-        case 4:
-            *points += 1200;
-            break;
-        default:
-            *points += 1000000;
-            break;
+    // Current dynamic block
+    if (currentBlock != nullptr){
+        drawBlock(*currentBlock, -cameraX, -cameraY, VIEW_BLOCKS_X, VIEW_BLOCKS_Y, atlas);
     }
 
+    drawGridLines(VIEW_BLOCKS_X, VIEW_BLOCKS_Y, WIDTH, HEIGHT);
 
+    SDL_SetRenderTarget(renderer, NULL);
+    resourceManager->releaseBlockAtlas(BLOCK_SIZE);
+}
 
-    // Indexes are from top down
-    for (int moveLoc : indexes){
-        for (int i = 0; i < moveLoc-1; i++){
-            int y = moveLoc - i;
-            std::swap(grid[y], grid[y-1]);
+void TetrisWindow::renderPreview(const Tetromino* nextBlock) {
+    TRACE_ZONE("TetrisWindow::renderPreview");
+    if (backend == RenderBackend::STREAMING){
+        rasterizePreview(nextBlock);
+        return;
+    }
 
-        }
+    SDL_Texture* atlas = resourceManager->acquireBlockAtlas(BLOCK_SIZE);
+    SDL_SetRenderTarget(renderer, nextBlockPreviewTexture);
+
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+    SDL_RenderClear(renderer);
+
+    if (nextBlock != nullptr){
+        drawBlock(*nextBlock, 0, 0, PREVIEW_DIMENSIONS, PREVIEW_DIMENSIONS, atlas);
     }
 
+    drawGridLines(PREVIEW_DIMENSIONS, PREVIEW_DIMENSIONS, NEXT_PREVIEW_WIDTH, NEXT_PREVIEW_HEIGHT);
+
+    SDL_SetRenderTarget(renderer, NULL);
+    resourceManager->releaseBlockAtlas(BLOCK_SIZE);
 }
 
-std::unique_ptr<Tetromino> TetrisWindow::getRandomBlock() {
+void TetrisWindow::drawCell(int x, int y, TetrominoType type, SDL_Texture* atlas) {
+    int yPos = y*BLOCK_SIZE + y;
+    int xPos = x*BLOCK_SIZE + x;
 
-    std::unique_ptr<Tetromino> randomBlock;
+    auto blockTexture = tetrominoTextures.find(type);
+    if (blockTexture != tetrominoTextures.end() && atlas != nullptr){
+        SDL_Rect source = ResourceManager::blockAtlasRect(blockTexture->second, BLOCK_SIZE);
+        SDL_Rect dest = {xPos, yPos, BLOCK_SIZE, BLOCK_SIZE};
+        SDL_RenderCopy(renderer, atlas, &source, &dest);
+    }
+    else if (blockTexture != tetrominoTextures.end()){
+        resourceManager->drawImage(xPos, yPos, BLOCK_SIZE, BLOCK_SIZE, blockTexture->second);
+    }else{
+        SDL_Rect rect = {xPos, yPos, BLOCK_SIZE, BLOCK_SIZE};
+        Color gottenColor = Tetromino::tetrominoToColor(type);
+        SDL_SetRenderDrawColor(renderer, gottenColor.r, gottenColor.g, gottenColor.b, gottenColor.a);
+        SDL_RenderFillRect(renderer, &rect);
+    }
+}
 
-    static std::random_device r;
-    static std::default_random_engine rand(r());
+void TetrisWindow::drawBlock(const Tetromino& block, int offsetX, int offsetY, int cellsX, int cellsY, SDL_Texture* atlas) {
+    const std::vector<std::vector<int>>& matrix = block.getBlockMatrix();
 
-    int blockRand = std::uniform_int_distribution<>{0, 6}(rand);
+    for (int y = 0; y < block.getMatrixSizeY(); y++){
+        for (int x = 0; x < block.getMatrixSizeX(); x++){
+            if (matrix[y][x] == 0) continue;
 
-    switch(blockRand){
-        case 0:
-            randomBlock = std::make_unique<TetrominoI>(0, 0);
-            break;
-        case 1:
-            randomBlock = std::make_unique<TetrominoO>(0, 0);
-            break;
-        case 2:
-            randomBlock = std::make_unique<TetrominoT>(0, 0);
-            break;
-        case 3:
-            randomBlock = std::make_unique<TetrominoL>(0, 0);
-            break;
-        case 4:
-            randomBlock = std::make_unique<TetrominoJ>(0, 0);
-            break;
-        case 5:
-            randomBlock = std::make_unique<TetrominoS>(0, 0);
-            break;
-        case 6:
-            randomBlock = std::make_unique<TetrominoZ>(0, 0);
-            break;
-        case 7:
-            //currentBlock = std::make_unique<TetrominoP>(4, 0);
-            break;
-    }
+            int cellX = block.getX() + x + offsetX;
+            int cellY = block.getY() + y + offsetY;
+            if (cellX < 0 || cellY < 0 || cellX >= cellsX || cellY >= cellsY) continue;
 
-    return std::move(randomBlock);
+            drawCell(cellX, cellY, block.getType(), atlas);
+        }
+    }
 }
 
-void TetrisWindow::renderGrid(SDL_Texture *texture, std::vector<std::vector<GridElement>> grid, Tetromino* dynamicBlock) {
-    int SIZE_Y = grid.size();
-    int SIZE_X = grid[0].size();
+void TetrisWindow::drawGridLines(int cellsX, int cellsY, int width, int height) {
+    SDL_SetRenderDrawColor(renderer, 200, 200, 200, 255);
+    for (int i = 1; i < cellsX; i++){
+        SDL_RenderDrawLine(renderer, BLOCK_SIZE*i + (i-1), 0, BLOCK_SIZE*i + (i-1), height);
+    }
+    for (int i = 1; i < cellsY; i++){
+        SDL_RenderDrawLine(renderer, 0, BLOCK_SIZE*i + (i-1), width, BLOCK_SIZE*i + (i-1));
+    }
+}
 
-    SDL_SetRenderTarget(renderer, texture);
+namespace {
+    constexpr uint32_t GRID_LINE_COLOR = 0xFFC8C8C8; // ARGB (200, 200, 200)
+    constexpr uint32_t BACKGROUND_COLOR = 0xFF000000;
+}
 
-    // Background
-    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-    SDL_RenderClear(renderer);
+void TetrisWindow::loadSprites() {
+    TRACE_ZONE("TetrisWindow::loadSprites");
+    for (size_t i = 1; i < sprites.size(); i++){
+        TetrominoType type = static_cast<TetrominoType>(i);
+        Sprite& sprite = sprites[i];
 
-    // Clear dynamic blocks
-    for (int y = 0; y < SIZE_Y; y++){
-        for (int x = 0; x < SIZE_X; x++){
-            if (!grid[y][x].isStatic){
-                grid[y][x] = {TetrominoType::EMPTY};
-            }
+        if (tetrominoTextures.count(type) && resourceManager->loadSprite(tetrominoTextures[type], BLOCK_SIZE, BLOCK_SIZE, sprite)){
+            continue;
         }
+
+        Color color = Tetromino::tetrominoToColor(type);
+        uint32_t pixel = static_cast<uint32_t>(color.a) << 24 | color.r << 16 | color.g << 8 | color.b;
+        sprite.width = BLOCK_SIZE;
+        sprite.height = BLOCK_SIZE;
+        sprite.pixels.assign(static_cast<size_t>(BLOCK_SIZE) * BLOCK_SIZE, pixel);
     }
+}
 
-    // Draw current dynamic block
-    dynamicBlock->drawToGrid(grid);
+void TetrisWindow::rasterizeGrid(const Board& grid, const Tetromino* currentBlock) {
+    void* pixels;
+    int pitch;
+    if (SDL_LockTexture(texture, NULL, &pixels, &pitch) != 0){
+        std::cout << "Could not lock texture: " << SDL_GetError() << std::endl;
+        return;
+    }
+    rasterizer.setTarget(static_cast<uint32_t*>(pixels), WIDTH, HEIGHT, pitch);
 
-    // Grid
-    for (int y = 0; y < SIZE_Y; y++){
-        for (int x = 0; x < SIZE_X; x++){
-            int yPos = y*BLOCK_SIZE + y;
-            int xPos = x*BLOCK_SIZE + x;
+    rasterizer.drawGridLines(BLOCK_SIZE, GRID_LINE_COLOR);
 
-            if (Tetromino::tetrominoTextures.count(grid[y][x].type)){
-                resourceManager->drawImage(xPos, yPos, BLOCK_SIZE, BLOCK_SIZE, Tetromino::tetrominoTextures[grid[y][x].type]);
+    for (int y = 0; y < VIEW_BLOCKS_Y; y++){
+        for (int x = 0; x < VIEW_BLOCKS_X; x++){
+            TetrominoType type = grid.get(cameraX + x, cameraY + y);
+            if (type == TetrominoType::EMPTY){
+                rasterizer.fillCell(x, y, BLOCK_SIZE, BACKGROUND_COLOR);
             }else{
-                SDL_Rect rect = {xPos, yPos, BLOCK_SIZE, BLOCK_SIZE};
-                Color gottenColor = Tetromino::tetrominoToColor(grid[y][x].type);
-                SDL_SetRenderDrawColor(renderer, gottenColor.r, gottenColor.g, gottenColor.b, gottenColor.a);
-                SDL_RenderFillRect(renderer, &rect);
+                rasterizer.blitCell(x, y, sprites[static_cast<size_t>(type)]);
             }
-
         }
     }
 
-    // Background lines
-    SDL_SetRenderDrawColor(renderer, 200, 200, 200, 255);
-    for (int i = 1; i < SIZE_X; i++){
-        SDL_RenderDrawLine(renderer, BLOCK_SIZE*i + (i-1), 0, BLOCK_SIZE*i + (i-1), HEIGHT);
+    if (currentBlock != nullptr){
+        rasterizeBlock(*currentBlock, -cameraX, -cameraY, VIEW_BLOCKS_X, VIEW_BLOCKS_Y);
     }
-    for (int i = 1; i < SIZE_Y; i++){
-        SDL_RenderDrawLine(renderer, 0, BLOCK_SIZE*i + (i-1), WIDTH, BLOCK_SIZE*i + (i-1));
+
+    SDL_UnlockTexture(texture);
+}
+
+void TetrisWindow::rasterizePreview(const Tetromino* nextBlock) {
+    void* pixels;
+    int pitch;
+    if (SDL_LockTexture(nextBlockPreviewTexture, NULL, &pixels, &pitch) != 0){
+        std::cout << "Could not lock texture: " << SDL_GetError() << std::endl;
+        return;
     }
+    rasterizer.setTarget(static_cast<uint32_t*>(pixels), NEXT_PREVIEW_WIDTH, NEXT_PREVIEW_HEIGHT, pitch);
 
-    SDL_SetRenderTarget(renderer, NULL);
+    rasterizer.drawGridLines(BLOCK_SIZE, GRID_LINE_COLOR);
+    for (int y = 0; y < PREVIEW_DIMENSIONS; y++){
+        for (int x = 0; x < PREVIEW_DIMENSIONS; x++){
+            rasterizer.fillCell(x, y, BLOCK_SIZE, BACKGROUND_COLOR);
+        }
+    }
+
+    if (nextBlock != nullptr){
+        rasterizeBlock(*nextBlock, 0, 0, PREVIEW_DIMENSIONS, PREVIEW_DIMENSIONS);
+    }
+
+    SDL_UnlockTexture(nextBlockPreviewTexture);
+}
+
+void TetrisWindow::rasterizeBlock(const Tetromino& block, int offsetX, int offsetY, int cellsX, int cellsY) {
+    const std::vector<std::vector<int>>& matrix = block.getBlockMatrix();
+    const Sprite& sprite = sprites[static_cast<size_t>(block.getType())];
+
+    for (int y = 0; y < block.getMatrixSizeY(); y++){
+        for (int x = 0; x < block.getMatrixSizeX(); x++){
+            if (matrix[y][x] == 0) continue;
+
+            int cellX = block.getX() + x + offsetX;
+            int cellY = block.getY() + y + offsetY;
+            if (cellX < 0 || cellY < 0 || cellX >= cellsX || cellY >= cellsY) continue;
+
+            rasterizer.blitCell(cellX, cellY, sprite);
+        }
+    }
 }
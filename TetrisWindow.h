@@ -1,29 +1,46 @@
 #pragma once
 #include <SDL.h>
+#include <array>
+#include <future>
+#include <map>
+#include <memory>
+#include <string>
 #include <vector>
-#include "Tetromino.h"
+#include "BoardRasterizer.h"
+#include "GameEvents.h"
+#include "ObservationRing.h"
+#include "TetrisGame.h"
 #include "ResourceManager.h"
-
-enum class TetrominoType;
-class Tetromino;
-
-struct Color{
-    int r, g, b, a;
-};
-
-struct GridElement{
-    TetrominoType type;
-    bool isStatic = true;
+#include "Solver.h"
+#include "SpectatorStream.h"
+
+// How the board and preview textures are drawn: with renderer calls for every cell, or on the
+// CPU into streaming textures that are uploaded once per frame
+enum class RenderBackend{
+    DRAW_CALLS,
+    STREAMING,
 };
 
 class TetrisWindow{
 public:
-    TetrisWindow(int BLOCK_SIZE, int BLOCKS_X, int BLOCKS_Y, int* points, SDL_Renderer* renderer,
-                 std::shared_ptr<ResourceManager> resourceManager);
+    // The board texture covers at most MAX_VIEW_WIDTH x MAX_VIEW_HEIGHT pixels, bigger boards
+    // are shown through a camera following the falling block. What happens in the game is posted
+    // to events, which may be null.
+    TetrisWindow(int BLOCK_SIZE, int BLOCKS_X, int BLOCKS_Y, int MAX_VIEW_WIDTH, int MAX_VIEW_HEIGHT,
+                 GameEventBus* events, SDL_Renderer* renderer, std::shared_ptr<ResourceManager> resourceManager, uint32_t seed,
+                 RenderBackend backend = RenderBackend::DRAW_CALLS);
+    ~TetrisWindow();
+
+    // New block size or room on screen, e.g. after the window was resized. Only the textures
+    // are made again, the game carries on.
+    void resize(int BLOCK_SIZE, int MAX_VIEW_WIDTH, int MAX_VIEW_HEIGHT);
 
     void renderLoop();
     void gameLoop();
 
+    // Draws a board that is not this window's game, e.g. one played back from a SpectatorReader
+    void renderState(const Board& board, const Tetromino* currentBlock, const Tetromino* nextBlock);
+
     void onKeyPress(SDL_Keycode key);
     void onKeyRelease(SDL_Keycode key);
 
@@ -36,32 +53,84 @@ public:
     SDL_Texture* getTexture() const { return texture; }
     SDL_Texture* getBlockPreviewTexture() const { return nextBlockPreviewTexture; }
 
-    bool isGameOver() const { return gameOver;};
+    bool isGameOver() const { return game.isGameOver();};
+
+    int getPiecesPlaced() const { return game.getPiecesPlaced(); }
+    int getLinesCleared() const { return game.getLinesCleared(); }
+
+    const TetrisGame& getGame() const { return game; }
+
+    // Shows a game that is simulated elsewhere, events are played as if they happened here
+    void setGame(const TetrisGame& state, const GameStepResult& events);
+
+    // Every step of the game is written to recorder, which must outlive the window
+    void setRecorder(SpectatorWriter* recorder);
+
+    // Every step is also published to observers in other processes, publisher must outlive the window
+    void setObservationPublisher(ObservationPublisher* publisher);
+
+    // Positions searched for hints are saved to path, for pc_solver to search them for longer
+    void setHintPositionFile(const std::string& path);
 
 private:
-    const int WIDTH, HEIGHT;
+    const int BLOCKS_X, BLOCKS_Y;
+    int BLOCK_SIZE;
+    int VIEW_BLOCKS_X, VIEW_BLOCKS_Y;
+    int WIDTH, HEIGHT;
 
-    const int BLOCK_SIZE, BLOCKS_X, BLOCKS_Y;
+    static constexpr int PREVIEW_DIMENSIONS = 4; // Biggest block, n x n grid
     int NEXT_PREVIEW_HEIGHT;
     int NEXT_PREVIEW_WIDTH;
 
-    std::vector<std::vector<GridElement>> grid, nextBlockGrid;
+    TetrisGame game;
 
-    SDL_Renderer* renderer;
-    SDL_Texture* texture;
-    SDL_Texture* nextBlockPreviewTexture;
+    // Top left cell of the visible part of the board
+    int cameraX = 0, cameraY = 0;
 
-    std::unique_ptr<Tetromino> currentBlock, nextBlock;
+    SDL_Renderer* renderer;
+    const RenderBackend backend;
+    SDL_Texture* texture = nullptr;
+    SDL_Texture* nextBlockPreviewTexture = nullptr;
 
     std::shared_ptr<ResourceManager> resourceManager;
 
-    void newBlock();
-    void checkRows();
+    SpectatorWriter* recorder = nullptr;
+    ObservationPublisher* publisher = nullptr;
+
+    // Perfect clear hints, searched with the next block and this many more from the seed. The
+    // search runs on its own thread and renderLoop prints the result when it is done.
+    static constexpr int HINT_PREVIEW_BLOCKS = 8;
+    std::string hintPositionFile; // Positions are not saved while empty
+    std::unique_ptr<Solver> solver; // Created on first use, its table is kept between hints
+    std::future<SolverResult> hint; // Declared after solver, so it waits for the search first
+
+    void showHint();
+    void printHint(const SolverResult& result);
+
+    void handleResult(const GameStepResult& result);
+    void updateCamera(const Tetromino& currentBlock);
+
+    GameEventBus* events;
+    int postedPoints = 0;
+
+    static std::map<TetrominoType, Texture> tetrominoTextures;
+
+    void layOut(int BLOCK_SIZE, int MAX_VIEW_WIDTH, int MAX_VIEW_HEIGHT);
+    void createTextures();
 
-    int* points;
+    void renderGrid(const Board& grid, const Tetromino* currentBlock);
+    void renderPreview(const Tetromino* nextBlock);
+    // atlas holds the block images at BLOCK_SIZE, acquired for the texture being drawn. May be null.
+    void drawCell(int x, int y, TetrominoType type, SDL_Texture* atlas);
+    void drawBlock(const Tetromino& block, int offsetX, int offsetY, int cellsX, int cellsY, SDL_Texture* atlas);
+    void drawGridLines(int cellsX, int cellsY, int width, int height);
 
-    bool gameOver = false;
+    // Streaming backend
+    BoardRasterizer rasterizer;
+    std::array<Sprite, static_cast<size_t>(TetrominoType::P) + 1> sprites; // Filled color if there is no image
 
-    static std::unique_ptr<Tetromino> getRandomBlock();
-    void renderGrid(SDL_Texture* texture, std::vector<std::vector<GridElement>> grid, Tetromino* dynamicBlock);
+    void loadSprites();
+    void rasterizeGrid(const Board& grid, const Tetromino* currentBlock);
+    void rasterizePreview(const Tetromino* nextBlock);
+    void rasterizeBlock(const Tetromino& block, int offsetX, int offsetY, int cellsX, int cellsY);
 };
\ No newline at end of file
@@ -1,21 +1,34 @@
 #include "Tetromino.h"
 #include <iostream>
+#include "Board.h"
 
 
 Tetromino::Tetromino(int x, int y, TetrominoType type)
     : X_LOC(x), Y_LOC(y), type(type){
 }
 
-std::map<TetrominoType, Texture> Tetromino::tetrominoTextures = {
-        {TetrominoType::L, Texture::BLOCK_L},
-        {TetrominoType::J, Texture::BLOCK_J},
-        {TetrominoType::I, Texture::BLOCK_I},
-        {TetrominoType::O, Texture::BLOCK_O},
-        {TetrominoType::S, Texture::BLOCK_S},
-        {TetrominoType::T, Texture::BLOCK_T},
-        {TetrominoType::Z, Texture::BLOCK_Z},
-};
-
+std::unique_ptr<Tetromino> Tetromino::create(TetrominoType type, int x, int y) {
+    switch (type){
+        case TetrominoType::I:
+            return std::make_unique<TetrominoI>(x, y);
+        case TetrominoType::J:
+            return std::make_unique<TetrominoJ>(x, y);
+        case TetrominoType::L:
+            return std::make_unique<TetrominoL>(x, y);
+        case TetrominoType::O:
+            return std::make_unique<TetrominoO>(x, y);
+        case TetrominoType::S:
+            return std::make_unique<TetrominoS>(x, y);
+        case TetrominoType::T:
+            return std::make_unique<TetrominoT>(x, y);
+        case TetrominoType::Z:
+            return std::make_unique<TetrominoZ>(x, y);
+        case TetrominoType::P:
+            return std::make_unique<TetrominoP>(x, y);
+        default:
+            return nullptr;
+    }
+}
 
 Color Tetromino::tetrominoToColor(TetrominoType type) {
     switch (type){
@@ -62,49 +75,38 @@ int Tetromino::getMatrixSizeY() const {
     return getBlockMatrix().size();
 }
 
-CollisionType Tetromino::checkCollisions(std::vector<std::vector<GridElement>> &grid) {
-    for (int y = 0; y < getMatrixSizeY(); y++){
-        for (int x = 0; x < getMatrixSizeX(); x++){
-
-            if (getBlockMatrix()[y][x] == 0)continue;
-
-            int coordY = y+Y_LOC;
-            int coordX = x+X_LOC;
-
-            if (coordY < 0 || coordY >= grid.size()) return COLLISION_BLOCKS;
-            if (coordX < 0 || coordX >= grid[y].size())return COLLISION_SIDES;
-
-            GridElement el = grid[coordY][coordX];
-
-            if (el.isStatic && el.type != TetrominoType::EMPTY) return COLLISION_BLOCKS;
-
+const BlockShape& Tetromino::getShape() const {
+    if (shapes.empty()){
+        for (const std::vector<std::vector<int>>& matrix : rotationMatrix){
+            BlockShape shape;
+            for (size_t y = 0; y < matrix.size(); y++){
+                for (size_t x = 0; x < matrix[y].size(); x++){
+                    if (matrix[y][x] == 0) continue;
+
+                    shape.x[shape.count] = x;
+                    shape.y[shape.count] = y;
+                    shape.count++;
+                }
+            }
+            shapes.push_back(shape);
         }
-
     }
 
-    return NO_COLLISION;
+    return shapes[rotationStatus];
 }
 
-void Tetromino::drawToGrid(std::vector<std::vector<GridElement>> &grid, bool setStatic) {
-    for (int y = 0; y < getMatrixSizeY(); y++){
-        for (int x = 0; x < getMatrixSizeX(); x++){
-
-            if (getBlockMatrix()[y][x] == 0)continue;
-
-            int coordY = y+Y_LOC;
-            int coordX = x+X_LOC;
-
-            grid[coordY][coordX] = {getType(), setStatic};
-
-        }
+CollisionType Tetromino::checkCollisions(const Board& board) const {
+    return board.queryCollision(type, rotationStatus, getShape(), X_LOC, Y_LOC);
+}
 
-    }
+void Tetromino::lockToBoard(Board& board) const {
+    board.lock(getShape(), X_LOC, Y_LOC, getType());
 }
 
-CollisionType Tetromino::tryMove(std::vector<std::vector<GridElement>> &grid, int x, int y) {
+CollisionType Tetromino::tryMove(const Board& board, int x, int y) {
     move(x, y);
 
-    CollisionType colType = checkCollisions(grid);
+    CollisionType colType = checkCollisions(board);
 
     if (colType != CollisionType::NO_COLLISION){
         move(-x, -y);
@@ -113,9 +115,13 @@ CollisionType Tetromino::tryMove(std::vector<std::vector<GridElement>> &grid, in
     return colType;
 }
 
-CollisionType Tetromino::tryRotation(std::vector<std::vector<GridElement>> &grid, int rotation) {
+void Tetromino::drop(const Board& board) {
+    Y_LOC = board.dropPosition(type, rotationStatus, getShape(), X_LOC, Y_LOC);
+}
+
+CollisionType Tetromino::tryRotation(const Board& board, int rotation) {
     rotate(rotation);
-    CollisionType colType = checkCollisions(grid);
+    CollisionType colType = checkCollisions(board);
 
     if (colType != CollisionType::NO_COLLISION){
         rotate(-rotation);
@@ -127,3 +133,10 @@ CollisionType Tetromino::tryRotation(std::vector<std::vector<GridElement>> &grid
 void Tetromino::forceMove(int x, int y) {
     move(x, y);
 }
+
+void Tetromino::setPose(int x, int y, int rotation) {
+    X_LOC = x;
+    Y_LOC = y;
+    rotationStatus = 0;
+    rotate(rotation);
+}
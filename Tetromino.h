@@ -1,12 +1,16 @@
 #pragma once
+#include <array>
+#include <cstdint>
+#include <memory>
 #include <vector>
-#include "TetrisWindow.h"
-#include "ResourceManager.h"
 
-struct Color;
-struct GridElement;
+class Board;
 
-enum class TetrominoType{
+struct Color{
+    int r, g, b, a;
+};
+
+enum class TetrominoType : uint8_t{
     EMPTY,
     I,
     J,
@@ -24,23 +28,40 @@ enum CollisionType{
     COLLISION_BLOCKS,
 };
 
+// Occupied cells of one rotation, relative to the top left of the block matrix
+struct BlockShape{
+    static constexpr int MAX_CELLS = 5;
+
+    int count = 0;
+    std::array<int8_t, MAX_CELLS> x{}, y{};
+};
+
 class Tetromino {
 public:
     Tetromino(int x, int y, TetrominoType type);
 
+    static std::unique_ptr<Tetromino> create(TetrominoType type, int x, int y);
+
     TetrominoType getType() const {return type;};
 
-    std::vector<std::vector<int>> getBlockMatrix() const {return rotationMatrix[rotationStatus];};
+    const std::vector<std::vector<int>>& getBlockMatrix() const {return rotationMatrix[rotationStatus];};
+    const BlockShape& getShape() const;
 
-    CollisionType tryRotation(std::vector<std::vector<GridElement>>& grid, int rotation);
-    CollisionType tryMove(std::vector<std::vector<GridElement>>& grid, int x, int y);
+    CollisionType tryRotation(const Board& board, int rotation);
+    CollisionType tryMove(const Board& board, int x, int y);
+    void drop(const Board& board); // Straight down as far as it goes
     void forceMove(int x, int y); // Used for spawning from one grid to another
+    void setPose(int x, int y, int rotation); // Used for replaying a recorded block
 
-    void drawToGrid(std::vector<std::vector<GridElement>>& grid, bool setStatic = false);
+    void lockToBoard(Board& board) const;
 
     static Color tetrominoToColor(TetrominoType type);
-    static std::map<TetrominoType, Texture> tetrominoTextures;
 
+    int getRotation() const { return rotationStatus; }
+    int getX() const { return X_LOC; }
+    int getY() const { return Y_LOC; }
+
+    int getRotationCount() const { return rotationMatrix.size(); }
 
     int getMatrixSizeX() const;
     int getMatrixSizeY() const;
@@ -55,7 +76,9 @@ private:
 
     TetrominoType type;
 
-    CollisionType checkCollisions(std::vector<std::vector<GridElement>>& grid);
+    CollisionType checkCollisions(const Board& board) const;
+
+    mutable std::vector<BlockShape> shapes; // Built from rotationMatrix on first use
 
 protected:
 
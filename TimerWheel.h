@@ -0,0 +1,78 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Hashed timing wheel with millisecond slots. Scheduling is O(1), timers further out than one
+// turn of the wheel wait in their slot until the wheel comes around often enough. There is no
+// cancel: owners tag their timers, e.g. with a generation they bump to invalidate the timers
+// already scheduled, and ignore timers whose tag no longer matches.
+class TimerWheel{
+public:
+    static constexpr size_t SLOTS = 512; // Power of two
+
+    explicit TimerWheel(uint64_t nowMs) : currentMs(nowMs) {}
+
+    // Deadlines that already passed fire on the next advance
+    void schedule(uint64_t id, uint64_t deadlineMs, uint32_t tag = 0){
+        uint64_t slotMs = deadlineMs < currentMs ? currentMs : deadlineMs;
+        slots[slotMs & (SLOTS - 1)].push_back({id, deadlineMs, tag});
+        count++;
+    }
+
+    // Calls expired(id, tag) for every timer due at or before nowMs. Timers scheduled from
+    // inside the callback fire on the next advance at the earliest.
+    template<typename F>
+    void advance(uint64_t nowMs, F&& expired){
+        if (nowMs < currentMs) return;
+
+        // After a long stall every slot is visited once instead of once per millisecond
+        uint64_t lastMs = nowMs - currentMs >= SLOTS ? currentMs + SLOTS - 1 : nowMs;
+        uint64_t fromMs = currentMs;
+        currentMs = nowMs + 1;
+
+        for (uint64_t ms = fromMs; ms <= lastMs && count > 0; ms++){
+            std::vector<Timer>& slot = slots[ms & (SLOTS - 1)];
+            due.clear();
+
+            size_t kept = 0;
+            for (const Timer& timer : slot){
+                if (timer.deadlineMs <= nowMs) due.push_back(timer);
+                else slot[kept++] = timer;
+            }
+            slot.resize(kept);
+            count -= due.size();
+
+            for (const Timer& timer : due){
+                expired(timer.id, timer.tag);
+            }
+        }
+    }
+
+    // Milliseconds until the next slot with timers in it, -1 without any timers. Can be too
+    // early for timers more than one turn out, never too late.
+    int64_t msUntilNext(uint64_t nowMs) const{
+        if (count == 0) return -1;
+        if (nowMs < currentMs) nowMs = currentMs;
+
+        for (uint64_t ms = currentMs; ms < currentMs + SLOTS; ms++){
+            if (!slots[ms & (SLOTS - 1)].empty()) return ms > nowMs ? ms - nowMs : 0;
+        }
+        return SLOTS;
+    }
+
+    size_t size() const { return count; }
+
+private:
+    struct Timer{
+        uint64_t id;
+        uint64_t deadlineMs;
+        uint32_t tag;
+    };
+
+    std::array<std::vector<Timer>, SLOTS> slots;
+    std::vector<Timer> due;
+    uint64_t currentMs;
+    size_t count = 0;
+};
@@ -0,0 +1,160 @@
+#include "Trace.h"
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+    enum class Phase : char{
+        ZONE = 'X',
+        COUNTER = 'C',
+    };
+
+    struct TraceEvent{
+        const char* name;
+        uint64_t startNs;
+        uint64_t durationNs;
+        double value;
+        Phase phase;
+    };
+
+    // Written by the owning thread only. The count is published with release so write()
+    // can read the finished events while the thread keeps recording.
+    struct Chunk{
+        static constexpr size_t CAPACITY = 4096;
+
+        TraceEvent events[CAPACITY];
+        std::atomic<size_t> count{0};
+        std::atomic<Chunk*> next{nullptr};
+    };
+
+    struct ThreadBuffer{
+        int id = 0;
+        std::atomic<const char*> name{nullptr};
+
+        std::unique_ptr<Chunk> head = std::make_unique<Chunk>();
+        Chunk* tail = head.get();
+
+        ~ThreadBuffer(){
+            Chunk* chunk = head.release();
+            while (chunk != nullptr){
+                Chunk* next = chunk->next.load(std::memory_order_relaxed);
+                delete chunk;
+                chunk = next;
+            }
+        }
+
+        void push(const TraceEvent& event){
+            size_t count = tail->count.load(std::memory_order_relaxed);
+            if (count == Chunk::CAPACITY){
+                Chunk* chunk = new Chunk();
+                tail->next.store(chunk, std::memory_order_release);
+                tail = chunk;
+                count = 0;
+            }
+
+            tail->events[count] = event;
+            tail->count.store(count + 1, std::memory_order_release);
+        }
+    };
+
+    // Buffers outlive their threads, so events of threads that already exited are written too
+    std::mutex buffersMutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+
+    uint64_t originNs = 0;
+
+    ThreadBuffer& threadBuffer(){
+        thread_local ThreadBuffer* buffer = nullptr;
+        if (buffer == nullptr){
+            std::lock_guard<std::mutex> lock(buffersMutex);
+            buffers.push_back(std::make_unique<ThreadBuffer>());
+            buffer = buffers.back().get();
+            buffer->id = buffers.size();
+        }
+        return *buffer;
+    }
+
+    void writeEvent(FILE* file, int threadId, const TraceEvent& event, bool& first){
+        fprintf(file, first ? "\n" : ",\n");
+        first = false;
+
+        double timestampUs = (event.startNs - originNs) / 1000.0;
+        if (event.phase == Phase::ZONE){
+            fprintf(file, R"({"name":"%s","ph":"X","ts":%.3f,"dur":%.3f,"pid":1,"tid":%d})",
+                    event.name, timestampUs, event.durationNs / 1000.0, threadId);
+        }else{
+            fprintf(file, R"({"name":"%s","ph":"C","ts":%.3f,"pid":1,"tid":%d,"args":{"value":%g}})",
+                    event.name, timestampUs, threadId, event.value);
+        }
+    }
+}
+
+std::atomic<bool> Trace::recording{false};
+
+void Trace::start() {
+    if (!COMPILED_IN){
+        std::cout << "Tracing is compiled out, configure with -DTETRIS_TRACING=ON" << std::endl;
+        return;
+    }
+
+    originNs = nowNs();
+    recording.store(true);
+}
+
+bool Trace::write(const std::string& path) {
+    if (!recording.exchange(false)) return false;
+
+    FILE* file = fopen(path.c_str(), "w");
+    if (file == nullptr){
+        std::cout << "Could not open trace file: " << path << std::endl;
+        return false;
+    }
+
+    fprintf(file, R"({"displayTimeUnit":"ms","traceEvents":[)");
+    bool first = true;
+    size_t events = 0;
+
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    for (const std::unique_ptr<ThreadBuffer>& buffer : buffers){
+        const char* name = buffer->name.load(std::memory_order_acquire);
+        if (name != nullptr){
+            fprintf(file, first ? "\n" : ",\n");
+            first = false;
+            fprintf(file, R"({"name":"thread_name","ph":"M","pid":1,"tid":%d,"args":{"name":"%s"}})", buffer->id, name);
+        }
+
+        for (Chunk* chunk = buffer->head.get(); chunk != nullptr; chunk = chunk->next.load(std::memory_order_acquire)){
+            size_t count = chunk->count.load(std::memory_order_acquire);
+            for (size_t i = 0; i < count; i++){
+                writeEvent(file, buffer->id, chunk->events[i], first);
+            }
+            events += count;
+        }
+    }
+
+    fprintf(file, "\n]}\n");
+    fclose(file);
+
+    std::cout << "Wrote " << events << " trace events to " << path << std::endl;
+    return true;
+}
+
+uint64_t Trace::nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Trace::zone(const char* name, uint64_t startNs, uint64_t endNs) {
+    threadBuffer().push({name, startNs, endNs - startNs, 0, Phase::ZONE});
+}
+
+void Trace::counter(const char* name, double value) {
+    threadBuffer().push({name, nowNs(), 0, value, Phase::COUNTER});
+}
+
+void Trace::threadName(const char* name) {
+    threadBuffer().name.store(name, std::memory_order_release);
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Scoped zones and counters written as Chrome trace JSON, open the file in Perfetto or
+// chrome://tracing. Only compiled in with -DTETRIS_TRACING=ON, otherwise the macros are empty.
+//
+//   TRACE_ZONE("TetrisWindow::renderGrid");  // Until the end of the enclosing scope
+//   TRACE_COUNTER("points", points);
+//   TRACE_THREAD_NAME("telemetry");
+//
+// Names must be string literals, only the pointer is stored. Every thread records into its
+// own buffer without locking, so zones cost two clock reads and a store.
+class Trace{
+public:
+#ifdef TETRIS_TRACING
+    static constexpr bool COMPILED_IN = true;
+#else
+    static constexpr bool COMPILED_IN = false;
+#endif
+
+    // Starts recording, events before this and after write() are ignored
+    static void start();
+    static bool isRecording() { return recording.load(std::memory_order_relaxed); }
+
+    // Stops recording and writes everything recorded so far
+    static bool write(const std::string& path);
+
+    static uint64_t nowNs();
+
+    static void zone(const char* name, uint64_t startNs, uint64_t endNs);
+    static void counter(const char* name, double value);
+    static void threadName(const char* name);
+
+private:
+    static std::atomic<bool> recording;
+};
+
+class TraceZone{
+public:
+    explicit TraceZone(const char* name) : name(name), startNs(Trace::isRecording() ? Trace::nowNs() : 0) {}
+    ~TraceZone(){
+        if (startNs != 0) Trace::zone(name, startNs, Trace::nowNs());
+    }
+
+    TraceZone(const TraceZone&) = delete;
+    TraceZone& operator=(const TraceZone&) = delete;
+
+private:
+    const char* name;
+    uint64_t startNs;
+};
+
+#ifdef TETRIS_TRACING
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_ZONE(name) TraceZone TRACE_CONCAT(traceZone, __LINE__)(name)
+#define TRACE_COUNTER(name, value) do { if (Trace::isRecording()) Trace::counter(name, value); } while (0)
+#define TRACE_THREAD_NAME(name) Trace::threadName(name)
+#else
+#define TRACE_ZONE(name) ((void)0)
+#define TRACE_COUNTER(name, value) ((void)0)
+#define TRACE_THREAD_NAME(name) ((void)0)
+#endif
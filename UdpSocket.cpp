@@ -0,0 +1,114 @@
+#include "UdpSocket.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+UdpSocket::~UdpSocket() {
+    if (fd != -1) close(fd);
+}
+
+bool UdpSocket::open(int localPort) {
+    fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd == -1){
+        std::cout << "Could not create UDP socket: " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(localPort);
+
+    if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0){
+        std::cout << "Could not bind UDP port " << localPort << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool UdpSocket::setPeer(const std::string& host, int port) {
+    addrinfo hints{};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+
+    addrinfo* result = nullptr;
+    if (getaddrinfo(host.c_str(), nullptr, &hints, &result) != 0 || result == nullptr){
+        std::cout << "Could not resolve " << host << std::endl;
+        return false;
+    }
+
+    peer = *reinterpret_cast<sockaddr_in*>(result->ai_addr);
+    peer.sin_port = htons(port);
+    hasPeer = true;
+
+    freeaddrinfo(result);
+    return true;
+}
+
+void UdpSocket::setSimulatedConditions(int latencyMs, int jitterMs, double lossRate) {
+    this->latencyMs = latencyMs;
+    this->jitterMs = jitterMs;
+    this->lossRate = lossRate;
+}
+
+void UdpSocket::send(const uint8_t* data, size_t size) {
+    if (lossRate > 0 && std::uniform_real_distribution<double>(0, 1)(random) < lossRate) return;
+
+    if (latencyMs == 0 && jitterMs == 0){
+        sendNow(data, size);
+        return;
+    }
+
+    int jitter = jitterMs > 0 ? std::uniform_int_distribution<int>(0, jitterMs)(random) : 0;
+    delayed.push_back({nowUs() + (latencyMs + jitter) * 1000ull, std::vector<uint8_t>(data, data + size)});
+    flush();
+}
+
+void UdpSocket::flush() {
+    if (delayed.empty()) return;
+
+    uint64_t now = nowUs();
+
+    // Jitter may let a later packet overtake an earlier one, like on a real network
+    auto due = std::partition(delayed.begin(), delayed.end(), [now](const DelayedPacket& packet){
+        return packet.dueUs > now;
+    });
+    for (auto packet = due; packet != delayed.end(); packet++){
+        sendNow(packet->data.data(), packet->data.size());
+    }
+    delayed.erase(due, delayed.end());
+}
+
+int UdpSocket::receive(uint8_t* buffer, size_t size) {
+    flush();
+
+    while (true){
+        sockaddr_in from{};
+        socklen_t fromLength = sizeof(from);
+
+        ssize_t received = recvfrom(fd, buffer, size, 0, reinterpret_cast<sockaddr*>(&from), &fromLength);
+        if (received <= 0) return 0;
+
+        if (hasPeer && from.sin_port == peer.sin_port && from.sin_addr.s_addr == peer.sin_addr.s_addr){
+            return received;
+        }
+    }
+}
+
+void UdpSocket::sendNow(const uint8_t* data, size_t size) {
+    if (!hasPeer) return;
+    sendto(fd, data, size, 0, reinterpret_cast<const sockaddr*>(&peer), sizeof(peer));
+}
+
+uint64_t UdpSocket::nowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
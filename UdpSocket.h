@@ -0,0 +1,46 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+#include <netinet/in.h>
+
+// Non-blocking UDP socket talking to a single peer. Outgoing packets can be delayed
+// and dropped on purpose to test network code over localhost.
+class UdpSocket{
+public:
+    UdpSocket() = default;
+    ~UdpSocket();
+
+    bool open(int localPort);
+    bool setPeer(const std::string& host, int port);
+
+    void setSimulatedConditions(int latencyMs, int jitterMs, double lossRate);
+
+    void send(const uint8_t* data, size_t size);
+
+    // Returns the packet size, or 0 when nothing is waiting. Packets from other addresses are ignored.
+    int receive(uint8_t* buffer, size_t size);
+
+    // Sends delayed packets that are due, called by send and receive
+    void flush();
+
+private:
+    int fd = -1;
+    sockaddr_in peer{};
+    bool hasPeer = false;
+
+    int latencyMs = 0, jitterMs = 0;
+    double lossRate = 0;
+    std::mt19937 random{std::random_device()()};
+
+    struct DelayedPacket{
+        uint64_t dueUs;
+        std::vector<uint8_t> data;
+    };
+    std::vector<DelayedPacket> delayed;
+
+    void sendNow(const uint8_t* data, size_t size);
+    static uint64_t nowUs();
+};
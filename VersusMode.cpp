@@ -0,0 +1,161 @@
+#include "VersusMode.h"
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include "RollbackSession.h"
+#include "SoundEffects.h"
+#include "TetrisWindow.h"
+#include "UdpSocket.h"
+
+namespace {
+    constexpr int BLOCK_SIZE = 24;
+    constexpr double CONNECTION_LOST_SECONDS = 3;
+
+    FrameInput inputForKey(SDL_Keycode key){
+        switch (key){
+            case SDLK_UP: return inputBit(GameInput::ROTATE_CW);
+            case SDLK_DOWN: return inputBit(GameInput::ROTATE_CCW);
+            case SDLK_LEFT: return inputBit(GameInput::MOVE_LEFT);
+            case SDLK_RIGHT: return inputBit(GameInput::MOVE_RIGHT);
+            case SDLK_SPACE: return inputBit(GameInput::HARD_DROP);
+            default: return 0;
+        }
+    }
+}
+
+int runVersus(SDL_Renderer* renderer, const std::shared_ptr<ResourceManager>& resourceManager,
+              int width, int height, const VersusOptions& options) {
+    UdpSocket socket;
+    if (!socket.open(options.localPort) || !socket.setPeer(options.peerHost, options.peerPort)){
+        return 1;
+    }
+    socket.setSimulatedConditions(options.latencyMs, options.jitterMs, options.lossRate);
+
+    RollbackSession session(socket, options.blocksX, options.blocksY);
+    uint32_t proposedSeed = std::random_device()();
+
+    // Both boards side by side, scores are only shown, the windows never simulate themselves.
+    // Only the local game makes sounds.
+    GameEventBus localEvents, remoteEvents;
+    ScoreKeeper localScore, remoteScore;
+    SoundEffects soundEffects(resourceManager);
+    localEvents.subscribe(&localScore);
+    localEvents.subscribe(&soundEffects);
+    remoteEvents.subscribe(&remoteScore);
+
+    TetrisWindow localWindow(BLOCK_SIZE, options.blocksX, options.blocksY, width/2 - 120, height - 160,
+                             &localEvents, renderer, resourceManager, 0);
+    TetrisWindow remoteWindow(BLOCK_SIZE, options.blocksX, options.blocksY, width/2 - 120, height - 160,
+                              &remoteEvents, renderer, resourceManager, 0);
+
+    const int LOCAL_X = width/4 - localWindow.getWidth()/2 - 40;
+    const int REMOTE_X = 3*width/4 - remoteWindow.getWidth()/2 - 40;
+    const int BOARD_Y = 80;
+
+    using Clock = std::chrono::steady_clock;
+    const auto FRAME_TIME = std::chrono::microseconds(1000000 / RollbackSession::FRAMES_PER_SECOND);
+
+    auto nextFrame = Clock::now();
+    FrameInput pendingInput = 0;
+    bool synchronized = false;
+    bool running = true;
+
+    while (running){
+        SDL_Event event;
+        while (SDL_PollEvent(&event)){
+            if (event.type == SDL_QUIT){
+                running = false;
+            }
+            else if (event.type == SDL_KEYDOWN){
+                if (event.key.keysym.sym == SDLK_ESCAPE) running = false;
+                pendingInput |= inputForKey(event.key.keysym.sym);
+            }
+        }
+
+        // Fixed 60 Hz simulation, catching up a few frames at most after a hiccup
+        int framesRun = 0;
+        while (Clock::now() >= nextFrame && framesRun < 4){
+            nextFrame += FRAME_TIME;
+            framesRun++;
+
+            if (!synchronized){
+                synchronized = session.synchronize(proposedSeed);
+                continue;
+            }
+
+            GameStepResult localResult;
+            if (session.advanceFrame(pendingInput, localResult)){
+                pendingInput = 0;
+                localWindow.setGame(session.getLocalGame(), localResult);
+                remoteWindow.setGame(session.getRemoteGame(), {});
+            }
+        }
+        if (framesRun == 4) nextFrame = Clock::now();
+
+        localEvents.dispatch();
+        remoteEvents.dispatch();
+
+        // Rendering
+        SDL_SetRenderTarget(renderer, NULL);
+        SDL_SetRenderDrawColor(renderer, 0, 23, 66, 255);
+        SDL_RenderClear(renderer);
+        resourceManager->drawImage(0, 0, width, height, Texture::BACKGROUND);
+
+        for (TetrisWindow* window : {&localWindow, &remoteWindow}){
+            int boardX = window == &localWindow ? LOCAL_X : REMOTE_X;
+            window->renderLoop();
+
+            SDL_Rect boardLoc = {boardX, BOARD_Y, window->getWidth(), window->getHeight()};
+            SDL_RenderCopy(renderer, window->getTexture(), NULL, &boardLoc);
+
+            SDL_Rect previewLoc = {boardX + window->getWidth() + 10, BOARD_Y + BLOCK_SIZE,
+                                   window->getBlockPreviewWidth(), window->getBlockPreviewHeight()};
+            SDL_RenderCopy(renderer, window->getBlockPreviewTexture(), NULL, &previewLoc);
+        }
+
+        resourceManager->drawText(LOCAL_X, BOARD_Y - 50, "You: " + std::to_string(localScore.getPoints()),
+                                  FontSize::SMALL, {255, 255, 255, 255});
+        resourceManager->drawText(REMOTE_X, BOARD_Y - 50, "Opponent: " + std::to_string(remoteScore.getPoints()),
+                                  FontSize::SMALL, {255, 255, 255, 255});
+
+        const RollbackStats& stats = session.getStats();
+        char hud[160];
+        snprintf(hud, sizeof(hud), "Frame %d  rollback %d (max %d)  resim %.0f us (max %.0f)  stalls %ld  desyncs %ld",
+                 stats.frame, stats.lastRollbackDepth, stats.maxRollbackDepth,
+                 stats.lastResimulationUs, stats.maxResimulationUs, stats.stalledFrames, stats.desyncs);
+        resourceManager->drawText(10, height - 20, hud, FontSize::X_SMALL, {255, 255, 255, 255});
+
+        std::string message;
+        if (!synchronized){
+            message = "Waiting for opponent...";
+        }
+        else if (session.getSilenceSeconds() > CONNECTION_LOST_SECONDS){
+            message = "Connection lost";
+        }
+        else if (session.getLocalGame().isGameOver() || session.getRemoteGame().isGameOver()){
+            // First one to top out loses, the score decides when both have
+            bool localOver = session.getLocalGame().isGameOver();
+            bool remoteOver = session.getRemoteGame().isGameOver();
+
+            bool won = localOver && remoteOver ? localScore.getPoints() > remoteScore.getPoints() : remoteOver;
+            message = won ? "YOU WIN" : "YOU LOSE";
+        }
+
+        if (!message.empty()){
+            resourceManager->drawText(width/2, height/2, message, FontSize::LARGE, {255, 255, 255, 255}, true);
+        }
+
+        SDL_RenderPresent(renderer);
+
+        if (Clock::now() < nextFrame) SDL_Delay(1);
+    }
+
+    const RollbackStats& stats = session.getStats();
+    std::cout << "Versus ended at frame " << stats.frame << ": " << stats.rollbacks << " rollbacks, "
+              << stats.resimulatedFrames << " frames resimulated, max depth " << stats.maxRollbackDepth
+              << ", max resimulation " << stats.maxResimulationUs << " us, " << stats.stalledFrames
+              << " stalled frames, " << stats.desyncs << "/" << stats.checksumsCompared << " checksums mismatched"
+              << std::endl;
+    return 0;
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <SDL.h>
+#include "ResourceManager.h"
+
+struct VersusOptions{
+    int localPort = 0;
+    std::string peerHost;
+    int peerPort = 0;
+
+    int blocksX = 10, blocksY = 20;
+
+    // Simulated network conditions on our outgoing packets
+    int latencyMs = 0, jitterMs = 0;
+    double lossRate = 0;
+};
+
+// Head-to-head match against another instance, runs until the window is closed or ESC is pressed
+int runVersus(SDL_Renderer* renderer, const std::shared_ptr<ResourceManager>& resourceManager,
+              int width, int height, const VersusOptions& options);
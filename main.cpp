@@ -1,12 +1,40 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
 #include <iostream>
+#include <random>
 #include "TetrisWindow.h"
 #include <SDL.h>
 #include "ResourceManager.h"
-
+#include "Telemetry.h"
+#include "LayerCompositor.h"
+#include "VersusMode.h"
+#include "ReplayMode.h"
+#include "SpectatorStream.h"
+#include "ObservationRing.h"
+#include "FrameCapture.h"
+#include "GameEvents.h"
+#include "SoundEffects.h"
+#include "Trace.h"
+
+// Layout at a scale of 1, the window opens at this size and everything is scaled to fit the
+// output when it is resized or has more pixels, e.g. on HiDPI screens
 constexpr int WIDTH = 800, HEIGHT = 720;
-constexpr int BLOCK_SIZE = 30, BLOCKS_X = 10, BLOCKS_Y = 20;
+constexpr int MAX_BOARD_SIZE = 4096;
+
+// Room left around the board for the score, the block preview and the labels
+constexpr int BOARD_MARGIN_X = 180, BOARD_MARGIN_Y = 40;
+
+int BLOCK_SIZE = 30, BLOCKS_X = 10, BLOCKS_Y = 20;
+
+// Renderer output in pixels and the scale of the layout, set by updateLayout
+int screenWidth = WIDTH, screenHeight = HEIGHT;
+float uiScale = 1;
+RenderBackend renderBackend = RenderBackend::DRAW_CALLS;
+std::string tracePath;
+std::string hintPositionPath; // Where H saves the position it searched, not saved if empty
 
-int points = 0;
 
 enum GameState{
     STOPPED,
@@ -16,63 +44,276 @@ enum GameState{
 
 std::shared_ptr<ResourceManager> resourceManager;
 std::unique_ptr<TetrisWindow> gameWindow;
+std::unique_ptr<Telemetry> telemetry;
+std::unique_ptr<SpectatorWriter> recorder;
+std::unique_ptr<ObservationPublisher> publisher;
+std::unique_ptr<FrameCapture> frameCapture;
+
+// The game's events reach sound, score display and telemetry once per frame
+GameEventBus gameEvents;
+ScoreKeeper score;
+std::unique_ptr<SoundEffects> soundEffects;
 
 GameState gameState = GameState::STOPPED;
 bool everStarted = false;
+int actions = 0;
 
 SDL_Renderer* renderer;
 
 bool onKeyPress(SDL_Keycode keyCode);
 void respawnGame();
+bool updateLayout();
+int scaled(int length);
+int blockSize();
+int boardX();
+int boardY();
 void renderOverlays();
+void recordTelemetry(float frameMs, GameOverCause gameOver);
+
+int main(int argc, char* argv[]) {
+    const uint64_t startUs = Telemetry::nowUs();
+
+    bool versus = false;
+    VersusOptions versusOptions;
+    double textureBudgetMb = 0;
+    std::string recordPath, replayPath, capturePath, publishName;
+
+    for (int i = 1; i < argc; i++){
+        std::string arg = argv[i];
+        if (arg == "--telemetry" && i + 1 < argc){
+            telemetry = std::make_unique<Telemetry>(argv[++i]);
+        }
+        else if (arg == "--board" && i + 1 < argc){
+            if (sscanf(argv[++i], "%dx%d", &BLOCKS_X, &BLOCKS_Y) != 2
+                || BLOCKS_X < 4 || BLOCKS_Y < 4 || BLOCKS_X > MAX_BOARD_SIZE || BLOCKS_Y > MAX_BOARD_SIZE){
+                std::cout << "Board sides must be between 4 and " << MAX_BOARD_SIZE << " blocks" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--block-size" && i + 1 < argc){
+            BLOCK_SIZE = atoi(argv[++i]);
+            if (BLOCK_SIZE < 4){
+                std::cout << "Block size must be at least 4 pixels" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--renderer" && i + 1 < argc){
+            std::string name = argv[++i];
+            if (name == "draw"){
+                renderBackend = RenderBackend::DRAW_CALLS;
+            }
+            else if (name == "stream"){
+                renderBackend = RenderBackend::STREAMING;
+            }
+            else{
+                std::cout << "Renderer must be draw or stream" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--texture-budget" && i + 1 < argc){
+            textureBudgetMb = atof(argv[++i]);
+            if (textureBudgetMb <= 0){
+                std::cout << "Texture budget must be a positive number of megabytes" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--hint-position" && i + 1 < argc){
+            hintPositionPath = argv[++i];
+        }
+        else if (arg == "--trace" && i + 1 < argc){
+            tracePath = argv[++i];
+        }
+        else if (arg == "--record" && i + 1 < argc){
+            recordPath = argv[++i];
+        }
+        else if (arg == "--publish" && i + 1 < argc){
+            publishName = argv[++i];
+        }
+        else if (arg == "--replay" && i + 1 < argc){
+            replayPath = argv[++i];
+        }
+        else if (arg == "--capture" && i + 1 < argc){
+            capturePath = argv[++i];
+        }
+        else if (arg == "--versus" && i + 2 < argc){
+            char host[256];
+            versusOptions.localPort = atoi(argv[++i]);
+            if (sscanf(argv[++i], "%255[^:]:%d", host, &versusOptions.peerPort) != 2){
+                std::cout << "Peer must be given as host:port" << std::endl;
+                return 1;
+            }
+            versusOptions.peerHost = host;
+            versus = true;
+        }
+        else if (arg == "--net-latency" && i + 1 < argc){
+            versusOptions.latencyMs = atoi(argv[++i]);
+        }
+        else if (arg == "--net-jitter" && i + 1 < argc){
+            versusOptions.jitterMs = atoi(argv[++i]);
+        }
+        else if (arg == "--net-loss" && i + 1 < argc){
+            versusOptions.lossRate = atof(argv[++i]);
+        }
+        else{
+            std::cout << "Usage: " << argv[0] << " [--telemetry <file|unix:socket>] [--board <width>x<height>]"
+                      << " [--block-size <pixels>] [--renderer draw|stream] [--record <file>]"
+                      << " [--trace <file>] [--capture <file.y4m|directory>] [--texture-budget <MB>]"
+                      << " [--publish <shared memory name>] [--hint-position <file>]" << std::endl
+                      << "       " << argv[0] << " --replay <file> [--capture <file.y4m|directory>]" << std::endl
+                      << "       " << argv[0] << " --versus <local port> <host:port>"
+                      << " [--net-latency <ms>] [--net-jitter <ms>] [--net-loss <rate>]" << std::endl;
+            return 1;
+        }
+    }
 
-int main() {
+    // Written on every way out of main, so replays and versus matches can be traced too
+    if (!tracePath.empty()){
+        Trace::start();
+        std::atexit([]{ Trace::write(tracePath); });
+    }
+    TRACE_THREAD_NAME("main");
 
-    if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO) != 0){
-        throw std::runtime_error("Could not init SDL");
+    {
+        TRACE_ZONE("SDL_Init");
+        if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO) != 0){
+            throw std::runtime_error("Could not init SDL");
+        }
     }
 
-    SDL_Window* window = SDL_CreateWindow("TetrisSDL", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, WIDTH, HEIGHT, 0);
+    // Rendering a replay to a capture needs no window on screen
+    bool offlineCapture = !replayPath.empty() && !capturePath.empty();
+    // Captures read back exactly WIDTH x HEIGHT pixels, so only windows without one can be resized
+    Uint32 windowFlags = offlineCapture ? SDL_WINDOW_HIDDEN : 0;
+    if (capturePath.empty()) windowFlags |= SDL_WINDOW_RESIZABLE | SDL_WINDOW_ALLOW_HIGHDPI;
+    SDL_Window* window = SDL_CreateWindow("TetrisSDL", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, WIDTH, HEIGHT,
+                                          windowFlags);
 
     if (window == nullptr){
         throw std::runtime_error("Could not create window: " + std::string(SDL_GetError()));
     }
+    SDL_SetWindowMinimumSize(window, WIDTH/2, HEIGHT/2);
 
-    renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
+    {
+        TRACE_ZONE("SDL_CreateRenderer");
+        renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
+        if (renderer == nullptr){ // e.g. SDL_VIDEODRIVER=dummy on a machine without a display
+            renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_SOFTWARE);
+        }
+    }
 
     if (renderer == nullptr){
         throw std::runtime_error("Could not create renderer: " + std::string(SDL_GetError()));
     }
 
+    const uint64_t sdlReadyUs = Telemetry::nowUs();
+
     resourceManager = std::make_shared<ResourceManager>(renderer);
     if (!resourceManager->isInitialized()){
         throw std::runtime_error("Failed to initialize ResourceManager");
     }
 
+    if (textureBudgetMb > 0){
+        resourceManager->setTextureBudget(static_cast<size_t>(textureBudgetMb * 1024 * 1024));
+    }
+
+    const uint64_t resourcesReadyUs = Telemetry::nowUs();
+
+    // Replays and versus matches keep the fixed layout, scaled to the window as a whole
+    if (!replayPath.empty() || versus){
+        SDL_RenderSetLogicalSize(renderer, WIDTH, HEIGHT);
+    }
+
+    if (!replayPath.empty()){
+        int result = runReplay(renderer, resourceManager, WIDTH, HEIGHT, BLOCK_SIZE, replayPath, capturePath);
+
+        resourceManager.reset();
+        SDL_DestroyRenderer(renderer);
+        SDL_Quit();
+        return result;
+    }
+
+    if (!recordPath.empty()){
+        recorder = std::make_unique<SpectatorWriter>();
+        if (!recorder->open(recordPath, BLOCKS_X, BLOCKS_Y)) return 1;
+    }
+    if (!publishName.empty()){
+        publisher = std::make_unique<ObservationPublisher>();
+        if (!publisher->open(publishName, BLOCKS_X, BLOCKS_Y)) return 1;
+    }
+
+    if (versus){
+        versusOptions.blocksX = BLOCKS_X;
+        versusOptions.blocksY = BLOCKS_Y;
+
+        int result = runVersus(renderer, resourceManager, WIDTH, HEIGHT, versusOptions);
+
+        resourceManager.reset();
+        SDL_DestroyRenderer(renderer);
+        SDL_Quit();
+        return result;
+    }
+
+    if (!capturePath.empty()){
+        frameCapture = std::make_unique<FrameCapture>(capturePath, WIDTH, HEIGHT, FrameCapture::DEFAULT_FPS, false);
+        if (!frameCapture->isOpen()) return 1;
+    }
+
+    updateLayout();
+
+    soundEffects = std::make_unique<SoundEffects>(resourceManager);
+    gameEvents.subscribe(soundEffects.get());
+    gameEvents.subscribe(&score);
+
     respawnGame();
 
 
     float frameTime = 1.0f / 3;
 
-    const int BOARD_X = WIDTH/2 - gameWindow->getWidth()/2;
-    const int BOARD_Y = HEIGHT/2 - gameWindow->getHeight()/2;
+    // Everything that only changes with the game state is drawn once into cached layers
+    auto layers = std::make_unique<LayerCompositor>(renderer, resourceManager, screenWidth, screenHeight, [&]{
+        SDL_SetRenderDrawColor(renderer, 0, 23, 66, 255);
+        SDL_RenderClear(renderer);
+
+        resourceManager->drawImage(0, 0, screenWidth, screenHeight, Texture::BACKGROUND);
+
+        resourceManager->drawText(boardX() + gameWindow->getWidth() + scaled(20), boardY(), "Next block:", FontSize::SMALL,
+                                  {255, 255, 255, 255});
+        resourceManager->drawText(screenWidth - scaled(130), screenHeight - scaled(20), "Copyright (C) gronnmann",
+                                  FontSize::X_SMALL, {255, 255, 255, 255});
+    }, renderOverlays);
+
+    int overlayState = -1;
 
+    // While paused or stopped nothing moves, so the loop sleeps in SDL_WaitEvent and only
+    // redraws when an event changed something or the window needs repainting
+    bool needsRedraw = true;
+    bool layoutChanged = false;
+    bool wasPlaying = false;
+    bool firstFrame = true;
 
     auto lastTime = std::chrono::system_clock::now();
+    uint64_t lastFrameUs = Telemetry::nowUs();
     while(true){
-        frameTime = 1.0f / (points/1000.0f + 3);
+        frameTime = TetrisGame::gravityInterval(score.getPoints());
+
+        bool idle = gameState != GameState::PLAYING && !needsRedraw;
 
         SDL_Event event;
-        if (SDL_PollEvent(&event)){
+        if (idle ? SDL_WaitEvent(&event) : SDL_PollEvent(&event)){
             if (event.type == SDL_QUIT){
+                if (gameState == GameState::PLAYING){
+                    recordTelemetry(0, GameOverCause::QUIT);
+                }
                 break;
             }
             else if (event.type == SDL_KEYDOWN){
+                needsRedraw = true;
 
                 if (!onKeyPress(event.key.keysym.sym)) continue;
 
                 if (gameState == GameState::PLAYING){ // PLAY
                     gameWindow->onKeyPress(event.key.keysym.sym);
+                    actions++;
                 }
 
 
@@ -82,36 +323,76 @@ int main() {
                     gameWindow->onKeyRelease(event.key.keysym.sym);
                 }
             }
+            else if (event.type == SDL_RENDER_TARGETS_RESET || event.type == SDL_RENDER_DEVICE_RESET){
+                layers->resize(screenWidth, screenHeight);
+                needsRedraw = true;
+            }
+            else if (event.type == SDL_WINDOWEVENT && event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED){
+                layoutChanged = true;
+                needsRedraw = true;
+            }
+            else if (event.type == SDL_WINDOWEVENT && (event.window.event == SDL_WINDOWEVENT_EXPOSED
+                                                     || event.window.event == SDL_WINDOWEVENT_RESTORED)){
+                needsRedraw = true;
+            }
+        }
+
+        if (gameState != GameState::PLAYING){
+            wasPlaying = false;
+            if (!needsRedraw) continue;
+        }
+        else if (!wasPlaying){
+            // Resuming, the time spent idle must not count as a gravity step or a long frame
+            lastTime = std::chrono::system_clock::now();
+            lastFrameUs = Telemetry::nowUs();
+            wasPlaying = true;
+        }
+        needsRedraw = false;
+
+        TRACE_ZONE("frame");
+
+        // Dragging the window edge sends many size changes, only the size at the time of the
+        // frame is laid out. Only what depends on the size is made again.
+        if (layoutChanged){
+            layoutChanged = false;
+            if (updateLayout()){
+                TRACE_ZONE("resize");
+                layers->resize(screenWidth, screenHeight);
+                gameWindow->resize(blockSize(), screenWidth - 2*scaled(BOARD_MARGIN_X), screenHeight - 2*scaled(BOARD_MARGIN_Y));
+            }
         }
 
         //
 
         auto currentTime = std::chrono::system_clock::now();
         std::chrono::duration<double> elapsed_ms = currentTime - lastTime;
+        GameOverCause gameOver = GameOverCause::NONE;
         if (elapsed_ms.count() > frameTime){
             if (gameState == GameState::PLAYING){
                 gameWindow->gameLoop();
 
                 if (gameWindow->isGameOver()){
                     gameState = GameState::STOPPED;
+                    gameOver = GameOverCause::BLOCK_OUT;
+                    needsRedraw = true;
                 }
             }
             lastTime = currentTime;
         }
 
-        SDL_SetRenderTarget(renderer, NULL);
-        SDL_SetRenderDrawColor(renderer, 0, 23, 66, 255);
+        // Everything the game did this frame, before it is drawn
+        gameEvents.dispatch();
 
-        SDL_RenderClear(renderer);
+        SDL_SetRenderTarget(renderer, NULL);
 
-        resourceManager->drawImage(0, 0, WIDTH, HEIGHT, Texture::BACKGROUND);
+        layers->renderBackground();
 
         // Rendering
         gameWindow->renderLoop();
 
         // Game board
-        SDL_Rect boardLoc = { BOARD_X,
-                             BOARD_Y,
+        SDL_Rect boardLoc = { boardX(),
+                             boardY(),
                               gameWindow->getWidth(),
                               gameWindow->getHeight()};
 
@@ -120,27 +401,66 @@ int main() {
 
         // Next block preview
         SDL_Rect previewLoc = {
-                BOARD_X + gameWindow->getWidth() + 20,
-                BOARD_Y + BLOCK_SIZE,
+                boardX() + gameWindow->getWidth() + scaled(20),
+                boardY() + blockSize(),
                 gameWindow->getBlockPreviewWidth(),
                 gameWindow->getBlockPreviewHeight()
         };
         SDL_RenderCopy(renderer, gameWindow->getBlockPreviewTexture(), NULL, &previewLoc);
 
-        resourceManager->drawText(BOARD_X + gameWindow->getWidth() + 20, BOARD_Y, "Next block:", FontSize::SMALL,
-                                  {255, 255, 255, 255});
-
         // Score
-        resourceManager->drawText(10, 10, "Score: " + std::to_string(points),
+        resourceManager->drawText(scaled(10), scaled(10), "Score: " + std::to_string(score.getPoints()),
                                   FontSize::SMALL, {255,255,255,255});
 
-        renderOverlays();
+        if (gameState != GameState::PLAYING){
+            int currentOverlayState = gameState * 2 + everStarted;
+            if (currentOverlayState != overlayState){
+                layers->invalidateOverlay();
+                overlayState = currentOverlayState;
+            }
+
+            layers->renderOverlay();
+        }
+
 
+        if (frameCapture) frameCapture->capture(renderer);
 
         // Finish rest
-        SDL_RenderPresent(renderer);
+        {
+            TRACE_ZONE("SDL_RenderPresent");
+            SDL_RenderPresent(renderer);
+        }
+
+        uint64_t frameEndUs = Telemetry::nowUs();
+        if (firstFrame){
+            std::cout << "First frame after " << (frameEndUs - startUs) / 1000.0 << " ms (SDL "
+                      << (sdlReadyUs - startUs) / 1000.0 << " ms, resources "
+                      << (resourcesReadyUs - sdlReadyUs) / 1000.0 << " ms)" << std::endl;
+            firstFrame = false;
+        }
+        TRACE_COUNTER("frame_ms", (frameEndUs - lastFrameUs) / 1000.0);
+        TRACE_COUNTER("points", score.getPoints());
+        TRACE_COUNTER("texture_kb", resourceManager->getTextureMemoryStats().totalBytes() / 1024.0);
+        recordTelemetry((frameEndUs - lastFrameUs) / 1000.0f, gameOver);
+        lastFrameUs = frameEndUs;
+    }
 
+    // Flush remaining telemetry and captured frames before tearing down SDL
+    telemetry.reset();
+    frameCapture.reset();
+    layers.reset();
+    gameWindow.reset();
+    gameEvents.unsubscribe(soundEffects.get());
+    soundEffects.reset();
+
+    if (textureBudgetMb > 0){
+        const TextureMemoryStats& memory = resourceManager->getTextureMemoryStats();
+        std::cout << "Texture memory peak " << memory.peakBytes / 1024 << " KB of " << memory.budgetBytes / 1024
+                  << " KB, " << memory.evictions << " evictions, " << memory.refused << " refused, "
+                  << memory.overBudget << " render targets over budget, "
+                  << memory.renderTargetsReused << " render targets reused" << std::endl;
     }
+    resourceManager.reset();
 
     SDL_DestroyRenderer(renderer);
 
@@ -180,28 +500,71 @@ bool onKeyPress(SDL_Keycode keyCode){
     return true;
 }
 
-void renderOverlays(){
-    if (gameState != GameState::PLAYING){
-        resourceManager->drawText(WIDTH/2, HEIGHT/2 + 50, "Press SPACE to continue...",
-                                  FontSize::MEDIUM, {255, 255, 255, 255}, true);
+void renderOverlays(){ // Drawn into the cached overlay layer, only while not playing
+    resourceManager->drawText(screenWidth/2, screenHeight/2 + scaled(50), "Press SPACE to continue...",
+                              FontSize::MEDIUM, {255, 255, 255, 255}, true);
 
-        if (gameState == GameState::PAUSED){
-            resourceManager->drawText(WIDTH/2, HEIGHT/2 - 50, "PAUSED",
-                                      FontSize::LARGE, {255, 255, 255, 255}, true);
-        }
-        else if (gameState == GameState::STOPPED && everStarted){
-            resourceManager->drawText(WIDTH/2, HEIGHT/2 - 50, "GAME OVER",
-                                      FontSize::LARGE, {255, 255, 255, 255}, true);
-        }
-        else if (gameState == GameState::STOPPED && !everStarted){
-            resourceManager->drawImage(WIDTH/2, HEIGHT/2 - 100, Texture::LOGO, true);
-        }
+    if (gameState == GameState::PAUSED){
+        resourceManager->drawText(screenWidth/2, screenHeight/2 - scaled(50), "PAUSED",
+                                  FontSize::LARGE, {255, 255, 255, 255}, true);
+    }
+    else if (gameState == GameState::STOPPED && everStarted){
+        resourceManager->drawText(screenWidth/2, screenHeight/2 - scaled(50), "GAME OVER",
+                                  FontSize::LARGE, {255, 255, 255, 255}, true);
     }
+    else if (gameState == GameState::STOPPED && !everStarted){
+        resourceManager->drawImage(screenWidth/2, screenHeight/2 - scaled(100), Texture::LOGO, true, uiScale);
+    }
+}
 
-    resourceManager->drawText(WIDTH-130, HEIGHT - 20, "Copyright (C) gronnmann",  FontSize::X_SMALL, {255, 255, 255, 255});
+void recordTelemetry(float frameMs, GameOverCause gameOver){
+    if (!telemetry) return;
+
+    const TextureCacheStats& cacheStats = resourceManager->getTextureCacheStats();
+
+    telemetry->record({Telemetry::nowUs(), frameMs,
+                       score.getPoints(), score.getPiecesPlaced(), score.getLinesCleared(), actions,
+                       cacheStats.hits, cacheStats.misses, cacheStats.cached,
+                       gameOver});
 }
 
 void respawnGame(){ // Just respawn the game window
-    points = 0;
-    gameWindow = std::make_unique<TetrisWindow>(BLOCK_SIZE, BLOCKS_X, BLOCKS_Y, &points, renderer, resourceManager);
-}
\ No newline at end of file
+    TRACE_ZONE("respawnGame");
+    gameWindow.reset(); // Gives its textures back first, so the new window gets them
+    gameWindow = std::make_unique<TetrisWindow>(blockSize(), BLOCKS_X, BLOCKS_Y,
+                                                screenWidth - 2*scaled(BOARD_MARGIN_X), screenHeight - 2*scaled(BOARD_MARGIN_Y),
+                                                &gameEvents, renderer, resourceManager, std::random_device()(), renderBackend);
+    if (recorder) gameWindow->setRecorder(recorder.get());
+    if (publisher) gameWindow->setObservationPublisher(publisher.get());
+    gameWindow->setHintPositionFile(hintPositionPath);
+}
+
+bool updateLayout(){ // The design layout scaled to the renderer's output, false if its size did not change
+    int width, height;
+    if (SDL_GetRendererOutputSize(renderer, &width, &height) != 0) return false;
+    if (width == screenWidth && height == screenHeight) return false;
+
+    screenWidth = width;
+    screenHeight = height;
+    uiScale = std::min(width / static_cast<float>(WIDTH), height / static_cast<float>(HEIGHT));
+
+    // Fonts are opened again for every text scale, so it changes in steps
+    resourceManager->setTextScale(std::max(0.5f, std::round(uiScale * 4) / 4));
+    return true;
+}
+
+int scaled(int length){
+    return static_cast<int>(std::lround(length * uiScale));
+}
+
+int blockSize(){
+    return std::max(4, scaled(BLOCK_SIZE));
+}
+
+int boardX(){
+    return screenWidth/2 - gameWindow->getWidth()/2;
+}
+
+int boardY(){
+    return screenHeight/2 - gameWindow->getHeight()/2;
+}
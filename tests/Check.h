@@ -0,0 +1,25 @@
+#pragma once
+#include <iostream>
+
+// Minimal checks for the regression tests, each test is a program that fails with a non-zero exit
+inline int& checkFailures(){
+    static int failures = 0;
+    return failures;
+}
+
+#define CHECK(condition) \
+    do{ \
+        if (!(condition)){ \
+            std::cout << __FILE__ << ":" << __LINE__ << ": CHECK(" #condition ") failed" << std::endl; \
+            checkFailures()++; \
+        } \
+    } while (false)
+
+inline int checkResult(){
+    if (checkFailures() > 0){
+        std::cout << checkFailures() << " checks failed" << std::endl;
+        return 1;
+    }
+    std::cout << "all checks passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,138 @@
+// Observation rings are shared memory that any local process can create under the name a reader
+// attaches to: a header whose slots do not fit the segment or the board must be refused, a ring
+// from ObservationPublisher must still be read.
+#include <new>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "Check.h"
+#include "ObservationRing.h"
+
+using namespace ObservationRing;
+
+namespace {
+    const std::string NAME = "/tetris_observation_ring_test_" + std::to_string(getpid());
+
+    struct Layout{
+        uint32_t magic = MAGIC, version = VERSION;
+        uint32_t slotCount = 8, slotSize = 0;
+        uint16_t width = 10, height = 20;
+        size_t size = 0; // Of the segment, 0 for what the slots need
+    };
+
+    Layout valid(){
+        Layout layout;
+        layout.slotSize = (sizeof(Record) + layout.width * layout.height + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+        return layout;
+    }
+
+    // Creates the segment the way a hostile or broken writer could
+    bool attaches(const Layout& layout){
+        size_t size = layout.size != 0 ? layout.size : sizeof(Header) + static_cast<size_t>(layout.slotCount) * layout.slotSize;
+
+        shm_unlink(NAME.c_str());
+        int fd = shm_open(NAME.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (fd < 0 || ftruncate(fd, static_cast<off_t>(size)) != 0) return false;
+        void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (memory == MAP_FAILED) return false;
+
+        if (size >= sizeof(Header)){
+            Header* header = new (memory) Header();
+            header->version = layout.version;
+            header->slotCount = layout.slotCount;
+            header->slotSize = layout.slotSize;
+            header->width = layout.width;
+            header->height = layout.height;
+            header->magic.store(layout.magic);
+        }
+        munmap(memory, size);
+
+        ObservationReader reader;
+        bool attached = reader.attach(NAME);
+        if (attached){
+            // Reading any record of an accepted ring stays inside the mapping
+            for (uint64_t n = 0; n < 2 * reader.getSlotCount(); n++){
+                reader.read(n, [&](const Record& record){
+                    volatile uint8_t last = record.cells()[reader.getWidth() * reader.getHeight() - 1];
+                    (void)last;
+                });
+            }
+        }
+        shm_unlink(NAME.c_str());
+        return attached;
+    }
+}
+
+int main() {
+    CHECK(attaches(valid()));
+
+    Layout layout = valid();
+    layout.magic = 0;
+    CHECK(!attaches(layout));
+
+    layout = valid();
+    layout.version = VERSION + 1;
+    CHECK(!attaches(layout));
+
+    // slot() takes the record number modulo the slot count
+    layout = valid();
+    layout.slotCount = 0;
+    layout.size = sizeof(Header) + 4096;
+    CHECK(!attaches(layout));
+
+    // Slots too small for a record and the board would read into the next slot or past the end
+    layout = valid();
+    layout.slotSize = sizeof(Record);
+    CHECK(!attaches(layout));
+    layout = valid();
+    layout.slotSize = sizeof(Record) + 10 * 20 - 8;
+    CHECK(!attaches(layout));
+    layout = valid();
+    layout.width = 1000;
+    layout.height = 1000;
+    CHECK(!attaches(layout));
+
+    // Records hold atomics, they must stay aligned
+    layout = valid();
+    layout.slotSize += 4;
+    CHECK(!attaches(layout));
+
+    // More slots than the segment has room for
+    layout = valid();
+    layout.size = sizeof(Header) + layout.slotSize * (layout.slotCount - 1);
+    CHECK(!attaches(layout));
+    layout = valid();
+    layout.slotCount = UINT32_MAX;
+    layout.slotSize = UINT32_MAX - UINT32_MAX % CACHE_LINE;
+    layout.size = sizeof(Header) + 4096;
+    CHECK(!attaches(layout));
+    layout = valid();
+    layout.size = sizeof(Header) - 1;
+    CHECK(!attaches(layout));
+
+    // A real ring, read back
+    {
+        TetrisGame game(10, 20, 3);
+        ObservationPublisher publisher;
+        CHECK(publisher.open(NAME, 10, 20, 16));
+        publisher.beginGame(game);
+        for (int i = 0; i < 40; i++){
+            publisher.publish(game, game.gameLoop());
+        }
+
+        ObservationReader reader;
+        CHECK(reader.attach(NAME));
+        CHECK(reader.getWidth() == 10 && reader.getHeight() == 20 && reader.getSlotCount() == 16);
+        CHECK(reader.getPublished() == 41);
+
+        int points = -1;
+        CHECK(reader.read(41, [&](const Record& record){ points = record.points; }) == ObservationReader::Status::OK);
+        CHECK(points == game.getPoints());
+        CHECK(reader.read(1, [](const Record&){}) == ObservationReader::Status::OVERWRITTEN);
+        CHECK(reader.read(42, [](const Record&){}) == ObservationReader::Status::NOT_YET);
+    }
+
+    return checkResult();
+}
@@ -0,0 +1,91 @@
+// Feeds a rollback session packets with frame numbers no real peer would send, which must be
+// dropped without indexing or allocating by them, and checks real inputs still get through.
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include "Check.h"
+#include "RollbackSession.h"
+#include "UdpSocket.h"
+
+namespace {
+    constexpr int SESSION_PORT = 47950;
+    constexpr int PEER_PORT = 47951;
+
+    void put32(std::vector<uint8_t>& packet, size_t at, uint32_t value){
+        for (int i = 0; i < 4; i++) packet[at + i] = value >> (8 * i);
+    }
+
+    std::vector<uint8_t> syncPacket(uint32_t seed){
+        std::vector<uint8_t> packet(6);
+        packet[0] = 1;
+        put32(packet, 1, seed);
+        packet[5] = 1;
+        return packet;
+    }
+
+    std::vector<uint8_t> inputPacket(uint32_t firstFrame, uint32_t confirmed, const std::vector<uint8_t>& inputs){
+        std::vector<uint8_t> packet(10 + inputs.size());
+        packet[0] = 2;
+        put32(packet, 1, firstFrame);
+        packet[5] = static_cast<uint8_t>(inputs.size());
+        put32(packet, 6, confirmed);
+        std::copy(inputs.begin(), inputs.end(), packet.begin() + 10);
+        return packet;
+    }
+
+    std::vector<uint8_t> checksumPacket(uint32_t frame){
+        std::vector<uint8_t> packet(13, 0xAB);
+        packet[0] = 3;
+        put32(packet, 1, frame);
+        return packet;
+    }
+
+    // Gives the datagrams time to arrive over localhost before the session polls
+    void deliver(UdpSocket& peer, const std::vector<uint8_t>& packet){
+        peer.send(packet.data(), packet.size());
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+}
+
+int main() {
+    UdpSocket sessionSocket, peer;
+    if (!sessionSocket.open(SESSION_PORT) || !sessionSocket.setPeer("127.0.0.1", PEER_PORT)) return 1;
+    if (!peer.open(PEER_PORT) || !peer.setPeer("127.0.0.1", SESSION_PORT)) return 1;
+
+    RollbackSession session(sessionSocket, 10, 20);
+
+    // Before the match starts: frames ahead of anything we sent must not confirm our inputs
+    deliver(peer, inputPacket(0, 1000000, {}));
+    deliver(peer, syncPacket(7));
+    bool started = false;
+    for (int i = 0; i < 10 && !started; i++) started = session.synchronize(7);
+    CHECK(started);
+
+    GameStepResult events;
+    CHECK(session.advanceFrame(0, events));
+
+    // Negative, huge and just out of window frames
+    deliver(peer, inputPacket(0xFFFFFFFFu, 0, {1, 2, 3}));
+    deliver(peer, inputPacket(0x80000000u, 0, {1}));
+    deliver(peer, inputPacket(0x7FFFFFF0u, 0, {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17}));
+    deliver(peer, inputPacket(RollbackSession::MAX_ROLLBACK + 1, 0, {1}));
+    deliver(peer, inputPacket(0, 0xFFFFFFFFu, {0}));
+    deliver(peer, inputPacket(0, 1000, {0}));
+    deliver(peer, checksumPacket(0xFFFFFFFFu));
+    deliver(peer, checksumPacket(0x7FFFFFE2u));
+    deliver(peer, checksumPacket(29));
+    deliver(peer, checksumPacket(30 * 1000));
+
+    CHECK(session.advanceFrame(0, events));
+    CHECK(session.getStats().confirmedFrame == 0);
+    CHECK(session.getStats().checksumsCompared == 0);
+
+    // A real peer's inputs for the frames we have played are still taken
+    deliver(peer, inputPacket(0, 2, {0, 0}));
+    CHECK(session.advanceFrame(0, events));
+    CHECK(session.getStats().confirmedFrame == 2);
+    CHECK(session.getStats().frame == 3);
+
+    return checkResult();
+}
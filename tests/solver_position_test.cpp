@@ -0,0 +1,92 @@
+// Solver positions are read from files that pc_solver is handed: a pose that does not fit its
+// block or board must be refused before the search indexes shapes and states with it.
+#include <random>
+#include <sstream>
+#include <string>
+#include "Check.h"
+#include "Solver.h"
+
+namespace {
+    // 4x4 board with the bottom two rows filled but for a gap of two, the current block in the given pose
+    std::string position(const std::string& current, int x, int y, int rotation){
+        std::ostringstream out;
+        out << "size 4 4\n"
+            << "current " << current << " " << x << " " << y << " " << rotation << "\n"
+            << "queue O\n"
+            << "....\n"
+            << "....\n"
+            << "II..\n"
+            << "II..\n";
+        return out.str();
+    }
+
+    bool reads(const std::string& text){
+        std::istringstream in(text);
+        SolverPosition position;
+        return position.read(in);
+    }
+}
+
+int main() {
+    // A game's position comes back the same
+    TetrisGame game(10, 20, 7);
+    SolverPosition saved = SolverPosition::fromGame(game, 8);
+    std::ostringstream out;
+    saved.write(out);
+
+    std::istringstream in(out.str());
+    SolverPosition loaded;
+    CHECK(loaded.read(in));
+    CHECK(loaded.width == saved.width && loaded.height == saved.height);
+    CHECK(loaded.cells == saved.cells && loaded.queue == saved.queue);
+    CHECK(loaded.currentType == saved.currentType && loaded.currentRotation == saved.currentRotation);
+    CHECK(loaded.currentX == saved.currentX && loaded.currentY == saved.currentY);
+
+    // Every rotation a block has, and none it does not
+    CHECK(reads(position("T", 1, 0, 0)));
+    CHECK(reads(position("T", 1, 0, 3)));
+    CHECK(!reads(position("T", 1, 0, 4)));
+    CHECK(!reads(position("T", 1, 0, -1)));
+    CHECK(!reads(position("T", 1, 0, -4)));
+    CHECK(!reads(position("T", 1, 0, 2147483647)));
+    CHECK(!reads(position("O", 1, 0, 1)));
+
+    // Poses far off the board would overflow the search's coordinates
+    CHECK(!reads(position("T", 2147483647, 0, 0)));
+    CHECK(!reads(position("T", -2147483647, 0, 0)));
+    CHECK(!reads(position("T", 1, 2147483647, 0)));
+    CHECK(!reads(position("T", 1, -2147483647, 0)));
+
+    // Boards and blocks that do not exist
+    CHECK(!reads("size 0 4\n"));
+    CHECK(!reads("size 65 4\n"));
+    CHECK(!reads(position("X", 1, 0, 0)));
+    CHECK(!reads(position(".", 1, 0, 0)));
+    CHECK(!reads(position("TT", 1, 0, 0)));
+    std::string shortRow = position("T", 1, 0, 0);
+    shortRow.erase(shortRow.size() - 2, 1);
+    CHECK(!reads(shortRow));
+
+    // A position that was read is safe to search
+    std::istringstream gap(position("O", 2, 0, 0));
+    SolverPosition readable;
+    CHECK(readable.read(gap));
+    SolverOptions options;
+    options.threads = 1;
+    options.tableBits = 10;
+    Solver solver(options);
+    SolverResult result = solver.solve(readable);
+    CHECK(result.found && result.moves.size() == 1);
+
+    // Random poses are either refused or searched without going outside the board
+    std::mt19937 random(7);
+    for (int i = 0; i < 2000; i++){
+        int x = static_cast<int>(random() % 40) - 20, y = static_cast<int>(random() % 40) - 20;
+        int rotation = static_cast<int>(random() % 12) - 6;
+        std::istringstream text(position("T", x, y, rotation));
+        SolverPosition pose;
+        if (pose.read(text)) solver.solve(pose);
+    }
+
+    return checkResult();
+}
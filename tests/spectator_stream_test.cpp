@@ -0,0 +1,171 @@
+// Spectator streams come from files anyone can hand over: a cut off or corrupt stream must fail
+// to open instead of writing outside the board, and a real recording must still play.
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+#include "Bot.h"
+#include "Check.h"
+#include "SpectatorStream.h"
+
+namespace {
+    const char* PATH = "spectator_stream_test.tss";
+
+    void putVarint(std::vector<uint8_t>& out, uint64_t value){
+        while (value >= 0x80){
+            out.push_back(static_cast<uint8_t>(value) | 0x80);
+            value >>= 7;
+        }
+        out.push_back(static_cast<uint8_t>(value));
+    }
+
+    void putSigned(std::vector<uint8_t>& out, int value){
+        putVarint(out, (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31));
+    }
+
+    void writeFile(const std::vector<uint8_t>& data){
+        std::ofstream out(PATH, std::ios::binary);
+        out.write(reinterpret_cast<const char*>(data.data()), data.size());
+    }
+
+    std::vector<uint8_t> readFile(){
+        std::ifstream in(PATH, std::ios::binary);
+        return std::vector<uint8_t>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+    bool opens(const std::vector<uint8_t>& data){
+        writeFile(data);
+        SpectatorReader reader;
+        return reader.open(PATH);
+    }
+
+    std::vector<uint8_t> header(uint64_t width, uint64_t height){
+        std::vector<uint8_t> out(std::begin(SpectatorStream::MAGIC), std::end(SpectatorStream::MAGIC));
+        putVarint(out, width);
+        putVarint(out, height);
+        return out;
+    }
+
+    void appendRecord(std::vector<uint8_t>& out, const std::vector<uint8_t>& record){
+        putVarint(out, record.size());
+        out.insert(out.end(), record.begin(), record.end());
+    }
+
+    // An empty 10x20 board, written as one run
+    std::vector<uint8_t> keyframe(uint8_t type = 0){
+        std::vector<uint8_t> record = {0, SpectatorStream::KEYFRAME};
+        putVarint(record, 0);
+        record.push_back(type);
+        putVarint(record, 200);
+        record.push_back(0);
+        return record;
+    }
+
+    std::vector<uint8_t> lock(TetrominoType type, int rotation, int x, int y){
+        std::vector<uint8_t> record = {16, SpectatorStream::LOCK};
+        record.push_back(static_cast<uint8_t>(type));
+        record.push_back(static_cast<uint8_t>(rotation));
+        putSigned(record, x);
+        putSigned(record, y);
+        return record;
+    }
+
+    std::vector<uint8_t> lockStream(TetrominoType type, int rotation, int x, int y){
+        std::vector<uint8_t> data = header(10, 20);
+        appendRecord(data, keyframe());
+        appendRecord(data, lock(type, rotation, x, y));
+        return data;
+    }
+
+    std::vector<uint8_t> recordBotGame(){
+        {
+            SpectatorWriter writer;
+            if (!writer.open(PATH, 10, 20)) return {};
+
+            TetrisGame game(10, 20, 5);
+            Bot bot{BotWeights()};
+            for (int piece = 0; piece < 40 && !game.isGameOver(); piece++){
+                for (GameInput input : bot.plan(game)){
+                    GameStepResult result = game.applyInput(input);
+                    writer.record(game, result);
+                    if (result.locked) break;
+                }
+                writer.record(game, game.gameLoop());
+            }
+        }
+        return readFile();
+    }
+}
+
+int main() {
+    // A real recording plays to the end
+    std::vector<uint8_t> recording = recordBotGame();
+    CHECK(recording.size() > 100);
+    {
+        SpectatorReader reader;
+        CHECK(reader.open(PATH));
+        reader.advanceTo(reader.getDurationMs());
+        CHECK(reader.getPoints() > 0 || reader.getBoard().getGeneration() > 0);
+    }
+
+    // Cut off inside the last record, and inside the header
+    CHECK(!opens(std::vector<uint8_t>(recording.begin(), recording.end() - 3)));
+    CHECK(!opens(std::vector<uint8_t>(recording.begin(), recording.begin() + 5)));
+
+    // Board sizes
+    CHECK(!opens(header(0, 20)));
+    CHECK(!opens(header(10, 65536)));
+    CHECK(!opens(header(1ull << 40, 20)));
+    CHECK(opens(header(10, 20)));
+
+    // Keyframes with cell types that do not exist, or too few cells
+    {
+        std::vector<uint8_t> data = header(10, 20);
+        appendRecord(data, keyframe(static_cast<uint8_t>(TetrominoType::P) + 1));
+        CHECK(!opens(data));
+
+        data = header(10, 20);
+        std::vector<uint8_t> shortKeyframe = {0, SpectatorStream::KEYFRAME, 0, 0, 50, 0};
+        appendRecord(data, shortKeyframe);
+        CHECK(!opens(data));
+    }
+
+    // Locked blocks: valid, rotation out of range, outside the board, far enough out to overflow
+    CHECK(opens(lockStream(TetrominoType::T, 3, 4, 17)));
+    CHECK(!opens(lockStream(TetrominoType::T, 4, 4, 17)));
+    CHECK(!opens(lockStream(TetrominoType::T, 255, 4, 17)));
+    CHECK(!opens(lockStream(TetrominoType::I, 0, 7, 17)));
+    CHECK(!opens(lockStream(TetrominoType::O, 0, 0, 19)));
+    CHECK(!opens(lockStream(TetrominoType::O, 0, -1, 0)));
+    CHECK(!opens(lockStream(TetrominoType::O, 0, 2147483647, 0)));
+    CHECK(!opens(lockStream(TetrominoType::O, 0, 0, -2147483647 - 1)));
+    CHECK(!opens(lockStream(TetrominoType::EMPTY, 0, 4, 17)));
+    CHECK(!opens(lockStream(static_cast<TetrominoType>(200), 0, 4, 17)));
+
+    // The same block twice in one place
+    {
+        std::vector<uint8_t> data = lockStream(TetrominoType::O, 0, 4, 18);
+        appendRecord(data, lock(TetrominoType::O, 0, 4, 18));
+        CHECK(!opens(data));
+    }
+
+    // Random damage to a real recording opens or fails, but never crashes
+    std::mt19937 random(1);
+    for (int i = 0; i < 2000; i++){
+        std::vector<uint8_t> damaged = recording;
+        for (int j = 0; j < 1 + i % 4; j++){
+            size_t at = sizeof(SpectatorStream::MAGIC) + random() % (damaged.size() - sizeof(SpectatorStream::MAGIC));
+            damaged[at] = static_cast<uint8_t>(random());
+        }
+        writeFile(damaged);
+        SpectatorReader reader;
+        if (reader.open(PATH)){
+            reader.advanceTo(reader.getDurationMs());
+            reader.seek(0);
+        }
+    }
+
+    std::remove(PATH);
+    return checkResult();
+}
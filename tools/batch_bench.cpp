@@ -0,0 +1,174 @@
+// Steps many environments of the batch API with random actions and reports environment steps per
+// second. --verify replays the first environments with TetrisGame and compares every step.
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include "TetrisBatch.h"
+#include "TetrisGame.h"
+
+namespace {
+    constexpr int ACTION_SETS = 64;
+
+    struct Reference{
+        std::unique_ptr<TetrisGame> game;
+        uint32_t seed;
+        int games = 0;
+        int gravityCounter = 0;
+    };
+
+    bool sameState(const TetrisBatch* batch, int env, const TetrisGame& game, const uint8_t* observation, int step){
+        const Board& board = game.getBoard();
+        const Tetromino& block = game.getCurrentBlock();
+
+        std::vector<uint8_t> expected(tetris_batch_observation_size(batch));
+        for (int y = 0; y < board.getHeight(); y++){
+            for (int x = 0; x < board.getWidth(); x++){
+                if (tetris_batch_cell(batch, env, x, y) != (board.isOccupied(x, y) ? 1 : 0)){
+                    printf("step %d env %d: cell %d,%d differs\n", step, env, x, y);
+                    return false;
+                }
+                expected[y * board.getWidth() + x] = board.isOccupied(x, y) ? TETRIS_CELL_LOCKED : TETRIS_CELL_EMPTY;
+            }
+        }
+
+        const BlockShape& shape = block.getShape();
+        for (int i = 0; i < shape.count; i++){
+            expected[(block.getY() + shape.y[i]) * board.getWidth() + block.getX() + shape.x[i]] = TETRIS_CELL_FALLING;
+        }
+        expected[expected.size() - 2] = static_cast<uint8_t>(block.getType());
+        expected[expected.size() - 1] = static_cast<uint8_t>(game.getNextBlock().getType());
+        if (observation != nullptr && !std::equal(expected.begin(), expected.end(), observation)){
+            printf("step %d env %d: observation differs\n", step, env);
+            return false;
+        }
+
+        int type, x, y, rotation;
+        tetris_batch_block(batch, env, &type, &x, &y, &rotation);
+        if (type != static_cast<int>(block.getType()) || x != block.getX() || y != block.getY() || rotation != block.getRotation()){
+            printf("step %d env %d: block %d at %d,%d/%d, TetrisGame has %d at %d,%d/%d\n", step, env, type, x, y, rotation,
+                   static_cast<int>(block.getType()), block.getX(), block.getY(), block.getRotation());
+            return false;
+        }
+        if (tetris_batch_points(batch, env) != game.getPoints()){
+            printf("step %d env %d: %d points, TetrisGame has %d\n", step, env, tetris_batch_points(batch, env), game.getPoints());
+            return false;
+        }
+        return true;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    int count = 4096, steps = 2000, width = 10, height = 20, gravity = 4, verify = 0;
+    bool observe = true;
+
+    for (int i = 1; i < argc; i++){
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--envs" && hasValue) count = atoi(argv[++i]);
+        else if (arg == "--steps" && hasValue) steps = atoi(argv[++i]);
+        else if (arg == "--size" && i + 2 < argc){
+            width = atoi(argv[++i]);
+            height = atoi(argv[++i]);
+        }
+        else if (arg == "--gravity" && hasValue) gravity = atoi(argv[++i]);
+        else if (arg == "--verify" && hasValue) verify = atoi(argv[++i]);
+        else if (arg == "--no-observations") observe = false;
+        else{
+            std::cout << "Usage: " << argv[0] << " [--envs n] [--steps n] [--size w h] [--gravity steps]"
+                      << " [--verify envs] [--no-observations]" << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<uint32_t> seeds(count);
+    for (int env = 0; env < count; env++){
+        seeds[env] = env;
+    }
+
+    TetrisBatch* batch = tetris_batch_create(count, width, height, gravity, seeds.data());
+    if (batch == nullptr){
+        std::cout << "Invalid batch size, boards can be at most " << TETRIS_BATCH_MAX_WIDTH << " wide" << std::endl;
+        return 1;
+    }
+
+    // Actions are drawn up front so the timing is of the environments only. Few hard drops, so
+    // blocks spread out, rows get filled and games last long enough to clear some.
+    std::mt19937 random(1);
+    std::vector<std::vector<uint8_t>> actionSets(ACTION_SETS, std::vector<uint8_t>(count));
+    for (std::vector<uint8_t>& actions : actionSets){
+        for (uint8_t& action : actions){
+            action = random() % 20 == 0 ? static_cast<int>(TETRIS_ACTION_HARD_DROP) : random() % TETRIS_ACTION_HARD_DROP;
+        }
+    }
+
+    std::vector<uint8_t> observations(observe ? count * tetris_batch_observation_size(batch) : 0);
+    std::vector<float> rewards(count);
+    std::vector<uint8_t> dones(count);
+
+    verify = std::min(verify, count);
+    std::vector<Reference> references(verify);
+    for (int env = 0; env < verify; env++){
+        references[env].seed = seeds[env];
+        references[env].game = std::make_unique<TetrisGame>(width, height, seeds[env]);
+    }
+
+    long games = 0;
+    double reward = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    for (int step = 0; step < steps; step++){
+        const std::vector<uint8_t>& actions = actionSets[step % ACTION_SETS];
+        tetris_batch_step(batch, actions.data(), observe ? observations.data() : nullptr, rewards.data(), dones.data());
+
+        for (int env = 0; env < count; env++){
+            games += dones[env];
+            reward += rewards[env];
+        }
+
+        for (int env = 0; env < verify; env++){
+            Reference& reference = references[env];
+            TetrisGame& game = *reference.game;
+            int points = game.getPoints();
+
+            switch (actions[env]){
+                case TETRIS_ACTION_LEFT: game.applyInput(GameInput::MOVE_LEFT); break;
+                case TETRIS_ACTION_RIGHT: game.applyInput(GameInput::MOVE_RIGHT); break;
+                case TETRIS_ACTION_ROTATE_CW: game.applyInput(GameInput::ROTATE_CW); break;
+                case TETRIS_ACTION_ROTATE_CCW: game.applyInput(GameInput::ROTATE_CCW); break;
+                case TETRIS_ACTION_HARD_DROP: game.applyInput(GameInput::HARD_DROP); break;
+            }
+            bool dueGravity = ++reference.gravityCounter >= gravity;
+            if (dueGravity) reference.gravityCounter = 0;
+            if (dueGravity && actions[env] != TETRIS_ACTION_HARD_DROP) game.gameLoop();
+
+            bool done = game.isGameOver();
+            if (rewards[env] != game.getPoints() - points || dones[env] != done){
+                printf("step %d env %d: reward %.0f done %d, TetrisGame gives %d and %d\n", step, env, rewards[env], dones[env],
+                       game.getPoints() - points, done);
+                return 1;
+            }
+            if (done){
+                reference.games++;
+                reference.gravityCounter = 0;
+                reference.game = std::make_unique<TetrisGame>(width, height, reference.seed + reference.games * count);
+            }
+            const uint8_t* observation = observe ? observations.data() + env * tetris_batch_observation_size(batch) : nullptr;
+            if (!sameState(batch, env, *reference.game, observation, step)) return 1;
+        }
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    tetris_batch_destroy(batch);
+
+    printf("%d environments x %d steps: %.1f M steps/s, %ld games ended, %.0f points%s\n", count, steps,
+           static_cast<double>(count) * steps / elapsed.count() / 1e6, games, reward, observe ? "" : " (no observations)");
+    if (verify > 0) printf("verified %d environments against TetrisGame\n", verify);
+    return 0;
+}
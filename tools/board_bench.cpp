@@ -0,0 +1,127 @@
+// Compares the FixedBoard specializations against the ChunkedBoard fallback on the
+// operations the game runs per tick: collision queries, full row scans and row clears.
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+#include "ChunkedBoard.h"
+#include "FixedBoard.h"
+
+namespace {
+    struct Pose{
+        const BlockShape* shape;
+        TetrominoType type; // Any key that is unique per shape will do for the cache
+        int rotation;
+        int x, y;
+    };
+
+    std::vector<BlockShape> allShapes(){
+        std::vector<std::unique_ptr<Tetromino>> blocks;
+        blocks.push_back(std::make_unique<TetrominoI>(0, 0));
+        blocks.push_back(std::make_unique<TetrominoO>(0, 0));
+        blocks.push_back(std::make_unique<TetrominoT>(0, 0));
+        blocks.push_back(std::make_unique<TetrominoL>(0, 0));
+        blocks.push_back(std::make_unique<TetrominoJ>(0, 0));
+        blocks.push_back(std::make_unique<TetrominoS>(0, 0));
+        blocks.push_back(std::make_unique<TetrominoZ>(0, 0));
+
+        ChunkedBoard empty(10, 20);
+        std::vector<BlockShape> shapes;
+        for (auto& block : blocks){
+            for (int rotation = 0; rotation < 4; rotation++){
+                shapes.push_back(block->getShape());
+                block->tryRotation(empty, 1);
+            }
+        }
+        return shapes;
+    }
+
+    // Bottom half filled with holes, like a game in progress
+    void fill(Board& board, unsigned seed){
+        std::mt19937 random(seed);
+        for (int y = board.getHeight()/2; y < board.getHeight(); y++){
+            for (int x = 0; x < board.getWidth(); x++){
+                if (random() % 4 != 0) board.set(x, y, TetrominoType::S);
+            }
+        }
+    }
+
+    template<typename F>
+    double nsPerOp(long operations, F&& body){
+        auto start = std::chrono::steady_clock::now();
+        body();
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count() / operations;
+    }
+
+    // Not inlined so calls go through the vtable, like they do in the game
+    __attribute__((noinline)) void run(const char* name, Board& board, const std::vector<BlockShape>& shapes){
+        const long QUERIES = 20000000, SCANS = 2000000, CLEARS = 2000000;
+        const int width = board.getWidth(), height = board.getHeight();
+
+        fill(board, 1234);
+
+        std::mt19937 random(42);
+        std::vector<Pose> poses(4096);
+        for (Pose& pose : poses){
+            size_t shape = random() % shapes.size();
+            pose = {&shapes[shape], static_cast<TetrominoType>(shape / 4 + 1), static_cast<int>(shape % 4),
+                    static_cast<int>(random() % (width + 4)) - 2,
+                    static_cast<int>(random() % (height + 4)) - 2};
+        }
+
+        long sink = 0;
+
+        double collision = nsPerOp(QUERIES, [&]{
+            for (long i = 0; i < QUERIES; i++){
+                const Pose& pose = poses[i & (poses.size() - 1)];
+                sink += board.checkCollisions(*pose.shape, pose.x, pose.y);
+            }
+        });
+
+        // Same poses again through the collision cache, the board does not change in between
+        double cached = nsPerOp(QUERIES, [&]{
+            for (long i = 0; i < QUERIES; i++){
+                const Pose& pose = poses[i & (poses.size() - 1)];
+                sink += board.queryCollision(pose.type, pose.rotation, *pose.shape, pose.x, pose.y);
+            }
+        });
+
+        // No row is full, so this is the scan checkRows does after every lock
+        double scan = nsPerOp(SCANS, [&]{
+            for (long i = 0; i < SCANS; i++){
+                sink += board.clearFullRows(0, height - 1);
+            }
+        });
+
+        double clear = nsPerOp(CLEARS, [&]{
+            for (long i = 0; i < CLEARS; i++){
+                for (int x = 0; x < width; x++){
+                    board.set(x, height - 1, TetrominoType::I);
+                }
+                sink += board.clearFullRows(height - 4, height - 1);
+            }
+        });
+
+        printf("%-22s %14.2f %11.2f %18.2f %16.2f   (%ld)\n", name, collision, cached, scan, clear, sink % 10);
+    }
+}
+
+int main() {
+    std::vector<BlockShape> shapes = allShapes();
+
+    printf("%-22s %14s %11s %18s %16s\n", "board", "collision ns", "cached ns", "full-row scan ns", "fill+clear ns");
+
+    FixedBoard<10, 20> fixed20;
+    ChunkedBoard chunked20(10, 20);
+    run("FixedBoard<10,20>", fixed20, shapes);
+    run("ChunkedBoard 10x20", chunked20, shapes);
+
+    FixedBoard<10, 40> fixed40;
+    ChunkedBoard chunked40(10, 40);
+    run("FixedBoard<10,40>", fixed40, shapes);
+    run("ChunkedBoard 10x40", chunked40, shapes);
+
+    return 0;
+}
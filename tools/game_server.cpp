@@ -0,0 +1,70 @@
+// Hosts games for remote clients, see ServerProtocol.h for the wire format.
+//   game_server [--listen <port|unix:path>] [--all-interfaces] [--workers n]
+// A TCP port only accepts connections from this machine, unless --all-interfaces is given.
+// Prints the load once every few seconds until interrupted.
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <sys/resource.h>
+#include "GameServer.h"
+
+namespace {
+    std::atomic<bool> interrupted{false};
+
+    // Every session is a file descriptor
+    void raiseFileLimit(){
+        rlimit limit{};
+        if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max){
+            limit.rlim_cur = limit.rlim_max;
+            setrlimit(RLIMIT_NOFILE, &limit);
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::string address = "47200";
+    int workers = std::max(1u, std::thread::hardware_concurrency());
+    bool allInterfaces = false;
+
+    for (int i = 1; i < argc; i++){
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--listen" && hasValue) address = argv[++i];
+        else if (arg == "--workers" && hasValue) workers = atoi(argv[++i]);
+        else if (arg == "--all-interfaces") allInterfaces = true;
+        else{
+            std::cout << "Usage: " << argv[0] << " [--listen <port|unix:path>] [--all-interfaces] [--workers n]" << std::endl;
+            return 1;
+        }
+    }
+
+    raiseFileLimit();
+    signal(SIGINT, [](int){ interrupted = true; });
+    signal(SIGTERM, [](int){ interrupted = true; });
+
+    GameServer server(address, workers, allInterfaces);
+    if (!server.start()) return 1;
+    printf("listening on %s with %d workers\n", address.c_str(), workers);
+    fflush(stdout);
+
+    auto nextReport = std::chrono::steady_clock::now();
+    while (!interrupted){
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        if (std::chrono::steady_clock::now() < nextReport) continue;
+        nextReport += std::chrono::seconds(5);
+
+        ServerStats stats = server.getStats();
+        printf("sessions=%u gravity_ticks=%lu cpu_s=%.1f late_p50=%uus late_p99=%uus late_max=%uus\n",
+               stats.sessions, static_cast<unsigned long>(stats.gravityTicks), stats.cpuMs / 1000.0,
+               stats.lateP50Us, stats.lateP99Us, stats.lateMaxUs);
+        fflush(stdout);
+    }
+
+    server.stop();
+    return 0;
+}
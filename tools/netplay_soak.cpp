@@ -0,0 +1,127 @@
+// Plays two bot driven rollback sessions against each other over localhost, with simulated
+// latency and packet loss, and reports how much rolling back it took and whether they desynced.
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include "Bot.h"
+#include "RollbackSession.h"
+#include "Trace.h"
+#include "UdpSocket.h"
+
+namespace {
+    struct Player{
+        UdpSocket socket;
+        std::unique_ptr<RollbackSession> session;
+        Bot bot{BotWeights()};
+        std::deque<GameInput> plan;
+        bool synchronized = false;
+        int inputDelay = 0;
+    };
+
+    // Bots press a key every few frames, the rest of the frames carry no input like a human's
+    FrameInput nextInput(Player& player){
+        const TetrisGame& game = player.session->getLocalGame();
+        if (game.isGameOver() || player.inputDelay > 0) return 0;
+
+        if (player.plan.empty()){
+            TRACE_ZONE("Bot::plan");
+            const std::vector<GameInput>& inputs = player.bot.plan(game);
+            player.plan.assign(inputs.begin(), inputs.end());
+        }
+        return inputBit(player.plan.front());
+    }
+
+    // Only once the session took the frame, a stalled frame presses the same key again
+    void inputAccepted(Player& player, FrameInput input){
+        if (input == 0){
+            player.inputDelay--;
+            return;
+        }
+        player.plan.pop_front();
+        player.inputDelay = 3;
+    }
+
+    void printStats(const char* name, const RollbackSession& session){
+        const RollbackStats& stats = session.getStats();
+        printf("%s: frames=%d confirmed=%d rollbacks=%ld resimulated=%ld avg_depth=%.1f max_depth=%d avg_resim_us=%.0f max_resim_us=%.0f"
+               " stalls=%ld pieces=%d checksums=%ld desyncs=%ld\n",
+               name, stats.frame, stats.confirmedFrame, stats.rollbacks, stats.resimulatedFrames,
+               stats.rollbacks > 0 ? static_cast<double>(stats.resimulatedFrames) / stats.rollbacks : 0.0,
+               stats.maxRollbackDepth, stats.rollbacks > 0 ? stats.totalResimulationUs / stats.rollbacks : 0.0, stats.maxResimulationUs, stats.stalledFrames,
+               session.getLocalGame().getPiecesPlaced(), stats.checksumsCompared, stats.desyncs);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    int port = 47000;
+    double seconds = 10;
+    int latencyMs = 50, jitterMs = 20;
+    double lossRate = 0.05;
+    std::string tracePath;
+
+    for (int i = 1; i < argc; i++){
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--port" && hasValue) port = atoi(argv[++i]);
+        else if (arg == "--seconds" && hasValue) seconds = atof(argv[++i]);
+        else if (arg == "--latency" && hasValue) latencyMs = atoi(argv[++i]);
+        else if (arg == "--jitter" && hasValue) jitterMs = atoi(argv[++i]);
+        else if (arg == "--loss" && hasValue) lossRate = atof(argv[++i]);
+        else if (arg == "--trace" && hasValue) tracePath = argv[++i];
+        else{
+            std::cout << "Usage: " << argv[0] << " [--port n] [--seconds s] [--latency ms] [--jitter ms] [--loss rate]"
+                      << " [--trace file]" << std::endl;
+            return 1;
+        }
+    }
+
+    if (!tracePath.empty()) Trace::start();
+
+    Player players[2];
+    for (int i = 0; i < 2; i++){
+        if (!players[i].socket.open(port + i) || !players[i].socket.setPeer("127.0.0.1", port + 1 - i)){
+            return 1;
+        }
+        players[i].socket.setSimulatedConditions(latencyMs, jitterMs, lossRate);
+        players[i].session = std::make_unique<RollbackSession>(players[i].socket, 10, 20);
+    }
+
+    using Clock = std::chrono::steady_clock;
+    const auto FRAME_TIME = std::chrono::microseconds(1000000 / RollbackSession::FRAMES_PER_SECOND);
+    auto end = Clock::now() + std::chrono::microseconds(static_cast<int64_t>(seconds * 1e6));
+    auto nextFrame = Clock::now();
+
+    // Real time, so the simulated latency means the same number of frames as in a real match
+    while (Clock::now() < end){
+        std::this_thread::sleep_until(nextFrame);
+        nextFrame += FRAME_TIME;
+
+        for (int i = 0; i < 2; i++){
+            Player& player = players[i];
+            if (!player.synchronized){
+                player.synchronized = player.session->synchronize(1000 + i);
+                continue;
+            }
+
+            GameStepResult events;
+            FrameInput input = nextInput(player);
+            if (player.session->advanceFrame(input, events)){
+                inputAccepted(player, input);
+            }
+        }
+    }
+
+    if (!tracePath.empty()) Trace::write(tracePath);
+
+    printf("latency=%dms jitter=%dms loss=%.0f%%\n", latencyMs, jitterMs, lossRate * 100);
+    printStats("player 1", *players[0].session);
+    printStats("player 2", *players[1].session);
+
+    long desyncs = players[0].session->getStats().desyncs + players[1].session->getStats().desyncs;
+    return desyncs == 0 ? 0 : 1;
+}
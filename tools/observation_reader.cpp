@@ -0,0 +1,217 @@
+// Attaches to the observation ring of a running game (TetrisSDL --publish <name>), checks that the
+// records arrive in order and reports how long they took from the writer to this process.
+//   observation_reader <name> [--seconds s] [--poll-us us]
+// Without a game to attach to, --publish plays bot games into a ring at a fixed rate:
+//   observation_reader --publish <name> [--rate steps/s, 0 unthrottled] [--seconds s] [--size w h] [--slots n]
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Bot.h"
+#include "ObservationRing.h"
+
+using namespace ObservationRing;
+
+namespace {
+    struct Options{
+        std::string name;
+        bool publish = false;
+        double seconds = 10;
+        int pollUs = 0; // 0 spins
+        int rate = 1000;
+        int width = 10, height = 20;
+        uint32_t slots = DEFAULT_SLOTS;
+    };
+
+    int runPublisher(const Options& options){
+        ObservationPublisher publisher;
+        if (!publisher.open(options.name, options.width, options.height, options.slots)) return 1;
+
+        Bot bot{BotWeights()};
+        uint32_t seed = 1;
+        auto game = std::make_unique<TetrisGame>(options.width, options.height, seed);
+        publisher.beginGame(*game);
+
+        std::vector<GameInput> inputs;
+        size_t nextInput = 0;
+        long games = 1;
+
+        // Two inputs per gravity step, so the bot gets its blocks down in time
+        auto start = std::chrono::steady_clock::now();
+        auto interval = std::chrono::nanoseconds(options.rate > 0 ? 1000000000 / options.rate : 0);
+        auto due = start;
+        for (long step = 0; std::chrono::steady_clock::now() - start < std::chrono::duration<double>(options.seconds); step++){
+            GameStepResult result;
+            if (step % 3 == 2){
+                result = game->gameLoop();
+            }
+            else{
+                if (nextInput >= inputs.size()){
+                    inputs = bot.plan(*game);
+                    nextInput = 0;
+                }
+                if (nextInput < inputs.size()) result = game->applyInput(inputs[nextInput++]);
+            }
+            if (result.locked) inputs.clear();
+            publisher.publish(*game, result);
+
+            if (game->isGameOver()){
+                game = std::make_unique<TetrisGame>(options.width, options.height, ++seed);
+                publisher.beginGame(*game);
+                inputs.clear();
+                games++;
+            }
+
+            if (options.rate > 0){
+                due += interval;
+                std::this_thread::sleep_until(due);
+            }
+        }
+
+        printf("published %llu records, %ld games\n", static_cast<unsigned long long>(publisher.getPublished()), games);
+        return 0;
+    }
+
+    double percentile(std::vector<uint64_t>& values, double fraction){
+        if (values.empty()) return 0;
+        size_t index = std::min(values.size() - 1, static_cast<size_t>(fraction * values.size()));
+        std::nth_element(values.begin(), values.begin() + index, values.end());
+        return values[index] / 1000.0;
+    }
+
+    int runReader(const Options& options){
+        ObservationReader reader;
+        if (!reader.attach(options.name)) return 1;
+        printf("attached to %s: %dx%d board, %u slots\n", options.name.c_str(), reader.getWidth(), reader.getHeight(), reader.getSlotCount());
+
+        const size_t cellCount = static_cast<size_t>(reader.getWidth()) * reader.getHeight();
+        std::vector<uint64_t> latenciesNs;
+        latenciesNs.reserve(1 << 20);
+
+        uint64_t next = reader.getPublished() + 1; // Only records published from now on
+        uint64_t received = 0, lost = 0, outOfOrder = 0, laps = 0;
+        uint32_t lastGame = 0, lastStep = 0;
+        int32_t lastPoints = 0, lastPieces = 0;
+        uint64_t lastPublishNs = 0;
+        bool haveLast = false, lostSinceLast = false;
+
+        auto start = std::chrono::steady_clock::now();
+        while (std::chrono::steady_clock::now() - start < std::chrono::duration<double>(options.seconds)){
+            // Read in place, keeping only what the checks need
+            uint32_t game = 0, step = 0;
+            int32_t points = 0, pieces = 0;
+            uint64_t publishNs = 0;
+            size_t invalidCells = 0;
+
+            ObservationReader::Status status = reader.read(next, [&](const Record& record){
+                game = record.game;
+                step = record.step;
+                points = record.points;
+                pieces = record.piecesPlaced;
+                publishNs = record.publishNs;
+
+                const uint8_t* cells = record.cells();
+                for (size_t i = 0; i < cellCount; i++){
+                    invalidCells += cells[i] > static_cast<uint8_t>(TetrominoType::P);
+                }
+            });
+
+            if (status == ObservationReader::Status::NOT_YET){
+                if (reader.isClosed() && reader.getPublished() < next) break;
+                if (options.pollUs > 0) std::this_thread::sleep_for(std::chrono::microseconds(options.pollUs));
+                continue;
+            }
+            if (status == ObservationReader::Status::OVERWRITTEN){
+                // Lapped: skip to half a ring behind the writer, leaving it room before it laps again
+                uint64_t resume = std::max(next + 1, reader.getPublished() - reader.getSlotCount() / 2 + 1);
+                lost += resume - next;
+                laps++;
+                next = resume;
+                lostSinceLast = true;
+                continue;
+            }
+
+            latenciesNs.push_back(nowNs() - publishNs);
+            received++;
+
+            if (haveLast){
+                bool inOrder = publishNs >= lastPublishNs;
+                if (game == lastGame){
+                    inOrder &= lostSinceLast ? step > lastStep : step == lastStep + 1;
+                    inOrder &= points >= lastPoints && pieces >= lastPieces;
+                }
+                else{
+                    inOrder &= game > lastGame && (lostSinceLast || step == 0);
+                }
+                if (!inOrder){
+                    if (outOfOrder < 10) printf("record %llu out of order: game %u step %u after game %u step %u\n",
+                                                static_cast<unsigned long long>(next), game, step, lastGame, lastStep);
+                    outOfOrder++;
+                }
+            }
+            if (invalidCells > 0){
+                printf("record %llu has %zu invalid cells\n", static_cast<unsigned long long>(next), invalidCells);
+                outOfOrder++;
+            }
+
+            haveLast = true;
+            lostSinceLast = false;
+            lastGame = game;
+            lastStep = step;
+            lastPoints = points;
+            lastPieces = pieces;
+            lastPublishNs = publishNs;
+            next++;
+        }
+
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        printf("%llu records in %.1f s (%.0f/s), %llu lost to overruns in %llu laps, %llu out of order\n",
+               static_cast<unsigned long long>(received), elapsed, received / elapsed,
+               static_cast<unsigned long long>(lost), static_cast<unsigned long long>(laps), static_cast<unsigned long long>(outOfOrder));
+        if (!latenciesNs.empty()){
+            uint64_t maxNs = *std::max_element(latenciesNs.begin(), latenciesNs.end());
+            printf("latency us: p50 %.1f  p99 %.1f  p99.9 %.1f  max %.1f\n", percentile(latenciesNs, 0.5),
+                   percentile(latenciesNs, 0.99), percentile(latenciesNs, 0.999), maxNs / 1000.0);
+        }
+        return outOfOrder == 0 ? 0 : 1;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+
+    for (int i = 1; i < argc; i++){
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--publish" && hasValue){
+            options.publish = true;
+            options.name = argv[++i];
+        }
+        else if (arg == "--seconds" && hasValue) options.seconds = atof(argv[++i]);
+        else if (arg == "--poll-us" && hasValue) options.pollUs = atoi(argv[++i]);
+        else if (arg == "--rate" && hasValue) options.rate = atoi(argv[++i]);
+        else if (arg == "--slots" && hasValue) options.slots = atoi(argv[++i]);
+        else if (arg == "--size" && i + 2 < argc){
+            options.width = atoi(argv[++i]);
+            options.height = atoi(argv[++i]);
+        }
+        else if (arg[0] != '-' && options.name.empty()) options.name = arg;
+        else{
+            options.name.clear();
+            break;
+        }
+    }
+
+    if (options.name.empty()){
+        std::cout << "Usage: " << argv[0] << " <name> [--seconds s] [--poll-us us]" << std::endl
+                  << "       " << argv[0] << " --publish <name> [--rate steps/s] [--seconds s] [--size w h] [--slots n]" << std::endl;
+        return 1;
+    }
+    return options.publish ? runPublisher(options) : runReader(options);
+}
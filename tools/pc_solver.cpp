@@ -0,0 +1,116 @@
+// Searches a position for a perfect clear and prints the inputs for every block. Positions come
+// from a file saved with H in the game, or from a new game with --seed; solutions for a seeded
+// game are played through TetrisGame to check that they really clear the board.
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include "Solver.h"
+#include "Trace.h"
+
+namespace {
+    void printResult(const SolverResult& result){
+        if (result.found){
+            printf("perfect clear with %zu blocks, %d inputs, first solution after %.2f ms\n",
+                   result.moves.size(), result.inputCount, result.firstSolutionMs);
+            for (const SolverMove& move : result.moves){
+                printf("  %c x=%d y=%d rotation=%d:", ".IJLOSTZP"[static_cast<size_t>(move.type)], move.x, move.y, move.rotation);
+                for (GameInput input : move.inputs){
+                    printf(" %s", Solver::inputName(input));
+                }
+                printf("\n");
+            }
+        }
+        else{
+            printf("no perfect clear%s\n", result.timedOut ? " found in time" : "");
+        }
+        printf("searched up to %d blocks, %llu nodes, %llu table hits, %.2f ms\n", result.deepestSearched,
+               static_cast<unsigned long long>(result.nodes), static_cast<unsigned long long>(result.tableHits), result.elapsedMs);
+    }
+
+    bool playThrough(TetrisGame game, const SolverResult& result){
+        for (const SolverMove& move : result.moves){
+            for (GameInput input : move.inputs){
+                game.applyInput(input);
+            }
+        }
+
+        const Board& board = game.getBoard();
+        for (int y = 0; y < board.getHeight(); y++){
+            for (int x = 0; x < board.getWidth(); x++){
+                if (board.isOccupied(x, y)) return false;
+            }
+        }
+        return !game.isGameOver();
+    }
+}
+
+int main(int argc, char* argv[]) {
+    SolverOptions options;
+    std::string positionPath, tracePath;
+    long seed = -1;
+    int width = 10, height = 20, preview = 12, repeat = 1;
+
+    for (int i = 1; i < argc; i++){
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--time" && hasValue) options.timeBudgetMs = atoi(argv[++i]);
+        else if (arg == "--threads" && hasValue) options.threads = atoi(argv[++i]);
+        else if (arg == "--table-bits" && hasValue) options.tableBits = atoi(argv[++i]);
+        else if (arg == "--max-blocks" && hasValue) options.maxBlocks = atoi(argv[++i]);
+        else if (arg == "--seed" && hasValue) seed = atol(argv[++i]);
+        else if (arg == "--size" && i + 2 < argc){
+            width = atoi(argv[++i]);
+            height = atoi(argv[++i]);
+        }
+        else if (arg == "--preview" && hasValue) preview = atoi(argv[++i]);
+        else if (arg == "--repeat" && hasValue) repeat = atoi(argv[++i]);
+        else if (arg == "--trace" && hasValue) tracePath = argv[++i];
+        else if (arg[0] != '-' && positionPath.empty()) positionPath = arg;
+        else{
+            std::cout << "Usage: " << argv[0] << " [--time ms] [--threads n] [--table-bits n] [--max-blocks n] [--repeat n]"
+                      << " [--trace file] (position file | --seed n [--size w h] [--preview n])" << std::endl;
+            return 1;
+        }
+    }
+
+    if (options.tableBits < 1 || options.tableBits > 30 || options.maxBlocks < 1 || repeat < 1){
+        std::cout << "Invalid options" << std::endl;
+        return 1;
+    }
+    if (!tracePath.empty()) Trace::start();
+
+    SolverPosition position;
+    std::unique_ptr<TetrisGame> game;
+    if (seed >= 0){
+        game = std::make_unique<TetrisGame>(width, height, static_cast<uint32_t>(seed));
+        position = SolverPosition::fromGame(*game, preview);
+    }
+    else{
+        std::ifstream file(positionPath);
+        if (!file || !position.read(file)){
+            std::cout << "Could not read a position from " << positionPath << std::endl;
+            return 1;
+        }
+    }
+
+    // Later runs show what the transposition table saves when the same position comes up again
+    Solver solver(options);
+    SolverResult result;
+    for (int i = 0; i < repeat; i++){
+        result = solver.solve(position);
+        if (repeat > 1) printf("run %d: %.2f ms, %llu nodes\n", i + 1, result.elapsedMs, static_cast<unsigned long long>(result.nodes));
+    }
+    printResult(result);
+
+    if (!tracePath.empty()) Trace::write(tracePath);
+
+    if (game && result.found){
+        bool cleared = playThrough(*game, result);
+        printf("played through the game: %s\n", cleared ? "board cleared" : "BOARD NOT CLEARED");
+        return cleared ? 0 : 1;
+    }
+    return 0;
+}
@@ -0,0 +1,83 @@
+// Rasterizes a board in progress with every row kernel the CPU supports, the CPU side of
+// the streaming renderer. render_bench compares the whole backend against draw calls.
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "BoardRasterizer.h"
+
+namespace {
+    constexpr int BLOCKS_X = 10, BLOCKS_Y = 20;
+
+    __attribute__((noinline)) double usPerFrame(BoardRasterizer::Kernel kernel, int blockSize, long frames){
+        const int width = blockSize * BLOCKS_X + BLOCKS_X - 2;
+        const int height = blockSize * BLOCKS_Y + BLOCKS_Y - 2;
+
+        // Padded rows, like the pitch of a locked texture
+        const int pitch = (width + 15) & ~15;
+        std::vector<uint32_t> pixels(static_cast<size_t>(pitch) * height);
+
+        std::vector<Sprite> sprites(8);
+        for (size_t i = 0; i < sprites.size(); i++){
+            sprites[i].width = blockSize;
+            sprites[i].height = blockSize;
+            sprites[i].pixels.assign(static_cast<size_t>(blockSize) * blockSize, 0xFF000000 | (i * 0x1F2F3F));
+        }
+
+        // Bottom half filled with holes, like a game in progress
+        std::mt19937 random(1234);
+        std::vector<int> cells(BLOCKS_X * BLOCKS_Y, 0);
+        for (int y = BLOCKS_Y/2; y < BLOCKS_Y; y++){
+            for (int x = 0; x < BLOCKS_X; x++){
+                if (random() % 4 != 0) cells[y*BLOCKS_X + x] = 1 + random() % 7;
+            }
+        }
+
+        BoardRasterizer rasterizer(kernel);
+        auto start = std::chrono::steady_clock::now();
+        for (long frame = 0; frame < frames; frame++){
+            rasterizer.setTarget(pixels.data(), width, height, pitch * sizeof(uint32_t));
+            rasterizer.drawGridLines(blockSize, 0xFFC8C8C8);
+
+            for (int y = 0; y < BLOCKS_Y; y++){
+                for (int x = 0; x < BLOCKS_X; x++){
+                    int cell = cells[y*BLOCKS_X + x];
+                    if (cell == 0){
+                        rasterizer.fillCell(x, y, blockSize, 0xFF000000);
+                    }else{
+                        rasterizer.blitCell(x, y, sprites[cell]);
+                    }
+                }
+            }
+        }
+        std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+
+        // Keep the stores from being optimized away
+        uint32_t sink = 0;
+        for (uint32_t pixel : pixels) sink ^= pixel;
+        if (sink == 0x12345678) printf(" ");
+
+        return elapsed.count() / frames;
+    }
+}
+
+int main() {
+    const BoardRasterizer::Kernel kernels[] = {
+            BoardRasterizer::Kernel::SCALAR, BoardRasterizer::Kernel::SSE2, BoardRasterizer::Kernel::AVX2,
+    };
+
+    printf("%-8s %12s %12s %12s\n", "kernel", "16 px", "30 px", "64 px");
+    for (BoardRasterizer::Kernel kernel : kernels){
+        // Unsupported kernels fall back to the next best one
+        if (BoardRasterizer(kernel).getKernel() != kernel) continue;
+
+        printf("%-8s", BoardRasterizer::kernelName(kernel));
+        for (int blockSize : {16, 30, 64}){
+            long frames = 20000000 / (blockSize * blockSize);
+            printf(" %9.1f us", usPerFrame(kernel, blockSize, frames));
+        }
+        printf("\n");
+    }
+
+    return 0;
+}
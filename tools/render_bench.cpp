@@ -0,0 +1,118 @@
+// Draws the same game with both board backends and reports the time per frame, including the
+// upload and present. Run from the repository root so the block images are found.
+//   render_bench [--software] [--frames <n>] [--block-size <pixels>]
+// --software asks SDL for its software renderer, the one drivers fall back to.
+#include <SDL.h>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include "ResourceManager.h"
+#include "TetrisWindow.h"
+
+namespace {
+    constexpr int WIDTH = 800, HEIGHT = 720;
+
+    double msPerFrame(SDL_Renderer* renderer, std::shared_ptr<ResourceManager> resourceManager,
+                      RenderBackend backend, int blockSize, int frames){
+        std::unique_ptr<TetrisWindow> window;
+
+        auto start = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < frames; frame++){
+            if (!window || window->isGameOver()){
+                // Same seed for both backends, so both draw the same boards
+                window = std::make_unique<TetrisWindow>(blockSize, 10, 20, WIDTH - 360, HEIGHT - 80,
+                                                        nullptr, renderer, resourceManager, 1234 + frame, backend);
+            }
+
+            // Drop a block every few frames so the board fills up
+            if (frame % 8 == 0) window->onKeyPress(frame % 16 == 0 ? SDLK_LEFT : SDLK_RIGHT);
+            if (frame % 24 == 0) window->onKeyPress(SDLK_SPACE);
+
+            window->renderLoop();
+
+            SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+            SDL_RenderClear(renderer);
+
+            SDL_Rect board = {180, 40, window->getWidth(), window->getHeight()};
+            SDL_RenderCopy(renderer, window->getTexture(), NULL, &board);
+            SDL_Rect preview = {WIDTH - 160, 40, window->getBlockPreviewWidth(), window->getBlockPreviewHeight()};
+            SDL_RenderCopy(renderer, window->getBlockPreviewTexture(), NULL, &preview);
+
+            SDL_RenderPresent(renderer);
+        }
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+        return elapsed.count() / frames;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    bool software = false;
+    int frames = 2000;
+    int blockSize = 30;
+
+    for (int i = 1; i < argc; i++){
+        if (strcmp(argv[i], "--software") == 0){
+            software = true;
+        }
+        else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc){
+            frames = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--block-size") == 0 && i + 1 < argc){
+            blockSize = atoi(argv[++i]);
+        }
+        else{
+            printf("Usage: %s [--software] [--frames <n>] [--block-size <pixels>]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO) != 0){
+        printf("Could not init SDL: %s\n", SDL_GetError());
+        return 1;
+    }
+
+    SDL_Window* window = SDL_CreateWindow("render_bench", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
+                                          WIDTH, HEIGHT, SDL_WINDOW_HIDDEN);
+    if (window == nullptr){
+        printf("Could not create window: %s\n", SDL_GetError());
+        return 1;
+    }
+
+    // No vsync, presenting must not wait for the display
+    SDL_Renderer* renderer = SDL_CreateRenderer(window, -1, software ? SDL_RENDERER_SOFTWARE : SDL_RENDERER_ACCELERATED);
+    if (renderer == nullptr){
+        printf("Could not create renderer: %s\n", SDL_GetError());
+        return 1;
+    }
+
+    SDL_RendererInfo info;
+    SDL_GetRendererInfo(renderer, &info);
+
+    {
+        auto resourceManager = std::make_shared<ResourceManager>(renderer);
+        if (!resourceManager->isInitialized()){
+            printf("Failed to initialize ResourceManager\n");
+            return 1;
+        }
+
+        printf("renderer %s, %d frames of a 10x20 board with %d px blocks, %s row kernels\n",
+               info.name, frames, blockSize, BoardRasterizer::kernelName(BoardRasterizer().getKernel()));
+
+        // Warm up the texture cache and the driver before measuring
+        msPerFrame(renderer, resourceManager, RenderBackend::DRAW_CALLS, blockSize, 50);
+        msPerFrame(renderer, resourceManager, RenderBackend::STREAMING, blockSize, 50);
+
+        printf("draw calls  %8.3f ms/frame\n", msPerFrame(renderer, resourceManager, RenderBackend::DRAW_CALLS, blockSize, frames));
+        printf("streaming   %8.3f ms/frame\n", msPerFrame(renderer, resourceManager, RenderBackend::STREAMING, blockSize, frames));
+    }
+
+    SDL_DestroyRenderer(renderer);
+    SDL_DestroyWindow(window);
+    SDL_Quit();
+
+    return 0;
+}
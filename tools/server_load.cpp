@@ -0,0 +1,303 @@
+// Load generator for game_server: many sessions pressing keys at a human rate, over one epoll
+// loop. Reports the round trip of key presses, and from the server its CPU time, how late its
+// gravity steps ran and how many sessions one core can host.
+//   server_load [--connect <host:port|unix:path>] [--sessions n] [--seconds s] [--input-ms ms]
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "ServerProtocol.h"
+#include "TetrisGame.h"
+#include "TimerWheel.h"
+
+using namespace ServerProtocol;
+
+namespace {
+    const std::string UNIX_PREFIX = "unix:";
+
+    struct Client{
+        int fd = -1;
+        std::vector<uint8_t> input;
+        std::deque<uint64_t> pendingInputs; // Send times of key presses not answered yet
+        bool playing = false;
+    };
+
+    struct Totals{
+        std::vector<uint32_t> roundTripsUs;
+        long inputs = 0, games = 0, gravityLocks = 0;
+        bool hasStats = false;
+        ServerStats stats;
+    };
+
+    uint64_t nowUs(){
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    int connectTo(const std::string& address){
+        if (address.compare(0, UNIX_PREFIX.size(), UNIX_PREFIX) == 0){
+            int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+            sockaddr_un socketAddress{};
+            socketAddress.sun_family = AF_UNIX;
+            strncpy(socketAddress.sun_path, address.c_str() + UNIX_PREFIX.size(), sizeof(socketAddress.sun_path) - 1);
+
+            if (connect(fd, reinterpret_cast<sockaddr*>(&socketAddress), sizeof(socketAddress)) != 0){
+                close(fd);
+                return -1;
+            }
+            return fd;
+        }
+
+        size_t colon = address.rfind(':');
+        std::string host = colon == std::string::npos ? "127.0.0.1" : address.substr(0, colon);
+        std::string port = colon == std::string::npos ? address : address.substr(colon + 1);
+
+        addrinfo hints{};
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo* result = nullptr;
+        if (getaddrinfo(host.c_str(), port.c_str(), &hints, &result) != 0 || result == nullptr) return -1;
+
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (connect(fd, result->ai_addr, result->ai_addrlen) != 0){
+            close(fd);
+            fd = -1;
+        }
+        freeaddrinfo(result);
+
+        if (fd != -1){
+            int noDelay = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+        }
+        return fd;
+    }
+
+    void sendBytes(Client& client, const uint8_t* data, size_t size){
+        // Messages are tiny, a full socket buffer means the server stopped reading
+        if (send(client.fd, data, size, MSG_NOSIGNAL) != static_cast<ssize_t>(size)){
+            std::cout << "Server is not keeping up, dropped a message" << std::endl;
+        }
+    }
+
+    void sendHello(Client& client, int width, int height){
+        uint8_t hello[HELLO_SIZE] = {HELLO, static_cast<uint8_t>(width), static_cast<uint8_t>(height)};
+        sendBytes(client, hello, HELLO_SIZE);
+        client.pendingInputs.clear();
+    }
+
+    ServerStats parseStats(const uint8_t* in){
+        ServerStats stats;
+        stats.sessions = get32(in); in += 4;
+        stats.workers = get16(in); in += 2;
+        stats.gravityTicks = get64(in); in += 8;
+        stats.cpuMs = get64(in); in += 8;
+        stats.uptimeMs = get64(in); in += 8;
+        stats.lateP50Us = get32(in);
+        stats.lateP99Us = get32(in + 4);
+        stats.lateP999Us = get32(in + 8);
+        stats.lateMaxUs = get32(in + 12);
+        return stats;
+    }
+
+    // Returns false when the server sent something that is not in the protocol
+    bool handleMessages(Client& client, Totals& totals, int width, int height){
+        std::vector<uint8_t>& input = client.input;
+        size_t offset = 0;
+
+        while (offset < input.size()){
+            uint8_t type = input[offset];
+            size_t size = type == WELCOME ? WELCOME_SIZE
+                        : type == INPUT_RESULT || type == GRAVITY ? RESULT_SIZE
+                        : type == STATS_REPLY ? STATS_REPLY_SIZE : 0;
+            if (size == 0) return false;
+            if (input.size() - offset < size) break;
+
+            const uint8_t* message = input.data() + offset;
+            offset += size;
+
+            if (type == WELCOME){
+                client.playing = true;
+                totals.games++;
+                continue;
+            }
+            if (type == STATS_REPLY){
+                totals.stats = parseStats(message + 1);
+                totals.hasStats = true;
+                continue;
+            }
+
+            if (type == INPUT_RESULT && !client.pendingInputs.empty()){
+                totals.roundTripsUs.push_back(nowUs() - client.pendingInputs.front());
+                client.pendingInputs.pop_front();
+            }
+            if (type == GRAVITY && (message[1] & FLAG_LOCKED)) totals.gravityLocks++;
+
+            if ((message[1] & FLAG_GAME_OVER) && client.playing){
+                client.playing = false;
+                sendHello(client, width, height);
+            }
+        }
+
+        input.erase(input.begin(), input.begin() + offset);
+        return true;
+    }
+
+    uint32_t percentile(std::vector<uint32_t>& values, double p){
+        if (values.empty()) return 0;
+
+        size_t index = std::min(values.size() - 1, static_cast<size_t>(p * values.size()));
+        std::nth_element(values.begin(), values.begin() + index, values.end());
+        return values[index];
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::string address = "127.0.0.1:47200";
+    int sessions = 1000;
+    double seconds = 10;
+    int inputMs = 250;
+    const int width = 10, height = 20;
+
+    for (int i = 1; i < argc; i++){
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--connect" && hasValue) address = argv[++i];
+        else if (arg == "--sessions" && hasValue) sessions = atoi(argv[++i]);
+        else if (arg == "--seconds" && hasValue) seconds = atof(argv[++i]);
+        else if (arg == "--input-ms" && hasValue) inputMs = std::max(1, atoi(argv[++i]));
+        else{
+            std::cout << "Usage: " << argv[0] << " [--connect <host:port|unix:path>] [--sessions n] [--seconds s]"
+                      << " [--input-ms ms]" << std::endl;
+            return 1;
+        }
+    }
+
+    rlimit limit{};
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0){
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    int epollFd = epoll_create1(0);
+    std::vector<Client> clients(sessions);
+    std::mt19937 random(42);
+    TimerWheel timers(nowUs() / 1000);
+
+    for (int i = 0; i < sessions; i++){
+        Client& client = clients[i];
+        client.fd = connectTo(address);
+        if (client.fd == -1){
+            std::cout << "Could not connect session " << i << " to " << address << ": " << strerror(errno) << std::endl;
+            return 1;
+        }
+
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.u32 = i;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, client.fd, &event);
+
+        sendHello(client, width, height);
+        timers.schedule(i, nowUs() / 1000 + random() % inputMs);
+    }
+
+    Totals totals;
+    totals.roundTripsUs.reserve(sessions * seconds * 1000 / inputMs * 1.2);
+
+    auto pump = [&](int timeoutMs){
+        epoll_event events[256];
+        int count = epoll_wait(epollFd, events, 256, timeoutMs);
+        for (int i = 0; i < count; i++){
+            Client& client = clients[events[i].data.u32];
+
+            uint8_t buffer[4096];
+            ssize_t received = recv(client.fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+            if (received <= 0){
+                std::cout << "Server closed a session" << std::endl;
+                exit(1);
+            }
+            client.input.insert(client.input.end(), buffer, buffer + received);
+
+            if (!handleMessages(client, totals, width, height)){
+                std::cout << "Unknown message from the server" << std::endl;
+                exit(1);
+            }
+        }
+    };
+
+    auto requestStats = [&]{
+        totals.hasStats = false;
+        uint8_t request = STATS;
+        sendBytes(clients[0], &request, 1);
+
+        uint64_t deadline = nowUs() + 2000000;
+        while (!totals.hasStats && nowUs() < deadline) pump(10);
+        return totals.stats;
+    };
+
+    ServerStats before = requestStats();
+    uint64_t startUs = nowUs();
+    uint64_t endUs = startUs + static_cast<uint64_t>(seconds * 1e6);
+
+    static constexpr GameInput KEYS[] = {
+            GameInput::MOVE_LEFT, GameInput::MOVE_RIGHT, GameInput::ROTATE_CW, GameInput::ROTATE_CCW,
+            GameInput::MOVE_LEFT, GameInput::MOVE_RIGHT, GameInput::ROTATE_CW, GameInput::HARD_DROP,
+    };
+
+    while (nowUs() < endUs){
+        int64_t timeout = timers.msUntilNext(nowUs() / 1000);
+        pump(timeout < 0 || timeout > 10 ? 10 : timeout);
+
+        uint64_t now = nowUs();
+        timers.advance(now / 1000, [&](uint64_t id, uint32_t){
+            Client& client = clients[id];
+            if (client.playing){
+                uint8_t key = INPUT + static_cast<uint8_t>(KEYS[random() % 8]);
+                sendBytes(client, &key, 1);
+                client.pendingInputs.push_back(now);
+                totals.inputs++;
+            }
+
+            // Spread around the mean, so sessions don't press in lock step
+            timers.schedule(id, now / 1000 + inputMs / 2 + random() % inputMs);
+        });
+    }
+
+    double elapsedSeconds = (nowUs() - startUs) / 1e6;
+    ServerStats after = requestStats();
+
+    double coresUsed = (after.cpuMs - before.cpuMs) / 1000.0 / elapsedSeconds;
+    printf("sessions=%d seconds=%.1f inputs=%ld games=%ld gravity_locks=%ld\n",
+           sessions, elapsedSeconds, totals.inputs, totals.games, totals.gravityLocks);
+    printf("input round trip: p50=%uus p99=%uus p99.9=%uus max=%uus\n",
+           percentile(totals.roundTripsUs, 0.5), percentile(totals.roundTripsUs, 0.99),
+           percentile(totals.roundTripsUs, 0.999), percentile(totals.roundTripsUs, 1.0));
+
+    if (!totals.hasStats){
+        std::cout << "No stats from the server" << std::endl;
+        return 1;
+    }
+    printf("server: workers=%u sessions=%u gravity_ticks_per_s=%.0f cpu=%.1f%% sessions_per_core=%.0f\n",
+           after.workers, after.sessions, (after.gravityTicks - before.gravityTicks) / elapsedSeconds,
+           coresUsed * 100, coresUsed > 0 ? after.sessions / coresUsed : 0.0);
+    printf("server gravity lateness since start: p50=%uus p99=%uus p99.9=%uus max=%uus\n",
+           after.lateP50Us, after.lateP99Us, after.lateP999Us, after.lateMaxUs);
+
+    for (Client& client : clients) close(client.fd);
+    close(epollFd);
+    return 0;
+}
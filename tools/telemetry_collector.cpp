@@ -0,0 +1,116 @@
+// Minimal stand-in for the kiosk metrics collector. Listens on a UNIX socket,
+// prints every NDJSON record it receives and keeps a count per event type.
+#include <csignal>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+    volatile sig_atomic_t running = 1;
+
+    void onSignal(int){
+        running = 0;
+    }
+
+    std::string eventType(const std::string& record){
+        const std::string key = "\"event\":\"";
+        size_t start = record.find(key);
+        if (start == std::string::npos) return "unknown";
+        start += key.size();
+        return record.substr(start, record.find('"', start) - start);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    if (argc != 2){
+        std::cout << "Usage: " << argv[0] << " <socket path>" << std::endl;
+        return 1;
+    }
+
+    std::string path = argv[1];
+
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)){
+        std::cout << "Socket path too long" << std::endl;
+        return 1;
+    }
+    path.copy(address.sun_path, path.size());
+
+    int listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(path.c_str());
+    if (listenFd == -1 || bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0
+        || listen(listenFd, 8) != 0){
+        std::cout << "Could not listen on " << path << std::endl;
+        return 1;
+    }
+
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+
+    std::vector<pollfd> fds = {{listenFd, POLLIN, 0}};
+    std::map<int, std::string> pending;
+    std::map<std::string, int> counts;
+    int malformed = 0;
+
+    while (running){
+        if (poll(fds.data(), fds.size(), 500) <= 0) continue;
+
+        if (fds[0].revents & POLLIN){
+            int clientFd = accept(listenFd, nullptr, nullptr);
+            if (clientFd != -1){
+                fds.push_back({clientFd, POLLIN, 0});
+                std::cerr << "Client connected" << std::endl;
+            }
+        }
+
+        for (size_t i = 1; i < fds.size(); i++){
+            if (!(fds[i].revents & (POLLIN | POLLHUP))) continue;
+
+            char buffer[4096];
+            ssize_t received = read(fds[i].fd, buffer, sizeof(buffer));
+            if (received <= 0){
+                std::cerr << "Client disconnected" << std::endl;
+                close(fds[i].fd);
+                pending.erase(fds[i].fd);
+                fds.erase(fds.begin() + i);
+                i--;
+                continue;
+            }
+
+            std::string& data = pending[fds[i].fd];
+            data.append(buffer, received);
+
+            size_t newline;
+            while ((newline = data.find('\n')) != std::string::npos){
+                std::string record = data.substr(0, newline);
+                data.erase(0, newline + 1);
+
+                if (record.empty() || record.front() != '{' || record.back() != '}'){
+                    malformed++;
+                    continue;
+                }
+
+                counts[eventType(record)]++;
+                std::cout << record << std::endl;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < fds.size(); i++){
+        close(fds[i].fd);
+    }
+    unlink(path.c_str());
+
+    std::cerr << "Summary:";
+    for (auto& count : counts){
+        std::cerr << " " << count.first << "=" << count.second;
+    }
+    std::cerr << " malformed=" << malformed << std::endl;
+    return 0;
+}
@@ -0,0 +1,290 @@
+// Runs batches of headless bot games across all cores, either to measure a weight set
+// or to evolve better weights with a genetic algorithm.
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Bot.h"
+#include "TetrisGame.h"
+
+namespace {
+    struct Options{
+        BotWeights weights;
+        uint32_t firstSeed = 0, lastSeed = 1000;
+        int threads = std::max(1u, std::thread::hardware_concurrency());
+        int maxPieces = 1000;
+        int width = 10, height = 20;
+        std::string output;
+
+        bool tune = false;
+        int generations = 10;
+        int population = 32;
+    };
+
+    // One game in the results file
+    struct GameRecord{
+        uint32_t seed;
+        uint32_t lines;
+        uint32_t score;
+        uint32_t pieces;
+        uint32_t ticks;
+        float seconds; // Game time the ticks add up to at the real gravity speed
+    };
+
+    struct ResultsHeader{
+        char magic[4] = {'T', 'T', 'R', '1'};
+        uint32_t count = 0;
+        uint32_t width = 0, height = 0;
+        double weights[BotWeights::COUNT] = {};
+    };
+
+    GameRecord runGame(const BotWeights& weights, uint32_t seed, const Options& options){
+        TetrisGame game(options.width, options.height, seed);
+        Bot bot(weights);
+
+        float seconds = 0;
+        while (!game.isGameOver() && game.getPiecesPlaced() < options.maxPieces){
+            for (GameInput input : bot.plan(game)){
+                game.applyInput(input);
+            }
+
+            seconds += TetrisGame::gravityInterval(game.getPoints());
+            game.gameLoop();
+        }
+
+        return {seed, static_cast<uint32_t>(game.getLinesCleared()), static_cast<uint32_t>(game.getPoints()),
+                static_cast<uint32_t>(game.getPiecesPlaced()), static_cast<uint32_t>(game.getTicks()), seconds};
+    }
+
+    // Runs job(0..count-1) spread over the worker threads
+    void parallelFor(size_t count, int threads, const std::function<void(size_t)>& job){
+        std::atomic<size_t> next{0};
+        std::vector<std::thread> workers;
+
+        for (int i = 0; i < threads; i++){
+            workers.emplace_back([&]{
+                for (size_t index = next++; index < count; index = next++){
+                    job(index);
+                }
+            });
+        }
+
+        for (std::thread& worker : workers){
+            worker.join();
+        }
+    }
+
+    std::string weightsToString(const BotWeights& weights){
+        std::string result;
+        for (int i = 0; i < BotWeights::COUNT; i++){
+            if (i > 0) result += ",";
+            result += std::to_string(weights.values[i]);
+        }
+        return result;
+    }
+
+    void normalize(BotWeights& weights){
+        double length = 0;
+        for (double value : weights.values) length += value * value;
+
+        length = std::sqrt(length);
+        if (length == 0) return;
+
+        for (double& value : weights.values) value /= length;
+    }
+
+    int runBatch(const Options& options){
+        size_t count = options.lastSeed - options.firstSeed;
+        std::vector<GameRecord> records(count);
+
+        auto start = std::chrono::steady_clock::now();
+        parallelFor(count, options.threads, [&](size_t index){
+            records[index] = runGame(options.weights, options.firstSeed + index, options);
+        });
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        std::vector<uint32_t> lines;
+        double totalLines = 0, totalScore = 0, totalPieces = 0;
+        for (const GameRecord& record : records){
+            lines.push_back(record.lines);
+            totalLines += record.lines;
+            totalScore += record.score;
+            totalPieces += record.pieces;
+        }
+        std::sort(lines.begin(), lines.end());
+
+        printf("games=%zu threads=%d time=%.2fs games_per_min=%.0f pieces_per_s=%.0f\n",
+               count, options.threads, elapsed.count(), count * 60.0 / elapsed.count(), totalPieces / elapsed.count());
+        printf("lines mean=%.1f median=%u  score mean=%.1f  pieces mean=%.1f\n",
+               totalLines / count, count > 0 ? lines[count / 2] : 0, totalScore / count, totalPieces / count);
+
+        if (!options.output.empty()){
+            FILE* file = fopen(options.output.c_str(), "wb");
+            if (file == nullptr){
+                std::cout << "Could not open " << options.output << std::endl;
+                return 1;
+            }
+
+            ResultsHeader header;
+            header.count = count;
+            header.width = options.width;
+            header.height = options.height;
+            std::copy(options.weights.values.begin(), options.weights.values.end(), header.weights);
+
+            fwrite(&header, sizeof(header), 1, file);
+            fwrite(records.data(), sizeof(GameRecord), records.size(), file);
+            fclose(file);
+        }
+
+        return 0;
+    }
+
+    int runTuning(const Options& options){
+        std::mt19937 random(options.firstSeed);
+        std::uniform_real_distribution<double> unit(-1, 1);
+
+        struct Individual{
+            BotWeights weights;
+            double fitness = 0;
+        };
+
+        std::vector<Individual> population(options.population);
+        for (Individual& individual : population){
+            for (double& value : individual.weights.values) value = unit(random);
+            normalize(individual.weights);
+        }
+
+        size_t seeds = options.lastSeed - options.firstSeed;
+
+        // Fitness is the total of lines cleared over the seed range. Pieces placed break ties,
+        // which gives early generations that never clear a line something to improve on.
+        auto evaluate = [&](std::vector<Individual>& individuals){
+            std::vector<GameRecord> records(individuals.size() * seeds);
+            parallelFor(records.size(), options.threads, [&](size_t index){
+                records[index] = runGame(individuals[index / seeds].weights,
+                                         options.firstSeed + index % seeds, options);
+            });
+
+            for (size_t i = 0; i < individuals.size(); i++){
+                individuals[i].fitness = 0;
+                for (size_t game = 0; game < seeds; game++){
+                    const GameRecord& record = records[i * seeds + game];
+                    individuals[i].fitness += record.lines + record.pieces / (options.maxPieces + 1.0);
+                }
+            }
+        };
+
+        auto byFitness = [](const Individual& a, const Individual& b){ return a.fitness > b.fitness; };
+
+        evaluate(population);
+        std::sort(population.begin(), population.end(), byFitness);
+
+        for (int generation = 0; generation < options.generations; generation++){
+            auto start = std::chrono::steady_clock::now();
+
+            // Replace the weakest 30% with offspring of tournament winners
+            size_t offspringCount = std::max<size_t>(1, population.size() * 3 / 10);
+            size_t tournamentSize = std::max<size_t>(2, population.size() / 10);
+
+            std::vector<Individual> offspring(offspringCount);
+            for (Individual& child : offspring){
+                std::vector<size_t> contestants(tournamentSize);
+                for (size_t& contestant : contestants) contestant = random() % population.size();
+                std::sort(contestants.begin(), contestants.end());
+
+                const Individual& first = population[contestants[0]];
+                const Individual& second = population[contestants[1]];
+
+                // Crossover weighted by fitness, +1 so two parents without any lines still mix
+                for (int i = 0; i < BotWeights::COUNT; i++){
+                    child.weights.values[i] = first.weights.values[i] * (first.fitness + 1)
+                                            + second.weights.values[i] * (second.fitness + 1);
+                }
+
+                if (random() % 20 == 0){
+                    child.weights.values[random() % BotWeights::COUNT] += unit(random) * 0.2;
+                }
+                normalize(child.weights);
+            }
+
+            evaluate(offspring);
+            std::copy(offspring.begin(), offspring.end(), population.end() - offspringCount);
+            std::sort(population.begin(), population.end(), byFitness);
+
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            printf("generation %d: best=%.1f lines/game weights=%s (%.0f games/min)\n",
+                   generation + 1, population[0].fitness / seeds, weightsToString(population[0].weights).c_str(),
+                   offspringCount * seeds * 60.0 / elapsed.count());
+        }
+
+        printf("--weights %s\n", weightsToString(population[0].weights).c_str());
+        return 0;
+    }
+
+    void printUsage(const char* name){
+        std::cout << "Usage: " << name << " [--weights h,l,holes,bump] [--seeds first:last] [--threads n]"
+                  << " [--max-pieces n] [--board WxH] [--out results.bin]" << std::endl
+                  << "       " << name << " --tune [--generations n] [--population n] [--seeds first:last] ..." << std::endl;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+
+    for (int i = 1; i < argc; i++){
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--tune"){
+            options.tune = true;
+        }
+        else if (arg == "--weights" && hasValue){
+            double* values = options.weights.values.data();
+            if (sscanf(argv[++i], "%lf,%lf,%lf,%lf", &values[0], &values[1], &values[2], &values[3]) != BotWeights::COUNT){
+                printUsage(argv[0]);
+                return 1;
+            }
+        }
+        else if (arg == "--seeds" && hasValue){
+            if (sscanf(argv[++i], "%u:%u", &options.firstSeed, &options.lastSeed) != 2 || options.lastSeed <= options.firstSeed){
+                printUsage(argv[0]);
+                return 1;
+            }
+        }
+        else if (arg == "--board" && hasValue){
+            if (sscanf(argv[++i], "%dx%d", &options.width, &options.height) != 2 || options.width < 4 || options.height < 4){
+                printUsage(argv[0]);
+                return 1;
+            }
+        }
+        else if (arg == "--threads" && hasValue){
+            options.threads = std::max(1, atoi(argv[++i]));
+        }
+        else if (arg == "--max-pieces" && hasValue){
+            options.maxPieces = std::max(1, atoi(argv[++i]));
+        }
+        else if (arg == "--generations" && hasValue){
+            options.generations = std::max(1, atoi(argv[++i]));
+        }
+        else if (arg == "--population" && hasValue){
+            options.population = std::max(4, atoi(argv[++i]));
+        }
+        else if (arg == "--out" && hasValue){
+            options.output = argv[++i];
+        }
+        else{
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    return options.tune ? runTuning(options) : runBatch(options);
+}